@@ -45,7 +45,7 @@ version(ostream &os)
 
 void help() {
   cerr << "Usage : ngt command index [data]" << endl;
-  cerr << "           command : create search remove append export import prune reconstruct-graph optimize-search-parameters" << endl;
+  cerr << "           command : create search remove append resume export import prune reconstruct-graph optimize-search-parameters reorder merge image warmup" << endl;
   cerr << "Version : " << NGT::Index::getVersion() << endl;
   if (NGT::Index::getVersion() != NGT::Version::getVersion()) {
     version(cerr);
@@ -80,6 +80,8 @@ main(int argc, char **argv)
       ngt.create(args);
     } else if (command == "append") {
       ngt.append(args);
+    } else if (command == "resume") {
+      ngt.resume(args);
     } else if (command == "remove") {
       ngt.remove(args);
     } else if (command == "export") {
@@ -94,6 +96,14 @@ main(int argc, char **argv)
       NGT::Optimizer::evaluate(args);
     } else if (command == "optimize-search-parameters") {
       ngt.optimizeSearchParameters(args);
+    } else if (command == "reorder") {
+      ngt.reorder(args);
+    } else if (command == "merge") {
+      ngt.merge(args);
+    } else if (command == "image") {
+      ngt.saveImage(args);
+    } else if (command == "warmup") {
+      ngt.warmUp(args);
 #ifndef NGT_SHARED_MEMORY_ALLOCATOR
     } else if (command == "extract-query") {
       NGT::Optimizer::extractQueries(args);
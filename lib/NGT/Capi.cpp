@@ -193,6 +193,14 @@ bool ngt_is_property_object_type_integer(int32_t object_type) {
     return (object_type == NGT::ObjectSpace::ObjectType::Uint8);
 }
 
+bool ngt_is_property_object_type_float16(int32_t object_type) {
+    return (object_type == NGT::ObjectSpace::ObjectType::Float16);
+}
+
+bool ngt_is_property_object_type_qint8(int32_t object_type) {
+    return (object_type == NGT::ObjectSpace::ObjectType::Qint8);
+}
+
 bool ngt_set_property_object_type_float(NGTProperty prop, NGTError error) {
   if(prop == NULL){
     std::stringstream ss;
@@ -217,6 +225,30 @@ bool ngt_set_property_object_type_integer(NGTProperty prop, NGTError error) {
   return true;
 }
 
+bool ngt_set_property_object_type_float16(NGTProperty prop, NGTError error) {
+  if(prop == NULL){
+    std::stringstream ss;
+    ss << "Capi : " << __FUNCTION__ << "() : parametor error: prop = " << prop;
+    operate_error_string_(ss, error);
+    return false;
+  }
+  
+  (*static_cast<NGT::Property*>(prop)).objectType = NGT::ObjectSpace::ObjectType::Float16;
+  return true;
+}
+
+bool ngt_set_property_object_type_qint8(NGTProperty prop, NGTError error) {
+  if(prop == NULL){
+    std::stringstream ss;
+    ss << "Capi : " << __FUNCTION__ << "() : parametor error: prop = " << prop;
+    operate_error_string_(ss, error);
+    return false;
+  }
+  
+  (*static_cast<NGT::Property*>(prop)).objectType = NGT::ObjectSpace::ObjectType::Qint8;
+  return true;
+}
+
 bool ngt_set_property_distance_type_l1(NGTProperty prop, NGTError error) {
   if(prop == NULL){
     std::stringstream ss;
@@ -402,6 +434,96 @@ bool ngt_search_index_as_float(NGTIndex index, float *query, int32_t query_dim,
   return true;
 }
 
+bool ngt_batch_search_index(NGTIndex index, float *queries, size_t num_of_queries, int32_t query_dim, size_t size, float epsilon, uint32_t num_of_threads, ObjectID *ids, float *distances, NGTError error) {
+  if(index == NULL || queries == NULL || ids == NULL || distances == NULL || query_dim <= 0){
+    std::stringstream ss;
+    ss << "Capi : " << __FUNCTION__ << "() : parametor error: index = " << index << " queries = " << queries << " ids = " << ids << " distances = " << distances << " query_dim = " << query_dim;
+    operate_error_string_(ss, error);
+    return false;
+  }
+
+  NGT::Index* pindex = static_cast<NGT::Index*>(index);
+
+  try{
+    NGT::Property prop;
+    pindex->getProperty(prop);
+    if(prop.dimension != query_dim){
+      std::stringstream msg;
+      msg << "dimensions are inconsistent. " << prop.dimension << ":" << query_dim;
+      NGTThrowException(msg);
+    }
+    pindex->batchSearch(queries, num_of_queries, query_dim, size, epsilon, num_of_threads, ids, distances);
+  }catch(std::exception &err) {
+    std::stringstream ss;
+    ss << "Capi : " << __FUNCTION__ << "() : Error: " << err.what();
+    operate_error_string_(ss, error);
+    return false;
+  }
+  return true;
+}
+
+
+NGTQuery ngt_create_query(NGTIndex index, NGTError error) {
+  if(index == NULL){
+    std::stringstream ss;
+    ss << "Capi : " << __FUNCTION__ << "() : parametor error: index = " << index;
+    operate_error_string_(ss, error);
+    return NULL;
+  }
+  try{
+    NGT::Index* pindex = static_cast<NGT::Index*>(index);
+    return static_cast<NGTQuery>(pindex->getObjectSpace().allocateObject());
+  }catch(std::exception &err) {
+    std::stringstream ss;
+    ss << "Capi : " << __FUNCTION__ << "() : Error: " << err.what();
+    operate_error_string_(ss, error);
+    return NULL;
+  }
+}
+
+bool ngt_search_index_with_query(NGTIndex index, NGTQuery query, float *query_object, int32_t query_dim, size_t size, float epsilon, float radius, NGTObjectDistances results, NGTError error) {
+  if(index == NULL || query == NULL || query_object == NULL || results == NULL || query_dim <= 0){
+    std::stringstream ss;
+    ss << "Capi : " << __FUNCTION__ << "() : parametor error: index = " << index << " query = " << query << " query_object = " << query_object << " results = " << results << " query_dim = " << query_dim;
+    operate_error_string_(ss, error);
+    return false;
+  }
+
+  NGT::Index* pindex = static_cast<NGT::Index*>(index);
+  NGT::Object *ngtquery = static_cast<NGT::Object*>(query);
+
+  if(radius < 0.0){
+    radius = FLT_MAX;
+  }
+
+  try{
+    if(static_cast<size_t>(query_dim) != pindex->getObjectSpace().getDimension()){
+      std::stringstream msg;
+      msg << "the dimension of the query is inconsistent with the index. " << query_dim << ":" << pindex->getObjectSpace().getDimension();
+      NGTThrowException(msg);
+    }
+    pindex->getObjectSpace().setNormalizedObject(*ngtquery, query_object, query_dim);
+    NGT::SearchContainer sc(*ngtquery);
+    sc.setResults(static_cast<NGT::ObjectDistances*>(results));
+    sc.setSize(size);
+    sc.setRadius(radius);
+    sc.setEpsilon(epsilon);
+    pindex->search(sc);
+  }catch(std::exception &err) {
+    std::stringstream ss;
+    ss << "Capi : " << __FUNCTION__ << "() : Error: " << err.what();
+    operate_error_string_(ss, error);
+    return false;
+  }
+  return true;
+}
+
+void ngt_destroy_query(NGTIndex index, NGTQuery query) {
+  if(index == NULL || query == NULL){
+    return;
+  }
+  static_cast<NGT::Index*>(index)->getObjectSpace().deleteObject(static_cast<NGT::Object*>(query));
+}
 
 // * deprecated *
 int32_t ngt_get_size(NGTObjectDistances results, NGTError error) {
@@ -790,6 +912,17 @@ bool ngt_optimizer_set(NGTOptimizer optimizer, int outgoing, int incoming, int n
   return true;
 }
 
+bool ngt_optimizer_set_number_of_threads(NGTOptimizer optimizer, size_t numOfThreads, NGTError error) {
+  if(optimizer == NULL){
+    std::stringstream ss;
+    ss << "Capi : " << __FUNCTION__ << "() : parametor error: optimizer = " << optimizer;
+    operate_error_string_(ss, error);      
+    return false;
+  }
+  (static_cast<NGT::GraphOptimizer*>(optimizer))->setNumOfThreads(numOfThreads);
+  return true;
+}
+
 void ngt_destroy_optimizer(NGTOptimizer optimizer)
 {
     if(optimizer == NULL) return;  
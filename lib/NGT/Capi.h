@@ -31,6 +31,7 @@ typedef void* NGTObjectSpace;
 typedef void* NGTObjectDistances;
 typedef void* NGTError;
 typedef void* NGTOptimizer;
+typedef void* NGTQuery;
 
 typedef struct {
   ObjectID id;
@@ -63,10 +64,18 @@ bool ngt_is_property_object_type_float(int32_t);
 
 bool ngt_is_property_object_type_integer(int32_t);
 
+bool ngt_is_property_object_type_float16(int32_t);
+
+bool ngt_is_property_object_type_qint8(int32_t);
+
 bool ngt_set_property_object_type_float(NGTProperty, NGTError);
 
 bool ngt_set_property_object_type_integer(NGTProperty, NGTError);
 
+bool ngt_set_property_object_type_float16(NGTProperty, NGTError);
+
+bool ngt_set_property_object_type_qint8(NGTProperty, NGTError);
+
 bool ngt_set_property_distance_type_l1(NGTProperty, NGTError);
 
 bool ngt_set_property_distance_type_l2(NGTProperty, NGTError);
@@ -88,6 +97,16 @@ NGTObjectDistances ngt_create_empty_results(NGTError);
 bool ngt_search_index(NGTIndex, double*, int32_t, size_t, float, float, NGTObjectDistances, NGTError);
 
 bool ngt_search_index_as_float(NGTIndex, float*, int32_t, size_t, float, float, NGTObjectDistances, NGTError);
+
+// queries: num_of_queries x query_dim, ids and distances: num_of_queries x size
+bool ngt_batch_search_index(NGTIndex, float*, size_t, int32_t, size_t, float, uint32_t, ObjectID*, float*, NGTError);
+
+// the query object is allocated once by the caller and is refilled by every search with it.
+NGTQuery ngt_create_query(NGTIndex, NGTError);
+
+bool ngt_search_index_with_query(NGTIndex, NGTQuery, float*, int32_t, size_t, float, float, NGTObjectDistances, NGTError);
+
+void ngt_destroy_query(NGTIndex, NGTQuery);
   
 int32_t ngt_get_size(NGTObjectDistances, NGTError); // deprecated
   
@@ -148,6 +167,8 @@ bool ngt_optimizer_set(NGTOptimizer optimizer, int outgoing, int incoming, int n
 		       float rateAccuracyFrom, float rateAccuracyTo,
 		       double qte, double m, NGTError error);
 
+bool ngt_optimizer_set_number_of_threads(NGTOptimizer optimizer, size_t numOfThreads, NGTError error);
+
 void ngt_destroy_optimizer(NGTOptimizer);
 
 #ifdef __cplusplus
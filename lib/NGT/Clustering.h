@@ -25,6 +25,9 @@ using namespace std;
 #else
 #if defined(__AVX2__)
 #define NGT_CLUSTER_AVX2
+#elif defined(NGT_RUNTIME_DISPATCH)
+#define NGT_CLUSTER_AVX2
+#define NGT_CLUSTER_RUNTIME_DISPATCH
 #else
 #define NGT_CLUSTER_NO_AVX
 #endif
@@ -180,8 +183,19 @@ namespace NGT {
       }
     }
 #if !defined(NGT_CLUSTER_NO_AVX)
+#if defined(NGT_CLUSTER_RUNTIME_DISPATCH)
     static double 
       sumOfSquares(float *a, float *b, size_t size) {
+      static const bool avx2 = CpuInfo::getSimdLevel() >= CpuInfo::SimdLevelAVX2;
+      return avx2 ? sumOfSquaresAVX2(a, b, size) : sumOfSquaresScalar(a, b, size);
+    }
+    __attribute__((target("avx2")))
+    static double 
+      sumOfSquaresAVX2(float *a, float *b, size_t size) {
+#else
+    static double 
+      sumOfSquares(float *a, float *b, size_t size) {
+#endif
       __m256 sum = _mm256_setzero_ps();
       float *last = a + size;
       float *lastgroup = last - 7;
@@ -200,9 +214,14 @@ namespace NGT {
       }
       return s;
     }
-#else // !defined(NGT_AVX_DISABLED) && defined(__AVX__)
+#endif // !defined(NGT_CLUSTER_NO_AVX)
+#if defined(NGT_CLUSTER_NO_AVX) || defined(NGT_CLUSTER_RUNTIME_DISPATCH)
     static double 
+#if defined(NGT_CLUSTER_RUNTIME_DISPATCH)
+    sumOfSquaresScalar(float *a, float *b, size_t size) {
+#else
     sumOfSquares(float *a, float *b, size_t size) {
+#endif
       double csum = 0.0;
       float *x = a;
       float *y = b;
@@ -212,7 +231,7 @@ namespace NGT {
       }
       return csum;
     }
-#endif // !defined(NGT_AVX_DISABLED) && defined(__AVX__)
+#endif // defined(NGT_CLUSTER_NO_AVX) || defined(NGT_CLUSTER_RUNTIME_DISPATCH)
 
     static double
       distanceL2(std::vector<float> &vector1, std::vector<float> &vector2) {
@@ -18,6 +18,9 @@
 #include	"NGT/GraphReconstructor.h"
 #include	"NGT/Optimizer.h"
 #include	"NGT/GraphOptimizer.h"
+#include	"NGT/GraphReorderer.h"
+#include	"NGT/GraphMerger.h"
+#include	"NGT/NNDescent.h"
 
 
 using namespace std;
@@ -29,10 +32,11 @@ using namespace std;
     const string usage = "Usage: ngt create "
       "-d dimension [-p #-of-thread] [-i index-type(t|g)] [-g graph-type(a|k|b|o|i)] "
       "[-t truncation-edge-limit] [-E edge-size] [-S edge-size-for-search] [-L edge-size-limit] "
-      "[-e epsilon] [-o object-type(f|c)] [-D distance-function(1|2|a|A|h|j|c|C)] [-n #-of-inserted-objects] "
+      "[-e epsilon] [-o object-type(f|h|c|q)] [-D distance-function(1|2|a|A|h|j|c|C)] [-n #-of-inserted-objects] "
       "[-P path-adjustment-interval] [-B dynamic-edge-size-base] [-A object-alignment(t|f)] "
-      "[-T build-time-limit] [-O outgoing x incoming] "
-      "index(output) [data.tsv(input)]";
+      "[-T build-time-limit] [-O outgoing x incoming] [-R refinement-expansion] "
+      "[-V inline-neighbor-vectors(t|f)] [-M construction-method(i|n)] [-c checkpoint-interval] "
+      "[-H huge-page(d|t|e)] [-C compressed-graph(t|f)] index(output) [data.tsv(input)]";
     string database;
     try {
       database = args.get("#1");
@@ -56,8 +60,12 @@ using namespace std;
     property.dimension = args.getl("d", 0);
     property.threadPoolSize = args.getl("p", 24);
     property.pathAdjustmentInterval = args.getl("P", 0);
+    property.checkpointInterval = args.getl("c", 0);
     property.dynamicEdgeSizeBase = args.getl("B", 30);
     property.buildTimeLimit = args.getf("T", 0.0);
+    property.refinementExpansion = args.getl("R", 0);
+    property.inlineNeighborVectors = args.getChar("V", 'f') == 't' ? 1 : 0;
+    property.compressedGraph = args.getChar("C", 'f') == 't' ? 1 : 0;
 
     if (property.dimension <= 0) {
       cerr << "ngt: Error: Specify greater than 0 for # of your data dimension by a parameter -d." << endl;
@@ -67,6 +75,17 @@ using namespace std;
 
     property.objectAlignment = args.getChar("A", 'f') == 't' ? NGT::Property::ObjectAlignmentTrue : NGT::Property::ObjectAlignmentFalse;
 
+    char hugePage = args.getChar("H", 'd');
+    switch(hugePage) {
+    case 'd': property.hugePage = NGT::HugePage::ModeDisabled; break;
+    case 't': property.hugePage = NGT::HugePage::ModeTransparent; break;
+    case 'e': property.hugePage = NGT::HugePage::ModeExplicit; break;
+    default:
+      cerr << "ngt: Error: Invalid huge page mode. " << hugePage << endl;
+      cerr << usage << endl;
+      return;
+    }
+
     char graphType = args.getChar("g", 'a');
     switch(graphType) {
     case 'a': property.graphType = NGT::Property::GraphType::GraphTypeANNG; break;
@@ -131,6 +150,12 @@ using namespace std;
     case 'f': 
       property.objectType = NGT::Index::Property::ObjectType::Float;
       break;
+    case 'h':
+      property.objectType = NGT::Index::Property::ObjectType::Float16;
+      break;
+    case 'q':
+      property.objectType = NGT::Index::Property::ObjectType::Qint8;
+      break;
     case 'c':
       property.objectType = NGT::Index::Property::ObjectType::Uint8;
       break;
@@ -171,6 +196,36 @@ using namespace std;
       return;
     }
 
+    char method = args.getChar("M", 'i');
+    if (method == 'n') {
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+      // create an empty index, and then build the whole graph at once by NN-Descent.
+      if (data.empty()) {
+	cerr << "ngt: Error: Data is not specified for NN-Descent." << endl;
+	cerr << usage << endl;
+	return;
+      }
+      switch (indexType) {
+      case 't':
+	NGT::Index::createGraphAndTree(database, property, "");
+	break;
+      case 'g':
+	NGT::Index::createGraph(database, property, "");
+	break;
+      }
+      NGT::NNDescent::Parameters parameters;
+      parameters.threadSize = property.threadPoolSize;
+      NGT::NNDescent::construct(database, data, dataSize, parameters);
+#else
+      cerr << "ngt: Error: NN-Descent is not available for the shared memory allocator." << endl;
+#endif
+      return;
+    } else if (method != 'i') {
+      cerr << "ngt: Error: Invalid construction method. " << method << endl;
+      cerr << usage << endl;
+      return;
+    }
+
     switch (indexType) {
     case 't':
       NGT::Index::createGraphAndTree(database, property, data, dataSize);
@@ -224,6 +279,29 @@ using namespace std;
     }
   }
 
+  void 
+  NGT::Command::resume(Args &args)
+  {
+    const string usage = "Usage: ngt resume [-p #-of-thread] index";
+    string database;
+    try {
+      database = args.get("#1");
+    } catch (...) {
+      cerr << "ngt: Error: DB is not specified." << endl;
+      cerr << usage << endl;
+      return;
+    }
+
+    size_t threadSize = args.getl("p", 0);
+
+    try {
+      NGT::Index::resume(database, threadSize);
+    } catch (NGT::Exception &err) {
+      cerr << "ngt: Error " << err.what() << endl;
+      cerr << usage << endl;
+    }
+  }
+
 
   void
   NGT::Command::search(NGT::Index &index, NGT::Command::SearchParameter &searchParameter, istream &is, ostream &stream)
@@ -312,7 +390,7 @@ using namespace std;
 	  stream << "Rank\tID\tDistance" << endl;
 	}
 	for (size_t i = 0; i < objects.size(); i++) {
-	  stream << i + 1 << "\t" << objects[i].id << "\t";
+	  stream << i + 1 << "\t" << index.getOriginalID(objects[i].id) << "\t";
 	  stream << objects[i].distance << endl;
 	}
 	if (searchParameter.outputMode[0] == 'e') {
@@ -664,7 +742,7 @@ using namespace std;
   void
   NGT::Command::reconstructGraph(Args &args)
   {
-    const string usage = "Usage: ngt reconstruct-graph [-m mode] [-P path-adjustment-mode] -o #-of-outgoing-edges -i #-of-incoming(reversed)-edges index(input) index(output)\n"
+    const string usage = "Usage: ngt reconstruct-graph [-m mode] [-P path-adjustment-mode] [-p #-of-thread] -o #-of-outgoing-edges -i #-of-incoming(reversed)-edges index(input) index(output)\n"
       "\t-m mode\n"
       "\t\ts: Edge adjustment. (default)\n"
       "\t\tS: Edge adjustment and path adjustment.\n"
@@ -673,7 +751,9 @@ using namespace std;
       "\t\tP: Path adjustment.\n"
       "\t-P path-adjustment-mode\n"
       "\t\ta: Advanced method. High-speed. Not guarantee the paper's method. (default)\n"
-      "\t\tothers: Slow and less memory usage, but guarantee the paper's method.\n";
+      "\t\tothers: Slow and less memory usage, but guarantee the paper's method.\n"
+      "\t-p #-of-thread\n"
+      "\t\tThe number of the threads for the path adjustment. 0 means the default of OpenMP. (default)\n";
 
     string inIndexPath;
     try {
@@ -716,32 +796,43 @@ using namespace std;
 #else
       NGT::Index	outIndex(inIndexPath);
 #endif
-      cerr << "ngt::reconstructGraph: Extract the graph data." << endl;
-      // extract only edges from the index to reduce the memory usage.
       Timer timer;
       timer.start();
       vector<NGT::ObjectDistances> graph;
-      GraphReconstructor::extractGraph(graph, outIndex);
 
       char mode = args.getChar("m", 'S');
       char pamode = args.getChar("P", 'a');
       char indexType = args.getChar("I", 'a');
+      size_t threadSize = args.getl("p", 0);
 
       if (originalEdgeSize >= 0) {
 	switch (mode) {
 	case 's': // SA
 	case 'S': // SA and path adjustment
+#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+	  cerr << "ngt::reconstructGraph: Extract the graph data." << endl;
+	  // extract only edges from the index to reduce the memory usage.
+	  GraphReconstructor::extractGraph(graph, outIndex);
 	  if (indexType != 'a') {
 	    NGT::GraphReconstructor::convertToANNG(graph);
 	  }
 	  NGT::GraphReconstructor::reconstructGraph(graph, outIndex, originalEdgeSize, reverseEdgeSize);
+#else
+	  // reconstruct the graph in place chunk by chunk not to hold a copy of the graph.
+	  NGT::GraphReconstructor::reconstructGraphInChunks(outIndex, originalEdgeSize, reverseEdgeSize, indexType != 'a',
+							    NGT_GRAPH_RECONSTRUCTION_CHUNK_SIZE, threadSize);
+#endif
 	  break;
 	case 'c': // SAC
 	case 'C': // SAC and path adjustment
+	  cerr << "ngt::reconstructGraph: Extract the graph data." << endl;
+	  // extract only edges from the index to reduce the memory usage.
+	  GraphReconstructor::extractGraph(graph, outIndex);
 	  if (indexType != 'a') {
 	    NGT::GraphReconstructor::convertToANNG(graph);
 	  }
 	  NGT::GraphReconstructor::reconstructGraphWithConstraint(graph, outIndex, originalEdgeSize, reverseEdgeSize);
+	  vector<NGT::ObjectDistances>().swap(graph);
 	  break;
 	case 'P':
 	  break;
@@ -757,9 +848,9 @@ using namespace std;
 	timer.reset();
 	timer.start();
 	if (pamode == 'a') {
-	  GraphReconstructor::adjustPathsEffectively(outIndex);
+	  GraphReconstructor::adjustPathsEffectively(outIndex, threadSize);
 	} else {
-	  GraphReconstructor::adjustPaths(outIndex);
+	  GraphReconstructor::adjustPaths(outIndex, threadSize);
 	}
 	timer.stop();
 	cerr << "ngt::Path adjustment time=" << timer.time << " (sec) " << endl;
@@ -860,6 +951,140 @@ using namespace std;
 
 
 
+  void
+  NGT::Command::reorder(Args &args)
+  {
+    const string usage = "Usage: ngt reorder [-m method(b|r|g)] [-w window-size] index(input) index(output)\n"
+      "\t-m method\n"
+      "\t\tb: Breadth first search along the edges.\n"
+      "\t\tr: Reverse Cuthill-McKee.\n"
+      "\t\tg: Greedy ordering with the window of the last placed nodes. (default)\n";
+
+    string inIndexPath;
+    try {
+      inIndexPath = args.get("#1");
+    } catch (...) {
+      cerr << "ngt::reorder: Input index is not specified." << endl;
+      cerr << usage << endl;
+      return;
+    }
+    string outIndexPath;
+    try {
+      outIndexPath = args.get("#2");
+    } catch (...) {
+      cerr << "ngt::reorder: Output index is not specified." << endl;
+      cerr << usage << endl;
+      return;
+    }
+    char method = args.getChar("m", 'g');
+    size_t window = args.getl("w", 5);
+
+    try {
+      Timer timer;
+      timer.start();
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+      NGT::GraphReorderer::reorder(inIndexPath, outIndexPath, method, window);
+#else
+      NGTThrowException("reorder: Not supported for the shared memory index.");
+#endif
+      timer.stop();
+      cerr << "ngt::reorder: Reordering time=" << timer.time << " (sec) " << endl;
+    } catch (NGT::Exception &err) {
+      cerr << "ngt: Error " << err.what() << endl;
+      cerr << usage << endl;
+    }
+  }
+
+  void
+  NGT::Command::merge(Args &args)
+  {
+    const string usage = "Usage: ngt merge [-p #-of-threads] index(input) index(input)... index(output)\n"
+      "\tThe object IDs of the first index are kept and the objects of the others are appended in order.";
+
+    vector<string> indexPaths;
+    for (size_t i = 1; ; i++) {
+      try {
+	indexPaths.push_back(args.get(("#" + std::to_string(i)).c_str()));
+      } catch (...) {
+	break;
+      }
+    }
+    if (indexPaths.size() < 3) {
+      cerr << "ngt::merge: Two or more input indexes and the output index should be specified." << endl;
+      cerr << usage << endl;
+      return;
+    }
+    string outIndexPath = indexPaths.back();
+    indexPaths.pop_back();
+    size_t threadSize = args.getl("p", 0);
+
+    try {
+      Timer timer;
+      timer.start();
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+      NGT::GraphMerger::merge(indexPaths, outIndexPath, threadSize);
+#else
+      NGTThrowException("merge: Not supported for the shared memory index.");
+#endif
+      timer.stop();
+      cerr << "ngt::merge: Merging time=" << timer.time << " (sec) " << endl;
+    } catch (NGT::Exception &err) {
+      cerr << "ngt: Error " << err.what() << endl;
+      cerr << usage << endl;
+    }
+  }
+
+  void
+  NGT::Command::saveImage(Args &args)
+  {
+    const string usage = "Usage: ngt image index(input) image-file(output)\n"
+      "\tThe image file is opened as a read-only index by specifying it instead of the index.";
+    string database;
+    try {
+      database = args.get("#1");
+    } catch (...) {
+      cerr << "ngt: Error: DB is not specified" << endl;
+      cerr << usage << endl;
+      return;
+    }
+    string imageFile;
+    try {
+      imageFile = args.get("#2");
+    } catch (...) {
+      cerr << "ngt: Error: Image file is not specified" << endl;
+      cerr << usage << endl;
+      return;
+    }
+    try {
+      NGT::Index::saveImage(database, imageFile);
+    } catch (NGT::Exception &err) {
+      cerr << "ngt: Error " << err.what() << endl;
+      cerr << usage << endl;
+    }
+  }
+
+  void
+  NGT::Command::warmUp(Args &args)
+  {
+    const string usage = "Usage: ngt warmup [-p #-of-thread] index";
+    string database;
+    try {
+      database = args.get("#1");
+    } catch (...) {
+      cerr << "ngt: Error: DB is not specified" << endl;
+      cerr << usage << endl;
+      return;
+    }
+    size_t threadSize = args.getl("p", 0);
+    try {
+      size_t pages = NGT::Index::warmUp(database, threadSize);
+      cout << "# of pages=" << pages << endl;
+    } catch (NGT::Exception &err) {
+      cerr << "ngt: Error " << err.what() << endl;
+      cerr << usage << endl;
+    }
+  }
+
   void
   NGT::Command::info(Args &args)
   {
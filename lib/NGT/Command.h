@@ -91,6 +91,7 @@ public:
 
   void create(Args &args);
   void append(Args &args);
+  void resume(Args &args);
   static void search(NGT::Index &index, SearchParameter &searchParameter, std::ostream &stream)
   {
     std::ifstream		is(searchParameter.query);
@@ -108,6 +109,10 @@ public:
   void prune(Args &args);
   void reconstructGraph(Args &args);
   void optimizeSearchParameters(Args &args);
+  void reorder(Args &args);
+  void merge(Args &args);
+  void saveImage(Args &args);
+  void warmUp(Args &args);
 
   void info(Args &args);
   void setDebugLevel(int level) { debugLevel = level; }
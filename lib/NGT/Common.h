@@ -37,6 +37,7 @@
 
 #include	"NGT/defines.h"
 #include	"NGT/SharedMemoryAllocator.h"
+#include	"NGT/HalfFloat.h"
 
 #define ADVANCED_USE_REMOVED_LIST
 #define	SHARED_REMOVED_LIST
@@ -584,12 +585,12 @@ namespace NGT {
       }
       save(st); 
     }    
-    void save(std::ofstream &os) {
+    void save(std::ostream &os) {
       for (std::map<std::string, std::string>::iterator i = this->begin(); i != this->end(); i++) {
 	os << i->first << "\t" << i->second << std::endl;
       }
     }
-    void load(std::ifstream &is) {
+    void load(std::istream &is) {
       std::string line;
       while (getline(is, line)) {
 	std::vector<std::string> tokens;
@@ -1333,6 +1334,19 @@ namespace NGT {
 
     TYPE **getPtr() { return &(*this)[0]; }
 
+    // moves the order[i]-th entry to the i-th. the entries that are not in the order must be empty,
+    // and the removed entries are compacted out.
+    void permute(const std::vector<ObjectID> &order) {
+      std::vector<TYPE*> entries(order.size(), 0);
+      for (size_t i = 1; i < order.size(); i++) {
+	entries[i] = order[i] < std::vector<TYPE*>::size() ? (*this)[order[i]] : 0;
+      }
+      std::vector<TYPE*>::swap(entries);
+#ifdef ADVANCED_USE_REMOVED_LIST
+      while (!removedList.empty()) { removedList.pop(); }
+#endif
+    }
+
     inline TYPE *get(size_t idx) {
       if (isEmpty(idx)) {
 	std::stringstream msg;
@@ -0,0 +1,240 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include	<vector>
+#include	<algorithm>
+#include	<fstream>
+#include	<cstdint>
+
+#include	"NGT/defines.h"
+#include	"NGT/Common.h"
+#include	"NGT/PrimitiveComparator.h"
+
+#if defined(__SSSE3__) || defined(NGT_RUNTIME_DISPATCH)
+#include	<immintrin.h>
+#endif
+
+namespace NGT {
+
+  // CompressedGraph keeps the adjacency lists of the read-only graph as the sorted neighbor IDs without
+  // the distances. each list is the number of the neighbors as a varint followed by the groups of four
+  // deltas of the IDs. a group is a control byte of the four byte lengths (2 bits each) and the deltas
+  // in little endian, so that a group is decoded with one shuffle.
+  // The blob (sgc) consists of the header (node size, edge size, max edge size of a node and data size),
+  // the byte offsets of the lists, the lists and the padding, and is mapped into memory directly.
+  class CompressedGraph {
+  public:
+    // the decoder loads the 16 bytes of a group at once.
+    static const size_t paddingSize = 16;
+    static const size_t headerSize = 4;
+
+    CompressedGraph():offsets(0), data(0), nodeSize(0), edgeSize(0), maxEdgeSize(0) {}
+
+    bool isOpen() const { return data != 0; }
+    size_t size() const { return nodeSize; }
+    size_t getEdgeSize() const { return edgeSize; }
+    // the buffer of the decoded IDs needs this size for any node.
+    size_t getBufferSize() const { return maxEdgeSize + 4; }
+    size_t getEdgeSize(size_t idx) const {
+      const uint8_t *p = data + offsets[idx];
+      return readVarint(p);
+    }
+    void clear() {
+      offsets = 0;
+      data = 0;
+      nodeSize = edgeSize = maxEdgeSize = 0;
+    }
+
+    // decodes the neighbors of the node in the ascending order of the IDs. the IDs needs getBufferSize() entries.
+    size_t decode(size_t idx, ObjectID *ids) const {
+      const uint8_t *p = data + offsets[idx];
+      size_t size = readVarint(p);
+#if defined(__SSSE3__)
+      decodeSSSE3(p, size, ids);
+#elif defined(NGT_RUNTIME_DISPATCH)
+      // any CPU with AVX2 has SSSE3.
+      static const bool ssse3 = CpuInfo::getSimdLevel() >= CpuInfo::SimdLevelAVX2;
+      if (ssse3) {
+	decodeSSSE3(p, size, ids);
+      } else {
+	decodeScalar(p, size, ids);
+      }
+#else
+      decodeScalar(p, size, ids);
+#endif
+      return size;
+    }
+
+    // appends the list of the IDs to the data. the IDs are sorted and deduplicated in place.
+    static void encode(std::vector<ObjectID> &ids, std::vector<uint8_t> &data) {
+      std::sort(ids.begin(), ids.end());
+      ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+      writeVarint(ids.size(), data);
+      ObjectID prev = 0;
+      for (size_t i = 0; i < ids.size(); i += 4) {
+	size_t control = data.size();
+	data.push_back(0);
+	for (size_t j = 0; j < 4; j++) {
+	  ObjectID delta = 0;
+	  if (i + j < ids.size()) {
+	    delta = ids[i + j] - prev;
+	    prev = ids[i + j];
+	  }
+	  size_t length = delta < (1U << 8) ? 1 : delta < (1U << 16) ? 2 : delta < (1U << 24) ? 3 : 4;
+	  data[control] |= (length - 1) << (j * 2);
+	  for (size_t b = 0; b < length; b++) {
+	    data.push_back((delta >> (b * 8)) & 0xff);
+	  }
+	}
+      }
+    }
+
+    // writes the blob. getEdges(id, ids) sets the neighbors of the node in the order of the distances
+    // and they are truncated to the specified edge size unless it is zero.
+    template <typename GET_EDGES>
+    static void serialize(std::ofstream &os, size_t nsize, size_t truncation, GET_EDGES getEdges) {
+      uint64_t header[headerSize] = {nsize, 0, 0, 0};
+      std::vector<uint64_t> offsetVector;
+      std::vector<uint8_t> dataVector;
+      std::vector<ObjectID> ids;
+      offsetVector.reserve(nsize + 1);
+      for (size_t id = 0; id < nsize; id++) {
+	offsetVector.push_back(dataVector.size());
+	ids.clear();
+	getEdges(id, ids);
+	if (truncation != 0 && ids.size() > truncation) {
+	  ids.resize(truncation);
+	}
+	encode(ids, dataVector);
+	header[1] += ids.size();
+	header[2] = std::max(header[2], static_cast<uint64_t>(ids.size()));
+      }
+      offsetVector.push_back(dataVector.size());
+      header[3] = dataVector.size();
+      dataVector.resize(dataVector.size() + paddingSize, 0);
+      os.write(reinterpret_cast<const char*>(header), sizeof(header));
+      os.write(reinterpret_cast<const char*>(offsetVector.data()), offsetVector.size() * sizeof(uint64_t));
+      os.write(reinterpret_cast<const char*>(dataVector.data()), dataVector.size());
+    }
+
+    // the blob at the specified address is used without copying. the address is not owned.
+    bool attach(void *address, size_t size, size_t objectSize) {
+      if (size < sizeof(uint64_t) * headerSize) {
+	return false;
+      }
+      uint64_t *header = static_cast<uint64_t*>(address);
+      size_t expectedSize = sizeof(uint64_t) * (headerSize + header[0] + 1) + header[3] + paddingSize;
+      if (expectedSize != size || header[0] > objectSize) {
+	return false;
+      }
+      nodeSize = header[0];
+      edgeSize = header[1];
+      maxEdgeSize = header[2];
+      offsets = header + headerSize;
+      data = reinterpret_cast<const uint8_t*>(offsets + nodeSize + 1);
+      return true;
+    }
+
+  protected:
+#if defined(__SSSE3__) || defined(NGT_RUNTIME_DISPATCH)
+#if !defined(__SSSE3__)
+    __attribute__((target("ssse3")))
+#endif
+    static void decodeSSSE3(const uint8_t *p, size_t size, ObjectID *ids) {
+      const GroupTable &table = getGroupTable();
+      __m128i prev = _mm_setzero_si128();
+      for (size_t i = 0; i < size; i += 4) {
+	uint8_t control = *p++;
+	__m128i deltas = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+					  _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.shuffle[control])));
+	deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 4));
+	deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 8));
+	prev = _mm_add_epi32(deltas, prev);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(ids + i), prev);
+	prev = _mm_shuffle_epi32(prev, 0xff);
+	p += table.length[control];
+      }
+    }
+#endif
+#if !defined(__SSSE3__)
+    static void decodeScalar(const uint8_t *p, size_t size, ObjectID *ids) {
+      ObjectID prev = 0;
+      for (size_t i = 0; i < size; i += 4) {
+	uint8_t control = *p++;
+	for (size_t j = 0; j < 4; j++) {
+	  size_t length = ((control >> (j * 2)) & 3) + 1;
+	  ObjectID delta = 0;
+	  for (size_t b = 0; b < length; b++) {
+	    delta |= static_cast<ObjectID>(p[b]) << (b * 8);
+	  }
+	  p += length;
+	  prev += delta;
+	  ids[i + j] = prev;
+	}
+      }
+    }
+#endif
+
+    struct GroupTable {
+      GroupTable() {
+	for (size_t control = 0; control < 256; control++) {
+	  size_t pos = 0;
+	  for (size_t j = 0; j < 4; j++) {
+	    size_t bytes = ((control >> (j * 2)) & 3) + 1;
+	    for (size_t b = 0; b < 4; b++) {
+	      shuffle[control][j * 4 + b] = b < bytes ? pos + b : 0x80;
+	    }
+	    pos += bytes;
+	  }
+	  length[control] = pos;
+	}
+      }
+      uint8_t shuffle[256][16];
+      uint8_t length[256];
+    };
+    static const GroupTable &getGroupTable() {
+      static const GroupTable table;
+      return table;
+    }
+
+    static size_t readVarint(const uint8_t *&p) {
+      size_t value = 0;
+      for (size_t shift = 0; ; shift += 7) {
+	uint8_t byte = *p++;
+	value |= static_cast<size_t>(byte & 0x7f) << shift;
+	if ((byte & 0x80) == 0) {
+	  return value;
+	}
+      }
+    }
+    static void writeVarint(size_t value, std::vector<uint8_t> &data) {
+      while (value >= 0x80) {
+	data.push_back((value & 0x7f) | 0x80);
+	value >>= 7;
+      }
+      data.push_back(value);
+    }
+
+    const uint64_t	*offsets;
+    const uint8_t	*data;
+    uint64_t		nodeSize;
+    uint64_t		edgeSize;
+    uint64_t		maxEdgeSize;
+  };
+
+} // namespace NGT
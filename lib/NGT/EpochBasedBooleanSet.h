@@ -0,0 +1,164 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+// The sets below are meant to be reused across searches. Each entry holds the epoch in which
+// it was inserted, so that clear() only increments the current epoch.
+// The stamps of EpochBasedBooleanSet are a byte per object so that the set of each thread stays small.
+// The stamps are zeroed only when the epoch wraps around.
+
+class EpochBasedBooleanSet {
+ public:
+  EpochBasedBooleanSet():_epoch(1) {}
+  EpochBasedBooleanSet(const uint64_t size):_epoch(1) { clear(size); }
+
+  void clear(const uint64_t size) {
+    if (size > _stamps.size()) {
+      _stamps.resize(size, 0);
+    }
+    _epoch++;
+    if (_epoch == 0) {
+      memset(_stamps.data(), 0, _stamps.size() * sizeof(uint8_t));
+      _epoch = 1;
+    }
+  }
+
+  inline bool operator[](const uint32_t num) {
+    return _stamps[num] == _epoch;
+  }
+
+  inline void set(const uint32_t num) {
+    _stamps[num] = _epoch;
+  }
+
+  inline void insert(const uint32_t num) {
+    set(num);
+  }
+
+  inline void reset(const uint32_t num) {
+    _stamps[num] = 0;
+  }
+
+ private:
+  std::vector<uint8_t> _stamps;
+  uint8_t _epoch;
+};
+
+// The open addressing table grows instead of spilling to another container.
+class EpochBasedHashSet {
+ private:
+  struct Entry {
+    uint32_t id;
+    uint32_t epoch;
+  };
+
+  Entry *_table;
+  uint32_t _tableSize;
+  uint32_t _mask;
+  uint32_t _shift;
+  uint32_t _count;
+  uint32_t _epoch;
+
+  // the high bits of the multiplicative hash are taken, since the low bits are poorly mixed.
+  inline uint32_t _hash(const uint32_t value) {
+    return (value * 0x9E3779B1U) >> _shift;
+  }
+
+  void _initialize(const uint32_t tableSize) {
+    delete[] _table;
+    _tableSize = tableSize;
+    _mask = _tableSize - 1;
+    _shift = 32;
+    for (uint32_t s = _tableSize; s > 1; s >>= 1) {
+      _shift--;
+    }
+    _table = new Entry[_tableSize];
+    memset(_table, 0, _tableSize * sizeof(Entry));
+    _count = 0;
+    _epoch = 1;
+  }
+
+  void _extend() {
+    Entry *oldTable = _table;
+    uint32_t oldTableSize = _tableSize;
+    uint32_t epoch = _epoch;
+    _table = 0;
+    _initialize(oldTableSize << 1);
+    for (uint32_t i = 0; i < oldTableSize; i++) {
+      if (oldTable[i].epoch == epoch) {
+	set(oldTable[i].id);
+      }
+    }
+    delete[] oldTable;
+  }
+
+ public:
+  EpochBasedHashSet():_table(0), _tableSize(0), _mask(0), _shift(32), _count(0), _epoch(1) {}
+  EpochBasedHashSet(const uint64_t size):_table(0), _tableSize(0), _mask(0), _shift(32), _count(0), _epoch(1) { clear(size); }
+  ~EpochBasedHashSet() { delete[] _table; }
+
+  void clear(const uint64_t size) {
+    if (_table == 0) {
+      size_t bitSize = 0;
+      size_t bit = size;
+      while (bit != 0) {
+	bitSize++;
+	bit >>= 1;
+      }
+      _initialize(0x1 << ((bitSize + 4) / 2 + 3));
+      return;
+    }
+    _count = 0;
+    _epoch++;
+    if (_epoch == 0) {
+      memset(_table, 0, _tableSize * sizeof(Entry));
+      _epoch = 1;
+    }
+  }
+
+  inline bool operator[](const uint32_t num) {
+    for (uint32_t h = _hash(num); _table[h].epoch == _epoch; h = (h + 1) & _mask) {
+      if (_table[h].id == num) {
+	return true;
+      }
+    }
+    return false;
+  }
+
+  inline void set(const uint32_t num) {
+    uint32_t h = _hash(num);
+    for (; _table[h].epoch == _epoch; h = (h + 1) & _mask) {
+      if (_table[h].id == num) {
+	return;
+      }
+    }
+    _table[h].id = num;
+    _table[h].epoch = _epoch;
+    _count++;
+    if (_count * 2 > _tableSize) {
+      _extend();
+    }
+  }
+
+  inline void insert(const uint32_t num) {
+    set(num);
+  }
+};
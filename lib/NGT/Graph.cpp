@@ -18,7 +18,15 @@
 #include	"Graph.h"
 #include	"Thread.h"
 #include	"Index.h"
+#include	"ReadOnlyGraphSearch.h"
 
+#include	<sys/mman.h>
+#include	<sys/stat.h>
+#include	<unistd.h>
+#include	<cstring>
+#include	<cerrno>
+#include	<mutex>
+#include	<atomic>
 
 
 using namespace std;
@@ -190,7 +198,459 @@ NeighborhoodGraph::Search::jaccardUint8ForLargeDataset(NeighborhoodGraph &graph,
   graph.searchReadOnlyGraph<PrimitiveComparator::JaccardUint8, DistanceCheckedSetForLargeDataset>(sc, seeds);
 }
 
+NeighborhoodGraph::Search::Method
+NeighborhoodGraph::Search::getMethodForDimension(NGT::ObjectSpace::DistanceType dtype, size_t size, size_t dimension)
+{
+  if (size < 5000000) {
+    return getMethodForDimension<PrimitiveComparator, DistanceCheckedSet>(dtype, dimension);
+  } else {
+    return getMethodForDimension<PrimitiveComparator, DistanceCheckedSetForLargeDataset>(dtype, dimension);
+  }
+}
+
+NeighborhoodGraph::Search::Method
+NeighborhoodGraph::Search::getMethodForObjectType(NGT::ObjectSpace::DistanceType dtype, NGT::ObjectSpace::ObjectType otype, size_t size)
+{
+  return getMethodFor<PrimitiveComparator>(dtype, otype, size, 0);
+}
+
+void
+SearchGraphRepository::clear()
+{
+  if (mappedAddress != 0) {
+    munmap(mappedAddress, mappedSize);
+    mappedAddress = 0;
+    mappedSize = 0;
+  }
+  offsetVector.clear();
+  offsetVector.shrink_to_fit();
+  edgeVector.clear();
+  edgeVector.shrink_to_fit();
+  offsets = 0;
+  edges = 0;
+  nodeSize = 0;
+  edgeSize = 0;
+  objects = 0;
+  objectVectors = 0;
+  objectVectorSize = 0;
+  compressed.clear();
+  clearVectors();
+}
+
+void
+SearchGraphRepository::clearVectors()
+{
+  if (vectorMappedAddress != 0) {
+    munmap(vectorMappedAddress, vectorMappedSize);
+    vectorMappedAddress = 0;
+    vectorMappedSize = 0;
+  }
+  vectors = 0;
+  vectorSize = 0;
+}
+
+void
+SearchGraphRepository::deserialize(std::ifstream &is, ObjectRepository &objectRepository)
+{
+  if (!is.is_open()) {
+    NGTThrowException("NGT::SearchGraph: Not open the specified stream yet.");
+  }
+  clear();
+  size_t s;
+  NGT::Serializer::read(is, s);
+  offsetVector.reserve(s + 1);
+  offsetVector.push_back(0);
+  for (size_t id = 0; id < s; id++) {
+    char type;
+    NGT::Serializer::read(is, type);
+    switch(type) {
+    case '-':
+      break;
+    case '+':
+      {
+	ObjectDistances node;
+	node.deserialize(is);
+#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+	for (auto ni = node.begin(); ni != node.end(); ni++) {
+	  std::cerr << "not implement" << std::endl;
+	  abort();
+	}
+#else
+	for (auto ni = node.begin(); ni != node.end(); ni++) {
+	  edgeVector.push_back((*ni).id);
+	}
+#endif
+      }
+      break;
+    default:
+      {
+	assert(type == '-' || type == '+');
+	break;
+      }
+    }
+    offsetVector.push_back(edgeVector.size());
+  }
+  edgeVector.shrink_to_fit();
+  offsets = offsetVector.data();
+  edges = edgeVector.data();
+  nodeSize = s;
+  edgeSize = edgeVector.size();
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  objects = objectRepository.getPtr();
+  // the empty graph has nothing to be moved, and its sgr layout is only the header.
+  if (HugePage::isEnabled(hugePage) && nodeSize != 0) {
+    // the graph is moved into the huge pages in the sgr layout.
+    size_t size = sizeof(uint64_t) * 2 + offsetVector.size() * sizeof(uint64_t) + edgeVector.size() * sizeof(ObjectID);
+    size_t allocatedSize = size;
+    void *addr = HugePage::allocate(allocatedSize, hugePage);
+    if (addr == MAP_FAILED) {
+      std::cerr << "SearchGraph: Warning. Cannot allocate the huge pages. " << strerror(errno) << std::endl;
+      return;
+    }
+    uint64_t *header = static_cast<uint64_t*>(addr);
+    header[0] = nodeSize;
+    header[1] = edgeSize;
+    memcpy(header + 2, offsetVector.data(), offsetVector.size() * sizeof(uint64_t));
+    memcpy(header + 2 + offsetVector.size(), edgeVector.data(), edgeVector.size() * sizeof(ObjectID));
+    if (!attach(addr, size, objectRepository.size())) {
+      HugePage::deallocate(addr, allocatedSize);
+      NGTThrowException("NGT::SearchGraph: Fatal error. The graph cannot be moved into the huge pages.");
+    }
+    mappedAddress = addr;
+    mappedSize = allocatedSize;
+    objects = objectRepository.getPtr();
+  }
+#endif
+}
+
+// maps the file, or reads it into the huge pages when they are enabled. the size is the file size and
+// is replaced with the size of the region.
+void *
+SearchGraphRepository::map(int fd, size_t &size)
+{
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  if (HugePage::isEnabled(hugePage)) {
+    return HugePage::read(fd, size, hugePage);
+  }
+#endif
+  return mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+}
+
+void
+SearchGraphRepository::serialize(std::ofstream &os)
+{
+  if (!os.is_open()) {
+    NGTThrowException("NGT::SearchGraph: Not open the specified stream yet.");
+  }
+  NGT::Serializer::write(os, nodeSize);
+  NGT::Serializer::write(os, edgeSize);
+  if (nodeSize == 0) {
+    return;
+  }
+  if (compressed.isOpen()) {
+    // the edges are decoded in the order of the IDs, because the original order is not kept.
+    uint64_t offset = 0;
+    os.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    for (size_t id = 0; id < nodeSize; id++) {
+      offset += compressed.getEdgeSize(id);
+      os.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    }
+    std::vector<ObjectID> ids(compressed.getBufferSize());
+    for (size_t id = 0; id < nodeSize; id++) {
+      size_t size = compressed.decode(id, ids.data());
+      os.write(reinterpret_cast<const char*>(ids.data()), size * sizeof(ObjectID));
+    }
+    return;
+  }
+  os.write(reinterpret_cast<const char*>(offsets), (nodeSize + 1) * sizeof(uint64_t));
+  os.write(reinterpret_cast<const char*>(edges), edgeSize * sizeof(ObjectID));
+}
+
+void
+SearchGraphRepository::serializeCompressed(std::ofstream &os, size_t truncation)
+{
+  if (!os.is_open()) {
+    NGTThrowException("NGT::SearchGraph: Not open the specified stream yet.");
+  }
+  if (compressed.isOpen()) {
+    CompressedGraph::serialize(os, nodeSize, truncation, [this](size_t id, std::vector<ObjectID> &ids) {
+	ids.resize(compressed.getBufferSize());
+	ids.resize(compressed.decode(id, ids.data()));
+      });
+  } else {
+    CompressedGraph::serialize(os, nodeSize, truncation, [this](size_t id, std::vector<ObjectID> &ids) {
+	ids.assign(edges + offsets[id], edges + offsets[id + 1]);
+      });
+  }
+}
+
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+void
+SearchGraphRepository::serializeCompressed(std::ofstream &os, GraphRepository &repository, size_t truncation)
+{
+  if (!os.is_open()) {
+    NGTThrowException("NGT::SearchGraph: Not open the specified stream yet.");
+  }
+  CompressedGraph::serialize(os, repository.size(), truncation, [&repository](size_t id, std::vector<ObjectID> &ids) {
+      if (repository[id] == 0) {
+	return;
+      }
+      for (auto ei = repository[id]->begin(); ei != repository[id]->end(); ++ei) {
+	ids.push_back((*ei).id);
+      }
+    });
+}
+#endif
+
+bool
+SearchGraphRepository::loadCompressed(const std::string &file, ObjectRepository &objectRepository)
+{
+#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  return false;
+#else
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  void *addr = map(fd, size);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "SearchGraph: Warning. Cannot map " << file << ". " << strerror(errno) << std::endl;
+    return false;
+  }
+  clear();
+  if (!compressed.attach(addr, st.st_size, objectRepository.size())) {
+    std::cerr << "SearchGraph: Warning. " << file << " is inconsistent with the index. Ignore it." << std::endl;
+    munmap(addr, size);
+    return false;
+  }
+  nodeSize = compressed.size();
+  edgeSize = compressed.getEdgeSize();
+  mappedAddress = addr;
+  mappedSize = size;
+  MemoryCache::advise(mappedAddress, mappedSize, MADV_WILLNEED);
+  objects = objectRepository.getPtr();
+  return true;
+#endif
+}
+
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+void
+SearchGraphRepository::serialize(std::ofstream &os, GraphRepository &repository)
+{
+  if (!os.is_open()) {
+    NGTThrowException("NGT::SearchGraph: Not open the specified stream yet.");
+  }
+  uint64_t nsize = repository.size();
+  uint64_t esize = 0;
+  for (size_t id = 0; id < repository.size(); id++) {
+    if (repository[id] != 0) {
+      esize += repository[id]->size();
+    }
+  }
+  NGT::Serializer::write(os, nsize);
+  NGT::Serializer::write(os, esize);
+  if (nsize == 0) {
+    return;
+  }
+  uint64_t offset = 0;
+  os.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+  for (size_t id = 0; id < repository.size(); id++) {
+    if (repository[id] != 0) {
+      offset += repository[id]->size();
+    }
+    os.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+  }
+  for (size_t id = 0; id < repository.size(); id++) {
+    if (repository[id] == 0) {
+      continue;
+    }
+    for (auto ei = repository[id]->begin(); ei != repository[id]->end(); ++ei) {
+      ObjectID eid = (*ei).id;
+      os.write(reinterpret_cast<const char*>(&eid), sizeof(eid));
+    }
+  }
+}
+#endif
+
+bool
+SearchGraphRepository::load(const std::string &file, ObjectRepository &objectRepository)
+{
+#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  return false;
+#else
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(uint64_t) * 2) {
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  void *addr = map(fd, size);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "SearchGraph: Warning. Cannot map " << file << ". " << strerror(errno) << std::endl;
+    return false;
+  }
+  if (!attach(addr, st.st_size, objectRepository.size())) {
+    std::cerr << "SearchGraph: Warning. " << file << " is inconsistent with the index. Ignore it." << std::endl;
+    munmap(addr, size);
+    return false;
+  }
+  mappedAddress = addr;
+  mappedSize = size;
+  MemoryCache::advise(mappedAddress, mappedSize, MADV_WILLNEED);
+  objects = objectRepository.getPtr();
+  return true;
+#endif
+}
+
+// the graph in the sgr layout at the specified address is used without copying. the address is not owned.
+bool
+SearchGraphRepository::attach(void *address, size_t size, size_t objectSize)
+{
+  if (size < sizeof(uint64_t) * 2) {
+    return false;
+  }
+  uint64_t *header = static_cast<uint64_t*>(address);
+  uint64_t nsize = header[0];
+  uint64_t esize = header[1];
+  size_t expectedSize = sizeof(uint64_t) * 2;
+  if (nsize != 0) {
+    expectedSize += (nsize + 1) * sizeof(uint64_t) + esize * sizeof(ObjectID);
+  }
+  if (expectedSize != size || nsize > objectSize) {
+    return false;
+  }
+  // the offsets and the edges are used as the indexes without any check during the search.
+  // an edge is also used as the index of the offsets, so that it must be less than the node size.
+  uint64_t *offsetArray = header + 2;
+  ObjectID *edgeArray = reinterpret_cast<ObjectID*>(offsetArray + nsize + 1);
+  if (nsize != 0) {
+    if (offsetArray[0] != 0 || offsetArray[nsize] != esize) {
+      return false;
+    }
+    for (size_t i = 0; i < nsize; i++) {
+      if (offsetArray[i] > offsetArray[i + 1]) {
+	return false;
+      }
+    }
+    for (size_t i = 0; i < esize; i++) {
+      if (edgeArray[i] >= nsize) {
+	return false;
+      }
+    }
+  }
+  clear();
+  nodeSize = nsize;
+  edgeSize = esize;
+  if (nodeSize != 0) {
+    offsets = offsetArray;
+    edges = edgeArray;
+  }
+  return true;
+}
+
+void
+SearchGraphRepository::writeVector(std::ofstream &os, ObjectSpace &objectSpace, ObjectID id)
+{
+  size_t size = getVectorSize(objectSpace);
+  if (objectSpace.getRepository().isEmpty(id)) {
+    std::vector<char> zero(size, 0);
+    os.write(zero.data(), size);
+  } else {
+    os.write(static_cast<const char*>(objectSpace.getObject(id)), size);
+  }
+}
+
+void
+SearchGraphRepository::serializeVectors(std::ofstream &os, ObjectSpace &objectSpace)
+{
+  if (!os.is_open()) {
+    NGTThrowException("NGT::SearchGraph: Not open the specified stream yet.");
+  }
+  uint64_t header[vectorHeaderSize / sizeof(uint64_t)] = {edgeSize, getVectorSize(objectSpace)};
+  os.write(reinterpret_cast<const char*>(header), sizeof(header));
+  for (size_t idx = 0; idx < edgeSize; idx++) {
+    writeVector(os, objectSpace, edges[idx]);
+  }
+}
+
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+void
+SearchGraphRepository::serializeVectors(std::ofstream &os, GraphRepository &repository, ObjectSpace &objectSpace)
+{
+  if (!os.is_open()) {
+    NGTThrowException("NGT::SearchGraph: Not open the specified stream yet.");
+  }
+  uint64_t esize = 0;
+  for (size_t id = 0; id < repository.size(); id++) {
+    if (repository[id] != 0) {
+      esize += repository[id]->size();
+    }
+  }
+  uint64_t header[vectorHeaderSize / sizeof(uint64_t)] = {esize, getVectorSize(objectSpace)};
+  os.write(reinterpret_cast<const char*>(header), sizeof(header));
+  for (size_t id = 0; id < repository.size(); id++) {
+    if (repository[id] == 0) {
+      continue;
+    }
+    for (auto ei = repository[id]->begin(); ei != repository[id]->end(); ++ei) {
+      writeVector(os, objectSpace, (*ei).id);
+    }
+  }
+}
+#endif
 
+bool
+SearchGraphRepository::loadVectors(const std::string &file, ObjectSpace &objectSpace)
+{
+  clearVectors();
+#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  return false;
+#else
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < vectorHeaderSize) {
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  void *addr = map(fd, size);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "SearchGraph: Warning. Cannot map " << file << ". " << strerror(errno) << std::endl;
+    return false;
+  }
+  uint64_t *header = static_cast<uint64_t*>(addr);
+  uint64_t esize = header[0];
+  uint64_t vsize = header[1];
+  if (esize != edgeSize || vsize != getVectorSize(objectSpace) ||
+      vectorHeaderSize + esize * vsize != static_cast<size_t>(st.st_size)) {
+    std::cerr << "SearchGraph: Warning. " << file << " is inconsistent with the graph. Ignore it." << std::endl;
+    munmap(addr, size);
+    return false;
+  }
+  vectorMappedAddress = addr;
+  vectorMappedSize = size;
+  MemoryCache::advise(vectorMappedAddress, vectorMappedSize, MADV_RANDOM);
+  vectors = static_cast<uint8_t*>(addr) + vectorHeaderSize;
+  vectorSize = vsize;
+  return true;
+#endif
+}
 
 #endif
 
@@ -311,11 +771,7 @@ NeighborhoodGraph::setupSeeds(NGT::SearchContainer &sc, ObjectDistances &seeds,
     }
 
   for (ObjectDistances::iterator ri = seeds.begin(); ri != seeds.end(); ri++) {
-#if !defined(NGT_GRAPH_CHECK_VECTOR) || defined(NGT_GRAPH_CHECK_BOOLEANSET)
     distanceChecked.insert((*ri).id);
-#else
-    distanceChecked[(*ri).id] = 1;
-#endif
     unchecked.push(*ri);
   }
 }
@@ -347,111 +803,31 @@ NeighborhoodGraph::setupSeeds(NGT::SearchContainer &sc, ObjectDistances &seeds,
 }
 #endif
 
-#ifdef NGT_GRAPH_READ_ONLY_GRAPH
-
-  template <typename COMPARATOR, typename CHECK_LIST>
   void
-    NeighborhoodGraph::searchReadOnlyGraph(NGT::SearchContainer &sc, ObjectDistances &seeds)
+    NeighborhoodGraph::search(NGT::SearchContainer &sc, ObjectDistances &seeds)
   {
-    if (sc.explorationCoefficient == 0.0) {
-      sc.explorationCoefficient = NGT_EXPLORATION_COEFFICIENT;
+#if defined(NGT_GRAPH_CHECK_BITSET)
+    DistanceCheckedSet distanceChecked(0);
+#elif defined(NGT_GRAPH_CHECK_BOOLEANSET)
+    DistanceCheckedSet distanceChecked(repository.size());
+#elif defined(NGT_GRAPH_CHECK_VECTOR)
+    // a stamp per node is not kept for each thread beyond the same size as the read-only graph search.
+    if (repository.size() >= 5000000) {
+      search(sc, seeds, getDistanceCheckedSet<DistanceCheckedSetForLargeDataset>(repository.size()));
+      return;
     }
-
-    // setup edgeSize
-    size_t edgeSize = getEdgeSize(sc);
-
-    UncheckedSet unchecked;
-
-    //DistanceCheckedSet distanceChecked(searchRepository.size());
-    CHECK_LIST distanceChecked(searchRepository.size());
-
-    ResultSet results;
-
-    setupDistances(sc, seeds, COMPARATOR::compare);
-    setupSeeds(sc, seeds, results, unchecked, distanceChecked);
-
-    Distance explorationRadius = sc.explorationCoefficient * sc.radius;
-    const size_t dimension = objectSpace->getPaddedDimension();
-    ReadOnlyGraphNode *nodes = &searchRepository.front();
-    ReadOnlyGraphNode *neighbors = 0;
-    ObjectDistance result;
-    ObjectDistance target;
-    const size_t prefetchSize = objectSpace->getPrefetchSize();
-    const size_t prefetchOffset = objectSpace->getPrefetchOffset();
-    pair<uint64_t, PersistentObject*> *neighborptr;
-    pair<uint64_t, PersistentObject*> *neighborendptr;
-    while (!unchecked.empty()) {
-      target = unchecked.top();
-      unchecked.pop();
-      if (target.distance > explorationRadius) {
-	break;
-      }
-      neighbors = &nodes[target.id];
-      neighborptr = &(*neighbors)[0];
-      size_t neighborSize = neighbors->size() < edgeSize ? neighbors->size() : edgeSize;
-      neighborendptr = neighborptr + neighborSize;
-
-      pair<uint64_t, PersistentObject*>* nsPtrs[neighborSize];
-      size_t nsPtrsSize = 0;
-
-      for (; neighborptr < neighborendptr; ++neighborptr) {
-       if (!distanceChecked[(*(neighborptr)).first]) {
-         nsPtrs[nsPtrsSize] = neighborptr;
-         if (nsPtrsSize < prefetchOffset) {
-           unsigned char *ptr = reinterpret_cast<unsigned char*>((*(neighborptr)).second);
-           MemoryCache::prefetch(ptr, prefetchSize);
-         }
-         nsPtrsSize++;
-       }
-      }
-      for (size_t idx = 0; idx < nsPtrsSize; idx++) {
-	neighborptr = nsPtrs[idx]; 
-	if (idx + prefetchOffset < nsPtrsSize) {
-	  unsigned char *ptr = reinterpret_cast<unsigned char*>((*(nsPtrs[idx + prefetchOffset])).second);
-	  MemoryCache::prefetch(ptr, prefetchSize);
-	}
-#ifdef NGT_VISIT_COUNT
-	sc.visitCount++;
-#endif
-	auto &neighbor = *neighborptr;
-        distanceChecked.insert(neighbor.first);
-
-#ifdef NGT_DISTANCE_COMPUTATION_COUNT
-	sc.distanceComputationCount++;
+    DistanceCheckedSet &distanceChecked = getDistanceCheckedSet<DistanceCheckedSet>(repository.size());
+#elif defined(NGT_GRAPH_CHECK_HASH_BASED_BOOLEAN_SET)
+    DistanceCheckedSet &distanceChecked = getDistanceCheckedSet<DistanceCheckedSet>(repository.size());
+#else 
+    DistanceCheckedSet distanceChecked;
 #endif
-
-	Distance distance = COMPARATOR::compare((void*)&sc.object[0], 
-						(void*)&(*static_cast<PersistentObject*>(neighbor.second))[0], dimension);
-
-	if (distance <= explorationRadius) {
-	  result.set(neighbor.first, distance);
-	  unchecked.push(result);
-	  if (distance <= sc.radius) {
-	    results.push(result);
-	    if (results.size() >= sc.size) {
-	      if (results.size() > sc.size) {
-	        results.pop();
-	      }
-	      sc.radius = results.top().distance;
-	      explorationRadius = sc.explorationCoefficient * sc.radius;
-	    } 
-	  } 
-	} 
-      } 
-    } 
-
-    if (sc.resultIsAvailable()) { 
-      ObjectDistances &qresults = sc.getResult();
-      qresults.moveFrom(results);
-    } else {
-      sc.workingResult = std::move(results);
-    }
+    search(sc, seeds, distanceChecked);
   }
 
-#endif
-
+  template <typename CHECK_LIST>
   void
-    NeighborhoodGraph::search(NGT::SearchContainer &sc, ObjectDistances &seeds)
+    NeighborhoodGraph::search(NGT::SearchContainer &sc, ObjectDistances &seeds, CHECK_LIST &distanceChecked)
   {
     if (sc.explorationCoefficient == 0.0) {
       sc.explorationCoefficient = NGT_EXPLORATION_COEFFICIENT;
@@ -460,20 +836,11 @@ NeighborhoodGraph::setupSeeds(NGT::SearchContainer &sc, ObjectDistances &seeds,
     // setup edgeSize
     size_t edgeSize = getEdgeSize(sc);
 
-    UncheckedSet unchecked;
-#if defined(NGT_GRAPH_CHECK_BITSET)
-    DistanceCheckedSet distanceChecked(0);
-#elif defined(NGT_GRAPH_CHECK_BOOLEANSET)
-    DistanceCheckedSet distanceChecked(repository.size());
-#elif defined(NGT_GRAPH_CHECK_HASH_BASED_BOOLEAN_SET)
-    DistanceCheckedSet distanceChecked(repository.size());
-#elif defined(NGT_GRAPH_CHECK_VECTOR)
-    DistanceCheckedSet distanceChecked(repository.size());
-#else 
-    DistanceCheckedSet distanceChecked;
-#endif
+    static thread_local UncheckedSet unchecked;
+    unchecked.clear();
 
-    ResultSet results;
+    static thread_local ResultSet results;
+    results.clear();
     setupDistances(sc, seeds);
     setupSeeds(sc, seeds, results, unchecked, distanceChecked);
     Distance explorationRadius = sc.explorationCoefficient * sc.radius;
@@ -587,8 +954,10 @@ NeighborhoodGraph::setupSeeds(NGT::SearchContainer &sc, ObjectDistances &seeds,
       qresults.clear();
       qresults.moveFrom(results);
     } else {
-      sc.workingResult = std::move(results);
+      sc.workingResult.swap(results);
     }
+    results.clear();
+    unchecked.clear();
   }
 
 
@@ -898,6 +1267,82 @@ public:
 
 typedef NGT::ThreadPool<TruncationSearchJob, TruncationSearchSharedData*, TruncationSearchThread> TruncationSearchThreadPool;
 
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+void
+NeighborhoodGraph::insertNodesInParallel(std::vector<std::pair<ObjectID, ObjectDistances*>> &nodes, size_t threadSize)
+{
+  bool onng = property.graphType == GraphTypeONNG;
+  if (onng && property.truncationThreshold != 0) {
+    std::stringstream msg;
+    msg << "NGT::insertNodesInParallel: truncation should be disabled!" << std::endl;
+    NGTThrowException(msg);
+  }
+  std::vector<size_t> reverseEdgeSize(nodes.size());
+  for (size_t i = 0; i < nodes.size(); i++) {
+    ObjectDistances &results = *nodes[i].second;
+    reverseEdgeSize[i] = results.size();
+    if (onng) {
+      if (static_cast<int>(results.size()) > property.incomingEdge) {
+	reverseEdgeSize[i] = property.incomingEdge;
+      }
+      ObjectDistances outgoing(results);
+      if (static_cast<int>(outgoing.size()) > property.outgoingEdge) {
+	outgoing.resize(property.outgoingEdge);
+      }
+      repository.insert(nodes[i].first, outgoing);
+    } else {
+      repository.insert(nodes[i].first, results);
+    }
+  }
+
+  std::vector<std::mutex> locks(NGT_GRAPH_INSERTION_LOCK_SIZE);
+  std::vector<ObjectID> truncationNodes;
+  // the flag is only polled to stop the other threads early. the message is guarded by the critical section.
+  std::atomic<bool> error(false);
+  std::string errorMessage;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(threadSize)
+#endif
+  for (size_t i = 0; i < nodes.size(); i++) {
+    ObjectID id = nodes[i].first;
+    ObjectDistances &results = *nodes[i].second;
+    for (size_t ri = 0; ri < reverseEdgeSize[i] && !error.load(std::memory_order_relaxed); ri++) {
+      assert(id != results[ri].id);
+      try {
+	bool truncation;
+	{
+	  std::lock_guard<std::mutex> lock(locks[results[ri].id % locks.size()]);
+	  truncation = addEdge(results[ri].id, id, results[ri].distance);
+	}
+	if (truncation) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+	  truncationNodes.push_back(results[ri].id);
+	}
+      } catch (Exception &err) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+	{
+	  error.store(true, std::memory_order_relaxed);
+	  errorMessage = err.what();
+	}
+      }
+    }
+  }
+  if (error) {
+    NGTThrowException(errorMessage);
+  }
+
+  std::sort(truncationNodes.begin(), truncationNodes.end());
+  truncationNodes.erase(std::unique(truncationNodes.begin(), truncationNodes.end()), truncationNodes.end());
+  for (auto tid = truncationNodes.begin(); tid != truncationNodes.end(); ++tid) {
+    truncateEdges(*tid);
+  }
+}
+#endif
+
 int
 NeighborhoodGraph::truncateEdgesOptimally(
 					  ObjectID id,
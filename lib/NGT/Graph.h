@@ -25,6 +25,8 @@
 
 
 #include	"NGT/HashBasedBooleanSet.h"
+#include	"NGT/EpochBasedBooleanSet.h"
+#include	"NGT/CompressedGraph.h"
 
 #ifndef NGT_GRAPH_CHECK_VECTOR
 #include	<unordered_set>
@@ -54,6 +56,26 @@
 #define NGT_CREATION_EDGE_SIZE			10
 #endif
 
+// the number of the striped locks for the parallel insertion of the edges.
+#ifndef NGT_GRAPH_INSERTION_LOCK_SIZE
+#define NGT_GRAPH_INSERTION_LOCK_SIZE		4096
+#endif
+
+// the largest capacity of the search heaps that is kept for each thread between searches.
+#ifndef NGT_SEARCH_RETAINED_CAPACITY
+#define NGT_SEARCH_RETAINED_CAPACITY		65536
+#endif
+
+// the number of the objects in a block of the distance matrix among the objects of a creation batch.
+#ifndef NGT_CREATION_DISTANCE_BLOCK_SIZE
+#define NGT_CREATION_DISTANCE_BLOCK_SIZE	32
+#endif
+
+// the number of the nodes in a chunk of the graph reconstruction, which bounds its working memory.
+#ifndef NGT_GRAPH_RECONSTRUCTION_CHUNK_SIZE
+#define NGT_GRAPH_RECONSTRUCTION_CHUNK_SIZE	1000000
+#endif
+
 namespace NGT {
   class Property;
 
@@ -156,6 +178,16 @@ namespace NGT {
       VECTOR::deserialize(is);      
       Serializer::read(is, *prevsize);
     }
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+    void permute(const std::vector<ObjectID> &order) {
+      VECTOR::permute(order);
+      std::vector<unsigned short> sizes(order.size(), 0);
+      for (size_t i = 1; i < order.size(); i++) {
+	sizes[i] = order[i] < prevsize->size() ? (*prevsize)[order[i]] : 0;
+      }
+      prevsize->swap(sizes);
+    }
+#endif
     void show() {
       for (size_t i = 0; i < this->size(); i++) {
 	std::cout << "Show graph " << i << " ";
@@ -183,71 +215,91 @@ namespace NGT {
     };
 
 #ifdef NGT_GRAPH_READ_ONLY_GRAPH
-    class ReadOnlyGraphNode : public std::vector<std::pair<uint64_t, PersistentObject*>> {
+    // SearchGraphRepository is a read-only graph in the CSR (compressed sparse row) layout.
+    // The edges of node i are edges[offsets[i]] ... edges[offsets[i + 1] - 1].
+    // The blob (sgr) consists of the header (node size and edge size), offsets and edges,
+    // and is mapped into memory directly.
+    // The optional inline vectors (sgv) are copies of the neighbor objects in the order of the edges.
+    // The neighbors of node i are vectors + offsets[i] * vectorSize ..., so that a node is expanded
+    // by streaming through one contiguous region instead of dereferencing each neighbor object.
+    // When the graph is in an index image, the objects are also the vectors in the image (objectVectors).
+    // When the compressed graph (sgc) is loaded instead of the sgr, the offsets and the edges are not available
+    // and the neighbors are decoded from the compressed graph.
+    class SearchGraphRepository {
     public:
-      ReadOnlyGraphNode():reservedSize(0), usedSize(0) {}
-      void reserve(size_t s) {
-	reservedSize = ((s & 7) == 0) ? s : (s & 0xFFFFFFFFFFFFFFF8) + 8;
-	resize(reservedSize);
-	for (size_t i = (reservedSize & 0xFFFFFFFFFFFFFFF8); i < reservedSize; i++) {
-	  (*this)[i].first = 0;
-	}
+      SearchGraphRepository():offsets(0), edges(0), nodeSize(0), edgeSize(0), objects(0),
+	vectors(0), vectorSize(0), objectVectors(0), objectVectorSize(0),
+	mappedAddress(0), mappedSize(0), vectorMappedAddress(0), vectorMappedSize(0), hugePage(HugePage::ModeDisabled) {}
+      ~SearchGraphRepository() { clear(); }
+
+      size_t size() { return nodeSize; }
+      bool empty() { return nodeSize == 0; }
+      bool isEmpty(size_t idx) { return idx >= nodeSize || getEdgeSize(idx) == 0; }
+      ObjectID *getEdges(size_t idx) { return edges + offsets[idx]; }
+      size_t getEdgeSize(size_t idx) {
+	return compressed.isOpen() ? compressed.getEdgeSize(idx) : offsets[idx + 1] - offsets[idx];
       }
-      void push_back(std::pair<uint32_t, PersistentObject*> node) {
-	(*this)[usedSize] = node;
-	usedSize++;
+      bool isCompressed() { return compressed.isOpen(); }
+      void setObjects(PersistentObject **objs) { objects = objs; }
+      bool hasVectors() { return vectors != 0; }
+      uint8_t *getVectors(size_t idx) { return vectors + offsets[idx] * vectorSize; }
+      void setObjectVectors(uint8_t *v, size_t size) { objectVectors = v; objectVectorSize = size; }
+      bool hasObjectVectors() { return objectVectors != 0; }
+      uint8_t *getObjectVector(size_t idx) { return objectVectors + idx * objectVectorSize; }
+      void setHugePage(HugePage::Mode mode) {
+	if (mode != HugePage::ModeNone) {
+	  hugePage = mode;
+	}
       }
-      size_t size() { return usedSize; }
-      size_t reservedSize;
-      size_t usedSize;
-    };
 
-    class SearchGraphRepository : public std::vector<ReadOnlyGraphNode> {
-    public:
-      SearchGraphRepository() {}
-      bool isEmpty(size_t idx) { return (*this)[idx].empty(); }
-
-      void deserialize(std::ifstream &is, ObjectRepository &objectRepository) {
-	if (!is.is_open()) {
-	  NGTThrowException("NGT::SearchGraph: Not open the specified stream yet.");
-	}
-	clear();
-	size_t s;
-	NGT::Serializer::read(is, s);
-	resize(s);
-	for (size_t id = 0; id < s; id++) {
-	  char type;
-	  NGT::Serializer::read(is, type);
-	  switch(type) {
-	  case '-':
-	    break;
-	  case '+':
-	    {
-	      ObjectDistances node;
-	      node.deserialize(is);
-	      ReadOnlyGraphNode &searchNode = at(id);
-	      searchNode.reserve(node.size());
-#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
-	      for (auto ni = node.begin(); ni != node.end(); ni++) {
-		std::cerr << "not implement" << std::endl;
-		abort();
-	      }
-#else
-	      for (auto ni = node.begin(); ni != node.end(); ni++) {
-		searchNode.push_back(std::pair<uint32_t, Object*>((*ni).id, objectRepository.get((*ni).id)));
-	      }
+      void clear();
+      void clearVectors();
+      void deserialize(std::ifstream &is, ObjectRepository &objectRepository);
+      void serialize(std::ofstream &os);
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+      static void serialize(std::ofstream &os, GraphRepository &repository);
 #endif
-	    }
-	    break;
-	  default:
-	    {
-	      assert(type == '-' || type == '+');
-	      break;
-	    }
-	  }
-	}
+      bool load(const std::string &file, ObjectRepository &objectRepository);
+      bool attach(void *address, size_t size, size_t objectSize);
+      void serializeVectors(std::ofstream &os, ObjectSpace &objectSpace);
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+      static void serializeVectors(std::ofstream &os, GraphRepository &repository, ObjectSpace &objectSpace);
+#endif
+      bool loadVectors(const std::string &file, ObjectSpace &objectSpace);
+      void serializeCompressed(std::ofstream &os, size_t truncation);
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+      static void serializeCompressed(std::ofstream &os, GraphRepository &repository, size_t truncation);
+#endif
+      bool loadCompressed(const std::string &file, ObjectRepository &objectRepository);
+      void *map(int fd, size_t &size);
+      size_t prefault(size_t threadSize = 0) {
+	return MemoryCache::prefault(mappedAddress, mappedSize, threadSize) +
+	  MemoryCache::prefault(vectorMappedAddress, vectorMappedSize, threadSize);
+      }
+      static size_t getVectorSize(ObjectSpace &objectSpace) {
+	return objectSpace.getPaddedDimension() * objectSpace.getSizeOfElement();
       }
 
+      uint64_t		*offsets;
+      ObjectID		*edges;
+      uint64_t		nodeSize;
+      uint64_t		edgeSize;
+      PersistentObject	**objects;
+      uint8_t		*vectors;
+      uint64_t		vectorSize;
+      uint8_t		*objectVectors;
+      uint64_t		objectVectorSize;
+      CompressedGraph	compressed;
+    protected:
+      static const size_t	vectorHeaderSize = 64;
+      static void writeVector(std::ofstream &os, ObjectSpace &objectSpace, ObjectID id);
+      void			*mappedAddress;
+      size_t			mappedSize;
+      void			*vectorMappedAddress;
+      size_t			vectorMappedSize;
+      HugePage::Mode		hugePage;	// the files are read into the huge pages instead of being mapped.
+      std::vector<uint64_t>	offsetVector;
+      std::vector<ObjectID>	edgeVector;
     };
 
 #endif // NGT_GRAPH_READ_ONLY_GRAPH
@@ -275,7 +327,24 @@ namespace NGT {
 #ifdef NGT_GRAPH_READ_ONLY_GRAPH
       class Search {
       public:
-	static void (*getMethod(NGT::ObjectSpace::DistanceType dtype, NGT::ObjectSpace::ObjectType otype, size_t size))(NGT::NeighborhoodGraph&, NGT::SearchContainer&, NGT::ObjectDistances&)  {
+	typedef void (*Method)(NGT::NeighborhoodGraph&, NGT::SearchContainer&, NGT::ObjectDistances&);
+
+	static void (*getMethod(NGT::ObjectSpace::DistanceType dtype, NGT::ObjectSpace::ObjectType otype, size_t size, size_t dimension = 0))(NGT::NeighborhoodGraph&, NGT::SearchContainer&, NGT::ObjectDistances&)  {
+#if defined(NGT_RUNTIME_DISPATCH)
+	  switch (CpuInfo::getSimdLevel()) {
+	  case CpuInfo::SimdLevelAVX512: return getMethodForAVX512(dtype, otype, size, dimension);
+	  case CpuInfo::SimdLevelAVX2:	 return getMethodForAVX2(dtype, otype, size, dimension);
+	  default: break;
+	  }
+#endif
+	  if (otype == NGT::ObjectSpace::Float) {
+	    Method method = getMethodForDimension(dtype, size, dimension);
+	    if (method != 0) {
+	      return method;
+	    }
+	  } else if (otype == NGT::ObjectSpace::Float16 || otype == NGT::ObjectSpace::Qint8) {
+	    return getMethodForObjectType(dtype, otype, size);
+	  }
 	  if (size < 5000000) {
 	    switch (otype) {
 	    default:
@@ -350,6 +419,25 @@ namespace NGT {
 	static void normalizedCosineSimilarityFloatForLargeDataset(NeighborhoodGraph &graph, NGT::SearchContainer &sc, ObjectDistances &seeds);
 	static void normalizedAngleFloatForLargeDataset(NeighborhoodGraph &graph, NGT::SearchContainer &sc, ObjectDistances &seeds);
 
+	// return the float search specialized for the padded dimension, or 0 if there is no specialization.
+	static Method getMethodForDimension(NGT::ObjectSpace::DistanceType dtype, size_t size, size_t dimension);
+	static Method getMethodForObjectType(NGT::ObjectSpace::DistanceType dtype, NGT::ObjectSpace::ObjectType otype, size_t size);
+#if defined(NGT_RUNTIME_DISPATCH)
+	static Method getMethodForAVX2(NGT::ObjectSpace::DistanceType dtype, NGT::ObjectSpace::ObjectType otype, size_t size, size_t dimension);
+	static Method getMethodForAVX512(NGT::ObjectSpace::DistanceType dtype, NGT::ObjectSpace::ObjectType otype, size_t size, size_t dimension);
+#endif
+
+	// the templates below are defined in ReadOnlyGraphSearch.h.
+	template <typename PRIMITIVE_COMPARATOR>
+	  static Method getMethodFor(NGT::ObjectSpace::DistanceType dtype, NGT::ObjectSpace::ObjectType otype, size_t size, size_t dimension);
+	template <typename PRIMITIVE_COMPARATOR, typename CHECK_LIST>
+	  static Method getMethodFor(NGT::ObjectSpace::DistanceType dtype, NGT::ObjectSpace::ObjectType otype, size_t dimension);
+	template <typename PRIMITIVE_COMPARATOR, typename CHECK_LIST>
+	  static Method getMethodForDimension(NGT::ObjectSpace::DistanceType dtype, size_t dimension);
+	template <typename PRIMITIVE_COMPARATOR, size_t DIMENSION, typename CHECK_LIST>
+	  static Method getMethodForFixedDimension(NGT::ObjectSpace::DistanceType dtype);
+	template <typename COMPARATOR, typename CHECK_LIST>
+	  static void searchWith(NeighborhoodGraph &graph, NGT::SearchContainer &sc, ObjectDistances &seeds);
       };
 #endif
 
@@ -534,6 +622,16 @@ namespace NGT {
 	}
       }
 
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+      // inserts the nodes of a batch. The nodes themselves are inserted serially because the repository
+      // may be extended, and then the reverse edges are added in parallel while each target node is locked
+      // with a striped lock. Nodes that need truncation are truncated serially at the end.
+      void insertNodesInParallel(std::vector<std::pair<ObjectID, ObjectDistances*>> &nodes, size_t threadSize);
+      bool isParallelInsertionAvailable() {
+	return property.graphType == GraphTypeANNG || property.graphType == GraphTypeONNG;
+      }
+#endif
+
       void insertBKNNGNode(ObjectID id, ObjectDistances &results) {
 	if (repository.isEmpty(id)) {
 	  repository.insert(id, results);
@@ -660,6 +758,7 @@ namespace NGT {
       }
 
       void search(NGT::SearchContainer &sc, ObjectDistances &seeds);
+      template <typename CHECK_LIST> void search(NGT::SearchContainer &sc, ObjectDistances &seeds, CHECK_LIST &distanceChecked);
 
 #ifdef NGT_GRAPH_READ_ONLY_GRAPH
       template <typename COMPARATOR, typename CHECK_LIST> void searchReadOnlyGraph(NGT::SearchContainer &sc, ObjectDistances &seeds);
@@ -716,24 +815,33 @@ namespace NGT {
 	repository.erase(id);
       }
 
-      class BooleanVector : public std::vector<bool> {
+      // ReusablePriorityQueue keeps the capacity of the container after clear() so that it can be reused across searches.
+      template <typename TYPE, typename COMPARE>
+      class ReusablePriorityQueue : public std::priority_queue<TYPE, std::vector<TYPE>, COMPARE> {
       public:
-        inline BooleanVector(size_t s):std::vector<bool>(s, false) {}
-	inline void insert(size_t i) { std::vector<bool>::operator[](i) = true; }
+	// the storage grown by an exceptionally large search is released instead of being kept by the thread.
+	void clear() {
+	  if (this->c.capacity() > NGT_SEARCH_RETAINED_CAPACITY) {
+	    std::vector<TYPE>().swap(this->c);
+	  } else {
+	    this->c.clear();
+	  }
+	}
+	void reserve(size_t s) { this->c.reserve(s); }
       };
 
 #ifdef NGT_GRAPH_VECTOR_RESULT
       typedef ObjectDistances ResultSet;
 #else
-      typedef std::priority_queue<ObjectDistance, std::vector<ObjectDistance>, std::less<ObjectDistance> > ResultSet;
+      typedef ReusablePriorityQueue<ObjectDistance, std::less<ObjectDistance> > ResultSet;
 #endif
 
 #if defined(NGT_GRAPH_CHECK_BOOLEANSET)
       typedef BooleanSet DistanceCheckedSet;
 #elif defined(NGT_GRAPH_CHECK_VECTOR)
-      typedef BooleanVector DistanceCheckedSet;
+      typedef EpochBasedBooleanSet DistanceCheckedSet;
 #elif defined(NGT_GRAPH_CHECK_HASH_BASED_BOOLEAN_SET)
-      typedef HashBasedBooleanSet DistanceCheckedSet;
+      typedef EpochBasedHashSet DistanceCheckedSet;
 #else
       class DistanceCheckedSet : public unordered_set<ObjectID> {
       public:
@@ -741,7 +849,14 @@ namespace NGT {
       };
 #endif
 
-      typedef HashBasedBooleanSet DistanceCheckedSetForLargeDataset;
+      typedef EpochBasedHashSet DistanceCheckedSetForLargeDataset;
+
+      // The checked set is kept for each thread and is cleared in constant time for every query.
+      template <typename CHECK_LIST> static CHECK_LIST &getDistanceCheckedSet(size_t size) {
+	static thread_local CHECK_LIST distanceChecked;
+	distanceChecked.clear(size);
+	return distanceChecked;
+      }
 
       class NodeWithPosition : public ObjectDistance {
        public:
@@ -757,12 +872,15 @@ namespace NGT {
       };
 
 #ifdef NGT_GRAPH_UNCHECK_STACK
-      typedef std::stack<ObjectDistance> UncheckedSet;
+      class UncheckedSet : public std::stack<ObjectDistance, std::vector<ObjectDistance> > {
+      public:
+	void clear() { this->c.clear(); }
+      };
 #else
 #ifdef NGT_GRAPH_BETTER_FIRST_RESTORE
-      typedef std::priority_queue<NodeWithPosition, std::vector<NodeWithPosition>, std::greater<NodeWithPosition> > UncheckedSet;
+      typedef ReusablePriorityQueue<NodeWithPosition, std::greater<NodeWithPosition> > UncheckedSet;
 #else
-      typedef std::priority_queue<ObjectDistance, std::vector<ObjectDistance>, std::greater<ObjectDistance> > UncheckedSet;
+      typedef ReusablePriorityQueue<ObjectDistance, std::greater<ObjectDistance> > UncheckedSet;
 #endif
 #endif
       void setupDistances(NGT::SearchContainer &sc, ObjectDistances &seeds);
@@ -906,8 +1024,14 @@ namespace NGT {
 
 #ifdef NGT_GRAPH_READ_ONLY_GRAPH
       void loadSearchGraph(const std::string &database) {
-	std::ifstream isg(database + "/grp");
-	NeighborhoodGraph::searchRepository.deserialize(isg, NeighborhoodGraph::getObjectRepository());
+	if (searchRepository.loadCompressed(database + "/sgc", NeighborhoodGraph::getObjectRepository())) {
+	  return;
+	}
+	if (!searchRepository.load(database + "/sgr", NeighborhoodGraph::getObjectRepository())) {
+	  std::ifstream isg(database + "/grp");
+	  NeighborhoodGraph::searchRepository.deserialize(isg, NeighborhoodGraph::getObjectRepository());
+	}
+	searchRepository.loadVectors(database + "/sgv", *objectSpace);
       }
 #endif
 
@@ -0,0 +1,33 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include	"defines.h"
+#include	"Graph.h"
+
+#if defined(NGT_RUNTIME_DISPATCH) && defined(NGT_GRAPH_READ_ONLY_GRAPH)
+
+#pragma GCC push_options
+#pragma GCC target("avx2,f16c,popcnt")
+#include	"ReadOnlyGraphSearch.h"
+
+NGT::NeighborhoodGraph::Search::Method
+NGT::NeighborhoodGraph::Search::getMethodForAVX2(NGT::ObjectSpace::DistanceType dtype, NGT::ObjectSpace::ObjectType otype, size_t size, size_t dimension)
+{
+  return getMethodFor<NGT::avx2::PrimitiveComparator>(dtype, otype, size, dimension);
+}
+#pragma GCC pop_options
+
+#endif
@@ -0,0 +1,289 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include	"NGT/Index.h"
+#include	"NGT/GraphReconstructor.h"
+
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+
+namespace NGT {
+
+// GraphMerger merges indexes that are built independently into one index without rebuilding the graph.
+// The objects of a shard are copied to the index as is in the order of their IDs except for the removed ones
+// and the ones that are not in the graph, and the graph of the shard is copied with the remapped IDs. Then, each node of both sides searches the
+// graph of the other side for its neighbors in parallel, and the neighbors that are within its nearest
+// edgeSizeForCreation nodes are linked. For ANNG, the reverse edges of them are also linked, and the nodes
+// that exceed the truncation threshold are truncated as in the insertion.
+class GraphMerger {
+ public:
+  // newIDs[id] is the ID of the object id of the shard in the merged index.
+  static void
+    merge(NGT::Index &index, NGT::Index &shard, size_t threadSize, std::vector<ObjectID> &newIDs)
+  {
+#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+    NGTThrowException("GraphMerger: Not implemented for the shared memory option.");
+#else
+    GraphIndex &graphIndex = static_cast<GraphIndex&>(index.getIndex());
+    GraphIndex &shardIndex = static_cast<GraphIndex&>(shard.getIndex());
+    checkProperties(graphIndex, shardIndex);
+    NeighborhoodGraph::Property &graphProperty = graphIndex.getGraphProperty();
+    ObjectRepository &objects = graphIndex.getObjectSpace().getRepository();
+    ObjectRepository &shardObjects = shardIndex.getObjectSpace().getRepository();
+    size_t k = graphProperty.edgeSizeForCreation;
+    int threads = GraphReconstructor::getNumberOfThreads(threadSize);
+
+    // search each side for the neighbors of the other side before the index is modified.
+    std::vector<ObjectID> ids;
+    size_t unlinked = 0;
+    for (size_t id = 1; id < objects.size(); id++) {
+      if (!objects.isEmpty(id)) {
+	if (graphIndex.repository.isEmpty(id)) {
+	  unlinked++;
+	} else {
+	  ids.push_back(id);
+	}
+      }
+    }
+    if (unlinked != 0) {
+      std::cerr << "GraphMerger: Warning. " << unlinked << " objects of the index are not in the graph and are not linked."
+		<< " Build the index before the merge." << std::endl;
+    }
+    std::vector<ObjectID> shardIDs;
+    size_t skipped = 0;
+    for (size_t id = 1; id < shardObjects.size(); id++) {
+      if (!shardObjects.isEmpty(id)) {
+	if (shardIndex.repository.isEmpty(id)) {
+	  skipped++;
+	} else {
+	  shardIDs.push_back(id);
+	}
+      }
+    }
+    if (skipped != 0) {
+      std::cerr << "GraphMerger: Warning. " << skipped << " objects of the shard are not in the graph and are skipped."
+		<< " Build the index of the shard before the merge." << std::endl;
+    }
+    std::vector<ObjectDistances> neighbors(ids.size());
+    searchNeighbors(index, shard, ids, graphProperty, threads, neighbors);
+    std::vector<ObjectDistances> shardNeighbors(shardIDs.size());
+    searchNeighbors(shard, index, shardIDs, graphProperty, threads, shardNeighbors);
+
+    // append the objects of the shard. they are copied as is, because the conversion through float is lossy.
+    newIDs.assign(shardObjects.size(), 0);
+    if (objects.size() == 0) {
+      objects.initialize();
+    }
+    objects.reserve(objects.size() + shardIDs.size());
+    for (size_t i = 0; i < shardIDs.size(); i++) {
+      objects.push_back(objects.copyPersistentObject(*shardObjects.get(shardIDs[i])));
+      newIDs[shardIDs[i]] = objects.size() - 1;
+    }
+
+    // copy the graph of the shard.
+    for (size_t i = 0; i < shardIDs.size(); i++) {
+      ObjectDistances node = static_cast<ObjectDistances>(*shardIndex.getNode(shardIDs[i]));
+      size_t last = 0;
+      for (size_t ni = 0; ni < node.size(); ni++) {
+	if (node[ni].id < newIDs.size() && newIDs[node[ni].id] != 0) {
+	  node[last] = node[ni];
+	  node[last++].id = newIDs[node[ni].id];
+	}
+      }
+      node.resize(last);
+      graphIndex.repository.insert(newIDs[shardIDs[i]], node);
+    }
+    for (size_t i = 0; i < ids.size(); i++) {
+      for (auto &n : neighbors[i]) {
+	n.id = newIDs[n.id];
+      }
+    }
+
+    // link the neighbors on the other side.
+    std::vector<ObjectDistances> linked(ids.size() + shardIDs.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+#endif
+    for (size_t i = 0; i < linked.size(); i++) {
+      ObjectID id = i < ids.size() ? ids[i] : newIDs[shardIDs[i - ids.size()]];
+      ObjectDistances &candidates = i < ids.size() ? neighbors[i] : shardNeighbors[i - ids.size()];
+      linkNeighbors(*graphIndex.getNode(id), candidates, k, graphProperty.graphType, linked[i]);
+    }
+    if (graphProperty.graphType == NeighborhoodGraph::GraphTypeANNG) {
+      for (size_t i = 0; i < linked.size(); i++) {
+	ObjectID id = i < ids.size() ? ids[i] : newIDs[shardIDs[i - ids.size()]];
+	for (auto &n : linked[i]) {
+	  graphIndex.getNode(n.id)->push_back(ObjectDistance(id, n.distance));
+	}
+      }
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads)
+#endif
+      for (size_t id = 1; id < graphIndex.repository.size(); id++) {
+	if (!graphIndex.repository.isEmpty(id)) {
+	  normalizeEdges(*graphIndex.getNode(id));
+	}
+      }
+      if (graphProperty.truncationThreshold > 0) {
+	for (size_t id = 1; id < graphIndex.repository.size(); id++) {
+	  if (graphIndex.repository.isEmpty(id)) {
+	    continue;
+	  }
+	  size_t minsize = 0;
+	  GraphNode &node = *graphIndex.getNode(id, minsize);
+	  if (node.size() - minsize > (size_t)graphProperty.truncationThreshold) {
+	    graphIndex.truncateEdges(id);
+	  }
+	}
+      }
+    }
+
+    GraphAndTreeIndex *tree = dynamic_cast<GraphAndTreeIndex*>(&graphIndex);
+    if (tree != 0) {
+      for (size_t i = 0; i < shardIDs.size(); i++) {
+	ObjectID id = newIDs[shardIDs[i]];
+	DVPTree::InsertContainer tiobj(*objects.get(id), id);
+	try {
+	  tree->DVPTree::insert(tiobj);
+	} catch (Exception &err) {
+	  std::cerr << "GraphMerger: Warning. Cannot insert into the tree. ID=" << id << ":" << err.what() << std::endl;
+	}
+      }
+    }
+    // the objects of the shard get the new original IDs, when the index has been reordered.
+    index.updateOriginalIDs();
+#endif
+  }
+
+  // merge the indexes into the output index. the IDs of the objects of the first index are kept.
+  static void
+    merge(const std::vector<std::string> &indexPaths, const std::string &outIndexPath, size_t threadSize = 0)
+  {
+    if (indexPaths.size() < 2) {
+      NGTThrowException("GraphMerger: Specify two or more indexes.");
+    }
+    NGT::Index index(indexPaths[0]);
+    for (size_t i = 1; i < indexPaths.size(); i++) {
+      NGT::Index shard(indexPaths[i]);
+      std::vector<ObjectID> newIDs;
+      merge(index, shard, threadSize, newIDs);
+    }
+    index.saveIndex(outIndexPath);
+  }
+
+ protected:
+  static void
+    checkProperties(GraphIndex &index, GraphIndex &shard)
+  {
+    NGT::Property p1, p2;
+    index.getProperty(p1);
+    shard.getProperty(p2);
+    if (p1.dimension != p2.dimension || p1.objectType != p2.objectType || p1.distanceType != p2.distanceType) {
+      NGTThrowException("GraphMerger: The dimensions, the object types or the distance types are not the same.");
+    }
+    if (p1.objectType == ObjectSpace::ObjectType::Qint8) {
+      // the codes of the shard cannot be copied, because the ranges of the quantizers are different.
+      NGTThrowException("GraphMerger: The scalar quantized objects cannot be merged. Build the index with all of the objects.");
+    }
+    NeighborhoodGraph::GraphType type = index.getGraphProperty().graphType;
+    if (type != shard.getGraphProperty().graphType) {
+      NGTThrowException("GraphMerger: The graph types are not the same.");
+    }
+    if (type != NeighborhoodGraph::GraphTypeANNG && type != NeighborhoodGraph::GraphTypeKNNG) {
+      NGTThrowException("GraphMerger: Only ANNG and KNNG can be merged. Reconstruct the graph after the merge.");
+    }
+  }
+
+  // search the index for the neighbors of the objects of the other index.
+  static void
+    searchNeighbors(NGT::Index &queryIndex, NGT::Index &index, std::vector<ObjectID> &ids,
+		    NeighborhoodGraph::Property &property, int threads, std::vector<ObjectDistances> &neighbors)
+  {
+    ObjectSpace &objectSpace = queryIndex.getObjectSpace();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+#endif
+    for (size_t i = 0; i < ids.size(); i++) {
+      std::vector<float> v;
+      objectSpace.getObject(ids[i], v);
+      Object *query = index.allocateObject(v);
+      NGT::SearchContainer sc(*query);
+      sc.setResults(&neighbors[i]);
+      sc.size = property.edgeSizeForCreation;
+      sc.radius = FLT_MAX;
+      sc.explorationCoefficient = property.insertionRadiusCoefficient;
+      try {
+	index.search(sc);
+      } catch (Exception &err) {
+	std::cerr << "GraphMerger: Warning. Cannot search. ID=" << ids[i] << ":" << err.what() << std::endl;
+      }
+      index.deleteObject(query);
+    }
+  }
+
+  // add the candidates that are within the nearest k nodes to the node. the added ones are set to linked.
+  static void
+    linkNeighbors(GraphNode &node, ObjectDistances &candidates, size_t k, NeighborhoodGraph::GraphType type,
+		  ObjectDistances &linked)
+  {
+    linked.clear();
+    normalizeEdges(node);
+    ObjectDistances merged;
+    merged.reserve(node.size() + candidates.size());
+    std::merge(node.begin(), node.end(), candidates.begin(), candidates.end(), std::back_inserter(merged));
+    Distance threshold = merged.size() < k ? FLT_MAX : merged[k - 1].distance;
+    for (auto &c : candidates) {
+      if (c.distance <= threshold && linked.size() < k) {
+	linked.push_back(c);
+      }
+    }
+    if (type == NeighborhoodGraph::GraphTypeKNNG) {
+      merged.resize(std::min(merged.size(), k));
+      node = merged;
+      return;
+    }
+    node.insert(node.end(), linked.begin(), linked.end());
+    normalizeEdges(node);
+  }
+
+  // sort the edges and remove the duplicated ones. the nearest one of the same IDs is kept.
+  static void
+    normalizeEdges(GraphNode &node)
+  {
+    std::sort(node.begin(), node.end(), [](const ObjectDistance &a, const ObjectDistance &b) {
+	return a.id == b.id ? a.distance < b.distance : a.id < b.id;
+      });
+    ObjectID prev = 0;
+    size_t last = 0;
+    for (size_t i = 0; i < node.size(); i++) {
+      if (prev == node[i].id) {
+	continue;
+      }
+      prev = node[i].id;
+      node[last++] = node[i];
+    }
+    node.resize(last);
+    std::sort(node.begin(), node.end());
+    GraphNode tmp = node;
+    node.swap(tmp);
+  }
+
+};
+
+}; // NGT
+
+#endif // !NGT_SHARED_MEMORY_ALLOCATOR
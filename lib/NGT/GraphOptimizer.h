@@ -46,6 +46,7 @@ namespace NGT {
       gtEpsilon = 0.1;
       margin = 0.2;
       logDisabled = false;
+      numOfThreads = 0;
     }
 
     void adjustSearchCoefficients(const std::string indexPath){
@@ -225,18 +226,25 @@ namespace NGT {
 	NGT::StdOstreamRedirector redirector(logDisabled);
 	redirector.begin();
 	try {
-	  std::cerr << "Optimizer::execute: Extract the graph data." << std::endl;
-	  // extract only edges from the index to reduce the memory usage.
-	  NGT::GraphReconstructor::extractGraph(graph, outIndex);
 	  if (numOfOutgoingEdges >= 0) {
+#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+	    std::cerr << "Optimizer::execute: Extract the graph data." << std::endl;
+	    // extract only edges from the index to reduce the memory usage.
+	    NGT::GraphReconstructor::extractGraph(graph, outIndex);
 	    NGT::GraphReconstructor::convertToANNG(graph);
 	    NGT::GraphReconstructor::reconstructGraph(graph, outIndex, numOfOutgoingEdges, numOfIncomingEdges);
+	    std::vector<NGT::ObjectDistances>().swap(graph);
+#else
+	    // reconstruct the graph in place chunk by chunk not to hold a copy of the graph.
+	    NGT::GraphReconstructor::reconstructGraphInChunks(outIndex, numOfOutgoingEdges, numOfIncomingEdges, true,
+							      NGT_GRAPH_RECONSTRUCTION_CHUNK_SIZE, numOfThreads);
+#endif
 	  }
 	  timer.stop();
 	  std::cerr << "Optimizer::execute: Graph reconstruction time=" << timer.time << " (sec) " << std::endl;
 	  timer.reset();
 	  timer.start();
-	  NGT::GraphReconstructor::adjustPathsEffectively(outIndex);
+	  NGT::GraphReconstructor::adjustPathsEffectively(outIndex, numOfThreads);
 	  timer.stop();
 	  std::cerr << "Optimizer::execute: Path adjustment time=" << timer.time << " (sec) " << std::endl;
 	} catch (NGT::Exception &err) {
@@ -315,6 +323,9 @@ namespace NGT {
       }
     }
 
+    // the number of the threads for the path adjustment. 0 means the default of OpenMP.
+    void setNumOfThreads(size_t n) { numOfThreads = n; }
+
     size_t numOfOutgoingEdges;
     size_t numOfIncomingEdges;
     std::pair<float, float> baseAccuracyRange;
@@ -323,6 +334,7 @@ namespace NGT {
     double gtEpsilon;
     double margin;
     bool logDisabled;
+    size_t numOfThreads;
   };
 
 }; // NGT
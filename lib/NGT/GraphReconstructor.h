@@ -19,6 +19,9 @@
 #include	<unordered_map>
 #include	<unordered_set>
 #include	<list>
+#include	<cstdio>
+#include	<cstdlib>
+#include	<unistd.h>
 
 #ifdef _OPENMP
 #include	<omp.h>
@@ -47,7 +50,7 @@ class GraphReconstructor {
         }
 	graph.push_back(nd);
 #else
-	graph.push_back(node);
+	graph.push_back(static_cast<NGT::ObjectDistances>(node));
 #endif
 	if (graph.back().size() != graph.back().capacity()) {
 	  std::cerr << "GraphReconstructor::extractGraph: Warning! The graph size must be the same as the capacity. " << id << std::endl;
@@ -63,50 +66,71 @@ class GraphReconstructor {
 
 
 
+  // 0 means the default number of the OpenMP threads.
+  static int getNumberOfThreads(size_t threadSize) {
+#ifdef _OPENMP
+    return threadSize == 0 ? omp_get_max_threads() : static_cast<int>(threadSize);
+#else
+    return 1;
+#endif
+  }
+
+  // whether the first size edges of the node have the edge to the specified node.
+  static bool hasEdge(NGT::GraphIndex &graph, size_t idx, size_t size, uint32_t id) {
+    NGT::GraphNode &node = *graph.getNode(idx + 1);
+    for (size_t i = 0; i < size; i++) {
+#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+      if (node.at(i, graph.repository.allocator).id == id) {
+#else
+      if (node[i].id == id) {
+#endif
+	return true;
+      }
+    }
+    return false;
+  }
+
   static void 
-    adjustPaths(NGT::Index &outIndex)
+    adjustPaths(NGT::Index &outIndex, size_t threadSize = 0)
   {
 #if defined(NGT_SHARED_MEMORY_ALLOCATOR)
     std::cerr << "construct index is not implemented." << std::endl;
     exit(1);
 #else
     NGT::GraphIndex	&outGraph = dynamic_cast<NGT::GraphIndex&>(outIndex.getIndex());
-    size_t rStartRank = 0; 
-    std::list<std::pair<size_t, NGT::GraphNode> > tmpGraph;
+    // the edges are selected in place. the first keptSize[id] edges of each node are the selected ones,
+    // and the rest are the original edges.
+    std::vector<size_t> keptSize(outGraph.repository.size(), 0);
+    std::vector<size_t> ids;
     for (size_t id = 1; id < outGraph.repository.size(); id++) {
-      NGT::GraphNode &node = *outGraph.getNode(id);
-      tmpGraph.push_back(std::pair<size_t, NGT::GraphNode>(id, node));
-      if (node.size() > rStartRank) {
-	node.resize(rStartRank);
-      }
+      ids.push_back(id);
     }
     size_t removeCount = 0;
-    for (size_t rank = rStartRank; ; rank++) {
+    for (size_t rank = 0; ; rank++) {
       bool edge = false;
-      Timer timer;
-      for (auto it = tmpGraph.begin(); it != tmpGraph.end();) {
-	size_t id = (*it).first;
+      size_t last = 0;
+      for (size_t i = 0; i < ids.size(); i++) {
+	size_t id = ids[i];
 	try {
-	  NGT::GraphNode &node = (*it).second;
+	  NGT::GraphNode &node = *outGraph.getNode(id);
 	  if (rank >= node.size()) {
-	    it = tmpGraph.erase(it);
 	    continue;
 	  }
+	  ids[last++] = id;
 	  edge = true;
 	  if (rank >= 1 && node[rank - 1].distance > node[rank].distance) {
 	    std::cerr << "distance order is wrong!" << std::endl;
 	    std::cerr << id << ":" << rank << ":" << node[rank - 1].id << ":" << node[rank].id << std::endl;	    
 	  }
-	  NGT::GraphNode &tn = *outGraph.getNode(id);
 	  //////////////////
 	  volatile bool found = false;
 	  if (rank < 1000) {
-	    for (size_t tni = 0; tni < tn.size() && !found; tni++) {
-	      if (tn[tni].id == node[rank].id) {
+	    for (size_t tni = 0; tni < keptSize[id] && !found; tni++) {
+	      if (node[tni].id == node[rank].id) {
 		continue;
 	      }
-	      NGT::GraphNode &dstNode = *outGraph.getNode(tn[tni].id);
-	      for (size_t dni = 0; dni < dstNode.size(); dni++) {
+	      NGT::GraphNode &dstNode = *outGraph.getNode(node[tni].id);
+	      for (size_t dni = 0; dni < keptSize[node[tni].id]; dni++) {
 		if ((dstNode[dni].id == node[rank].id) && (dstNode[dni].distance < node[rank].distance)) {
 		  found = true;
 		  break;
@@ -115,17 +139,17 @@ class GraphReconstructor {
 	    }  
 	  } else {
 #ifdef _OPENMP
-#pragma omp parallel for num_threads(10)
+#pragma omp parallel for num_threads(getNumberOfThreads(threadSize))
 #endif
-	    for (size_t tni = 0; tni < tn.size(); tni++) {
+	    for (size_t tni = 0; tni < keptSize[id]; tni++) {
 	      if (found) {
 		continue;
 	      }
-	      if (tn[tni].id == node[rank].id) {
+	      if (node[tni].id == node[rank].id) {
 		continue;
 	      }
-	      NGT::GraphNode &dstNode = *outGraph.getNode(tn[tni].id);
-	      for (size_t dni = 0; dni < dstNode.size(); dni++) {
+	      NGT::GraphNode &dstNode = *outGraph.getNode(node[tni].id);
+	      for (size_t dni = 0; dni < keptSize[node[tni].id]; dni++) {
 		if ((dstNode[dni].id == node[rank].id) && (dstNode[dni].distance < node[rank].distance)) {
 		  found = true;
 		}
@@ -133,69 +157,78 @@ class GraphReconstructor {
 	    } 
 	  } 
 	  if (!found) {
-#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
-	    outGraph.addEdge(id, node.at(i, outGraph.repository.allocator).id,
-			     node.at(i, outGraph.repository.allocator).distance, true);
-#else
-	    tn.push_back(NGT::ObjectDistance(node[rank].id, node[rank].distance));
-#endif
+	    node[keptSize[id]++] = node[rank];
 	  } else {
 	    removeCount++;
 	  }
 	} catch(NGT::Exception &err) {
 	  std::cerr << "GraphReconstructor: Warning. Cannot get the node. ID=" << id << ":" << err.what() << std::endl;
-	  it++;
+	  ids[last++] = id;
 	  continue;
 	}
-	it++;
       } 
+      ids.resize(last);
       if (edge == false) {
 	break;
       }
     } 
+    for (size_t id = 1; id < outGraph.repository.size(); id++) {
+      try {
+	NGT::GraphNode &node = *outGraph.getNode(id);
+	node.resize(keptSize[id]);
+	NGT::GraphNode tmp = node;
+	node.swap(tmp);
+      } catch(NGT::Exception &err) {
+	continue;
+      }
+    }
 #endif // NGT_SHARED_MEMORY_ALLOCATOR
   }
 
   static void 
-    adjustPathsEffectively(NGT::Index &outIndex)
+    adjustPathsEffectively(NGT::Index &outIndex, size_t threadSize = 0)
   {
     NGT::GraphIndex	&outGraph = dynamic_cast<NGT::GraphIndex&>(outIndex.getIndex());
-    adjustPathsEffectively(outGraph);
+    adjustPathsEffectively(outGraph, threadSize);
   }
 
   static void 
-    adjustPathsEffectively(NGT::GraphIndex &outGraph)
+    adjustPathsEffectively(NGT::GraphIndex &outGraph, size_t threadSize = 0)
   {
     Timer timer;
     timer.start();
+    size_t nodeSize = outGraph.repository.size() == 0 ? 0 : outGraph.repository.size() - 1;
+#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+    // the nodes in the shared memory are rebuilt from the copies of the original edges.
     size_t rStartRank = 0; 
     std::vector<std::pair<size_t, NGT::GraphNode> > tmpGraph;
     for (size_t id = 1; id < outGraph.repository.size(); id++) {
       NGT::GraphNode &node = *outGraph.getNode(id);
       tmpGraph.push_back(std::pair<size_t, NGT::GraphNode>(id, node));
       if (node.size() > rStartRank) {
-#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
 	node.resize(rStartRank, outGraph.repository.allocator);
-#else
-	node.resize(rStartRank);
-#endif
       }
     }
+    auto getSourceNode = [&](size_t idx) -> NGT::GraphNode& { return tmpGraph[idx].second; };
+#else
+    // the edges are selected in place without any copy of the graph. the first keptSize[idx] edges
+    // of each node are the selected ones, and the rest are the original edges.
+    auto getSourceNode = [&](size_t idx) -> NGT::GraphNode& { return *outGraph.getNode(idx + 1); };
+#endif
     timer.stop();
     std::cerr << "GraphReconstructor::adjustPaths: graph preparing time=" << timer << std::endl;
     timer.reset();
     timer.start();
 
-    std::vector<std::vector<std::pair<uint32_t, uint32_t> > > removeCandidates(tmpGraph.size());
+    std::vector<std::vector<std::pair<uint32_t, uint32_t> > > removeCandidates(nodeSize);
     int removeCandidateCount = 0;
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp parallel for num_threads(getNumberOfThreads(threadSize)) reduction(+:removeCandidateCount)
 #endif
-    for (size_t idx = 0; idx < tmpGraph.size(); ++idx) {
-      auto it = tmpGraph.begin() + idx;
-      size_t id = (*it).first;
+    for (size_t idx = 0; idx < nodeSize; ++idx) {
+      size_t id = idx + 1;
       try {
-	NGT::GraphNode &srcNode = (*it).second;	
+	NGT::GraphNode &srcNode = getSourceNode(idx);
 	std::unordered_map<uint32_t, std::pair<size_t, double> > neighbors;
 	for (size_t sni = 0; sni < srcNode.size(); ++sni) {
 #if defined(NGT_SHARED_MEMORY_ALLOCATOR)
@@ -208,11 +241,9 @@ class GraphReconstructor {
 	std::vector<std::pair<int, std::pair<uint32_t, uint32_t> > > candidates;	
 	for (size_t sni = 0; sni < srcNode.size(); sni++) { 
 #if defined(NGT_SHARED_MEMORY_ALLOCATOR)
-	  assert(srcNode.at(sni, outGraph.repository.allocator).id == tmpGraph[srcNode.at(sni, outGraph.repository.allocator).id - 1].first);
-	  NGT::GraphNode &pathNode = tmpGraph[srcNode.at(sni, outGraph.repository.allocator).id - 1].second;
+	  NGT::GraphNode &pathNode = getSourceNode(srcNode.at(sni, outGraph.repository.allocator).id - 1);
 #else
-	  assert(srcNode[sni].id == tmpGraph[srcNode[sni].id - 1].first);
-	  NGT::GraphNode &pathNode = tmpGraph[srcNode[sni].id - 1].second;
+	  NGT::GraphNode &pathNode = getSourceNode(srcNode[sni].id - 1);
 #endif
 	  for (size_t pni = 0; pni < pathNode.size(); pni++) {
 #if defined(NGT_SHARED_MEMORY_ALLOCATOR)
@@ -255,82 +286,96 @@ class GraphReconstructor {
     timer.reset();
     timer.start();
 
-    std::list<size_t> ids;
-    for (auto it = tmpGraph.begin(); it != tmpGraph.end(); ++it) {
-      size_t id = (*it).first;
-      ids.push_back(id);
+    // the edges are committed rank by rank. at each rank, whether the edge of each node is kept is decided
+    // in parallel only with the edges kept at the preceding ranks, and then the kept edges are committed
+    // in parallel. therefore, the result does not depend on the number of the threads.
+    std::vector<size_t> ids;
+    ids.reserve(nodeSize);
+    for (size_t idx = 0; idx < nodeSize; idx++) {
+      ids.push_back(idx);
     }
 
     int removeCount = 0;
     removeCandidateCount = 0;
-    std::vector<std::unordered_set<uint32_t> > edges(tmpGraph.size()); 
+    std::vector<uint32_t> keptSize(nodeSize, 0);
+    std::vector<char> kept(nodeSize, false);
     for (size_t rank = 0; ids.size() != 0; rank++) {
-      for (auto it = ids.begin(); it != ids.end(); ) {
-	size_t id = *it;
-	size_t idx = id - 1;
-	try {
-	  NGT::GraphNode &srcNode = tmpGraph[idx].second;
-	  if (rank >= srcNode.size()) {
-	    if (!removeCandidates[idx].empty()) {
-	      std::cerr << "Something wrong! ID=" << id << " # of remaining candidates=" << removeCandidates[idx].size() << std::endl;
-	      abort();
-	    }
-	    it = ids.erase(it);
-	    continue;
+      size_t last = 0;
+      for (size_t i = 0; i < ids.size(); i++) {
+	size_t idx = ids[i];
+	if (rank >= getSourceNode(idx).size()) {
+	  if (!removeCandidates[idx].empty()) {
+	    std::cerr << "Something wrong! ID=" << idx + 1 << " # of remaining candidates=" << removeCandidates[idx].size() << std::endl;
+	    abort();
 	  }
-	  if (removeCandidates[idx].size() > 0) {
-	    removeCandidateCount++;
-	    bool pathExist = false;
-#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
-            while (!removeCandidates[idx].empty() && (removeCandidates[idx].back().second == srcNode.at(rank, outGraph.repository.allocator).id)) {
-#else
-	    while (!removeCandidates[idx].empty() && (removeCandidates[idx].back().second == srcNode[rank].id)) {
+	  continue;
+	}
+	ids[last++] = idx;
+      }
+      ids.resize(last);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(getNumberOfThreads(threadSize)) reduction(+:removeCount, removeCandidateCount)
 #endif
-	      size_t path = removeCandidates[idx].back().first;
-	      size_t dst = removeCandidates[idx].back().second;
-	      removeCandidates[idx].pop_back();
-	      if ((edges[idx].find(path) != edges[idx].end()) && (edges[path - 1].find(dst) != edges[path - 1].end())) {
-		pathExist = true;
+      for (size_t i = 0; i < ids.size(); i++) {
+	size_t idx = ids[i];
+	NGT::GraphNode &srcNode = getSourceNode(idx);
 #if defined(NGT_SHARED_MEMORY_ALLOCATOR)
-	        while (!removeCandidates[idx].empty() && (removeCandidates[idx].back().second == srcNode.at(rank, outGraph.repository.allocator).id)) {
+	uint32_t edgeID = srcNode.at(rank, outGraph.repository.allocator).id;
 #else
-		while (!removeCandidates[idx].empty() && (removeCandidates[idx].back().second == srcNode[rank].id)) {
+	uint32_t edgeID = srcNode[rank].id;
 #endif
-	          removeCandidates[idx].pop_back();
-		}
-		break;
+	kept[idx] = true;
+	if (removeCandidates[idx].size() > 0) {
+	  removeCandidateCount++;
+	  while (!removeCandidates[idx].empty() && (removeCandidates[idx].back().second == edgeID)) {
+	    size_t path = removeCandidates[idx].back().first;
+	    removeCandidates[idx].pop_back();
+	    if (hasEdge(outGraph, idx, keptSize[idx], path) && hasEdge(outGraph, path - 1, keptSize[path - 1], edgeID)) {
+	      kept[idx] = false;
+	      while (!removeCandidates[idx].empty() && (removeCandidates[idx].back().second == edgeID)) {
+		removeCandidates[idx].pop_back();
 	      }
-	    }
-	    if (pathExist) {
-	      removeCount++;
-              it++;
-	      continue;
+	      break;
 	    }
 	  }
-#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
-	  edges[idx].insert(srcNode.at(rank, outGraph.repository.allocator).id);
-#else
-	  edges[idx].insert(srcNode[rank].id);
+	  if (!kept[idx]) {
+	    removeCount++;
+	  }
+	}
+      }
+#if defined(_OPENMP) && !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+#pragma omp parallel for num_threads(getNumberOfThreads(threadSize))
 #endif
-	  NGT::GraphNode &outSrcNode = *outGraph.getNode(id);
+      for (size_t i = 0; i < ids.size(); i++) {
+	size_t idx = ids[i];
+	if (!kept[idx]) {
+	  continue;
+	}
+	NGT::GraphNode &srcNode = getSourceNode(idx);
+	try {
 #if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+	  NGT::GraphNode &outSrcNode = *outGraph.getNode(idx + 1);
 	  outSrcNode.push_back(NGT::ObjectDistance(srcNode.at(rank, outGraph.repository.allocator).id, srcNode.at(rank, outGraph.repository.allocator).distance), outGraph.repository.allocator);
 #else
-          size_t r = outSrcNode.capacity();
-          size_t s = outSrcNode.size();
-	  outSrcNode.push_back(NGT::ObjectDistance(srcNode[rank].id, srcNode[rank].distance));
-          if (r != outSrcNode.capacity()) {
-             std::cerr << id << "-" << rank << " " << s << ":" << r << ":" << outSrcNode.capacity() << std::endl;
-          }
+	  srcNode[keptSize[idx]] = srcNode[rank];
 #endif
+	  keptSize[idx]++;
 	} catch(NGT::Exception &err) {
-	  std::cerr << "GraphReconstructor: Warning. Cannot get the node. ID=" << id << ":" << err.what() << std::endl;
-          it++;
-	  continue;
+	  std::cerr << "GraphReconstructor: Warning. Cannot get the node. ID=" << idx + 1 << ":" << err.what() << std::endl;
 	}
-        it++;
       }
     }
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(getNumberOfThreads(threadSize))
+#endif
+    for (size_t idx = 0; idx < nodeSize; idx++) {
+      NGT::GraphNode &node = getSourceNode(idx);
+      node.resize(keptSize[idx]);
+      NGT::GraphNode tmp = node;
+      node.swap(tmp);
+    }
+#endif
   }
 
   static 
@@ -342,13 +387,13 @@ class GraphReconstructor {
 #else
     std::cerr << "convertToANNG begin" << std::endl;
     for (size_t idx = 0; idx < graph.size(); idx++) {
-      NGT::GraphNode &node = graph[idx];
+      NGT::ObjectDistances &node = graph[idx];
       for (auto ni = node.begin(); ni != node.end(); ++ni) {
 	graph[(*ni).id - 1].push_back(NGT::ObjectDistance(idx + 1, (*ni).distance));
       }
     }
     for (size_t idx = 0; idx < graph.size(); idx++) {
-      NGT::GraphNode &node = graph[idx];
+      NGT::ObjectDistances &node = graph[idx];
       if (node.size() == 0) {
 	continue;
       }
@@ -362,7 +407,7 @@ class GraphReconstructor {
 	prev = (*it).id;
 	  it++;
       }
-      NGT::GraphNode tmp = node;
+      NGT::ObjectDistances tmp = node;
       node.swap(tmp);
     }
     std::cerr << "convertToANNG end" << std::endl;
@@ -402,7 +447,7 @@ class GraphReconstructor {
 #if defined(NGT_SHARED_MEMORY_ALLOCATOR)
 	  node.copy(n, outGraph.repository.allocator);
 #else
-	  node.swap(n);
+	  node = n;
 #endif
 	}
       } catch(NGT::Exception &err) {
@@ -490,6 +535,221 @@ class GraphReconstructor {
 
 
 
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  // temporary files of the edges, which are bucketed by the chunk of the destination nodes.
+  class EdgeBuckets {
+  public:
+    class Edge {
+    public:
+      uint32_t		to;
+      uint32_t		from;
+      NGT::Distance	distance;
+    };
+    EdgeBuckets(size_t nodeSize, size_t cs):chunkSize(cs), buckets((nodeSize + cs - 1) / cs, 0) {}
+    ~EdgeBuckets() {
+      for (auto f : buckets) {
+	if (f != 0) {
+	  fclose(f);
+	}
+      }
+    }
+    void put(uint32_t to, uint32_t from, NGT::Distance distance) {
+      FILE *&bucket = buckets[(to - 1) / chunkSize];
+      if (bucket == 0) {
+	const char *dir = getenv("TMPDIR");
+	std::string path = std::string(dir == 0 ? "/tmp" : dir) + "/ngt-edges-XXXXXX";
+	std::vector<char> name(path.begin(), path.end());
+	name.push_back(0);
+	int fd = mkstemp(name.data());
+	if (fd < 0 || (bucket = fdopen(fd, "w+b")) == 0) {
+	  std::stringstream msg;
+	  msg << "GraphReconstructor::EdgeBuckets: Cannot create a temporary file. " << path;
+	  NGTThrowException(msg);
+	}
+	unlink(name.data());
+      }
+      Edge edge = {to, from, distance};
+      if (fwrite(&edge, sizeof(edge), 1, bucket) != 1) {
+	NGTThrowException("GraphReconstructor::EdgeBuckets: Cannot write the temporary file.");
+      }
+    }
+    // get the edges of the bucket, which is released.
+    void get(size_t bucket, std::vector<Edge> &edges) {
+      edges.clear();
+      FILE *f = buckets[bucket];
+      if (f == 0) {
+	return;
+      }
+      edges.resize(ftell(f) / sizeof(Edge));
+      rewind(f);
+      if (fread(edges.data(), sizeof(Edge), edges.size(), f) != edges.size()) {
+	NGTThrowException("GraphReconstructor::EdgeBuckets: Cannot read the temporary file.");
+      }
+      fclose(f);
+      buckets[bucket] = 0;
+    }
+    size_t		chunkSize;
+    std::vector<FILE*>	buckets;
+  };
+
+  // reconstruct the graph in place chunk by chunk of the nodes without extracting the whole graph. the edges
+  // to be added to the other nodes are spilled to temporary files, so the working memory in addition to the graph
+  // is bounded by the chunk. the result is the same as reconstructGraph with the graph extracted by extractGraph,
+  // which is converted by convertToANNG when anng is true.
+  static 
+    void reconstructGraphInChunks(NGT::Index &outIndex, size_t originalEdgeSize, size_t reverseEdgeSize, bool anng,
+				  size_t chunkSize = NGT_GRAPH_RECONSTRUCTION_CHUNK_SIZE, size_t threadSize = 0)
+  {
+    if (reverseEdgeSize > 10000) {
+      std::cerr << "something wrong. Edge size=" << reverseEdgeSize << std::endl;
+      exit(1);
+    }
+
+    NGT::Timer	originalEdgeTimer, reverseEdgeTimer;
+    originalEdgeTimer.start();
+    NGT::GraphIndex	&outGraph = dynamic_cast<NGT::GraphIndex&>(outIndex.getIndex());
+    size_t nodeSize = outGraph.repository.size() == 0 ? 0 : outGraph.repository.size() - 1;
+    if (nodeSize == 0) {
+      return;
+    }
+    chunkSize = chunkSize == 0 || chunkSize > nodeSize ? nodeSize : chunkSize;
+
+    EdgeBuckets anngReverseEdges(nodeSize, chunkSize);
+    if (anng) {
+      for (size_t id = 1; id <= nodeSize; id++) {
+	try {
+	  NGT::GraphNode &node = *outGraph.getNode(id);
+	  for (auto &n : node) {
+	    anngReverseEdges.put(n.id, id, n.distance);
+	  }
+	} catch(NGT::Exception &err) {
+	  std::cerr << "GraphReconstructor: Warning. Cannot get the node. ID=" << id << ":" << err.what() << std::endl;
+	}
+      }
+    }
+
+    EdgeBuckets reverseEdges(nodeSize, chunkSize);
+    std::vector<EdgeBuckets::Edge> edges;
+    int insufficientNodeCount = 0;
+    for (size_t begin = 1; begin <= nodeSize; begin += chunkSize) {
+      size_t end = std::min(begin + chunkSize, nodeSize + 1);
+      // the nodes of the chunk as extracted.
+      std::vector<NGT::ObjectDistances> graph(end - begin);
+      if (anng) {
+	anngReverseEdges.get((begin - 1) / chunkSize, edges);
+	for (auto &e : edges) {
+	  graph[e.to - begin].push_back(NGT::ObjectDistance(e.from, e.distance));
+	}
+      }
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(getNumberOfThreads(threadSize))
+#endif
+      for (size_t idx = 0; idx < graph.size(); idx++) {
+	NGT::ObjectDistances &node = graph[idx];
+	try {
+	  NGT::GraphNode &n = *outGraph.getNode(begin + idx);
+	  if (!anng) {
+	    node = static_cast<NGT::ObjectDistances>(n);
+	    continue;
+	  }
+	  node.insert(node.end(), n.begin(), n.end());
+	} catch(NGT::Exception &err) {
+	  continue;
+	}
+	std::sort(node.begin(), node.end());
+	NGT::ObjectID prev = 0;
+	size_t last = 0;
+	for (size_t i = 0; i < node.size(); i++) {
+	  if (prev != node[i].id) {
+	    prev = node[i].id;
+	    node[last++] = node[i];
+	  }
+	}
+	node.resize(last);
+      }
+      for (size_t idx = 0; idx < graph.size(); idx++) {
+	NGT::ObjectDistances &node = graph[idx];
+	size_t rsize = reverseEdgeSize;
+	if (rsize > node.size()) {
+	  insufficientNodeCount++;
+	  rsize = node.size();
+	}
+	for (size_t i = 0; i < rsize; ++i) {
+	  reverseEdges.put(node[i].id, begin + idx, node[i].distance);
+	}
+      }
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(getNumberOfThreads(threadSize))
+#endif
+      for (size_t idx = 0; idx < graph.size(); idx++) {
+	try {
+	  NGT::GraphNode &node = *outGraph.getNode(begin + idx);
+	  NGT::ObjectDistances &n = graph[idx];
+	  if (originalEdgeSize == 0) {
+	    NGT::GraphNode empty;
+	    node.swap(empty);
+	  } else if (n.size() < originalEdgeSize) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+	    {
+	      std::cerr << "node size is too few." << std::endl;
+	      std::cerr << n.size() << ":" << originalEdgeSize << std::endl;
+	    }
+	  } else {
+	    n.resize(originalEdgeSize);
+	    node = n;
+	  }
+	} catch(NGT::Exception &err) {
+	  continue;
+	}
+      }
+    }
+    originalEdgeTimer.stop();
+
+    reverseEdgeTimer.start();
+    for (size_t begin = 1; begin <= nodeSize; begin += chunkSize) {
+      size_t end = std::min(begin + chunkSize, nodeSize + 1);
+      reverseEdges.get((begin - 1) / chunkSize, edges);
+      for (auto &e : edges) {
+	try {
+	  outGraph.getNode(e.to)->push_back(NGT::ObjectDistance(e.from, e.distance));
+	} catch(...) {}
+      }
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(getNumberOfThreads(threadSize))
+#endif
+      for (size_t id = begin; id < end; id++) {
+	try {
+	  NGT::GraphNode &n = *outGraph.getNode(id);
+	  std::sort(n.begin(), n.end());
+	  NGT::ObjectID prev = 0;
+	  size_t last = 0;
+	  for (size_t i = 0; i < n.size(); i++) {
+	    if (prev != n[i].id) {
+	      prev = n[i].id;
+	      n[last++] = n[i];
+	    }
+	  }
+	  n.resize(last);
+	  NGT::GraphNode tmp = n;
+	  n.swap(tmp);
+	} catch (...) {
+	  std::cerr << "Graph::construct: error. something wrong. ID=" << id << std::endl;
+	}
+      }
+    }
+    reverseEdgeTimer.stop();
+    if (insufficientNodeCount != 0) {
+      std::cerr << "# of the nodes edges of which are in short = " << insufficientNodeCount << std::endl;
+    }
+    std::cerr << "Reconstruction time=" << originalEdgeTimer.time << ":" << reverseEdgeTimer.time << std::endl;
+    std::cerr << "original edge size=" << originalEdgeSize << std::endl;
+    std::cerr << "reverse edge size=" << reverseEdgeSize << std::endl;
+  }
+#endif
+
+
   static 
     void reconstructGraphWithConstraint(std::vector<NGT::ObjectDistances> &graph, NGT::Index &outIndex, 
 					size_t originalEdgeSize, size_t reverseEdgeSize,
@@ -530,7 +790,7 @@ class GraphReconstructor {
     std::vector<ObjectDistances> reverse(graph.size() + 1);	
     for (size_t id = 1; id <= graph.size(); ++id) {
       try {
-	NGT::GraphNode &node = graph[id - 1];
+	NGT::ObjectDistances &node = graph[id - 1];
 	if (id % 100000 == 0) {
 	  std::cerr << "Processed (summing up) " << id << std::endl;
 	}
@@ -609,7 +869,7 @@ class GraphReconstructor {
       if (id % 1000000 == 0) {
 	std::cerr << "Processed " << id << std::endl;
       }
-      NGT::GraphNode &node = graph[id - 1];
+      NGT::ObjectDistances &node = graph[id - 1];
       try {
 	NGT::GraphNode &onode = *outGraph.getNode(id);
 	bool stop = false;
@@ -0,0 +1,274 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include	"NGT/Index.h"
+
+#include	<queue>
+#include	<deque>
+
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+
+namespace NGT {
+
+// GraphReorderer permutes the object IDs of a built index so that the neighbors on the graph have
+// close IDs, and therefore sit in adjacent memory. The objects, the graph edges and the tree leaves
+// are rewritten, and the removed IDs are compacted out. Since the IDs change, a table of the original
+// IDs (idm) is saved with the index, and Index::getOriginalID looks it up. originalIDs[id] is the ID of
+// the object before any reordering.
+class GraphReorderer {
+ public:
+  // the order is the list of the old IDs in the new order. order[0] is always 0.
+  static void 
+    computeOrder(GraphRepository &graph, ObjectRepository &objects, char method, size_t window, std::vector<ObjectID> &order) 
+  {
+    order.clear();
+    order.push_back(0);
+    switch (method) {
+    case 'b': computeOrderByBFS(graph, objects, order); break;
+    case 'r': computeOrderByRCM(graph, objects, order); break;
+    case 'g': computeOrderByWindow(graph, objects, window, order); break;
+    default:
+      {
+	std::stringstream msg;
+	msg << "GraphReorderer: Invalid method. " << method;
+	NGTThrowException(msg);
+      }
+    }
+  }
+
+  // breadth first search along the outgoing edges from the unvisited node with the smallest ID.
+  static void 
+    computeOrderByBFS(GraphRepository &graph, ObjectRepository &objects, std::vector<ObjectID> &order) 
+  {
+    std::vector<bool> placed(objects.size(), false);
+    std::queue<ObjectID> queue;
+    for (size_t id = 1; id < objects.size(); id++) {
+      if (objects.isEmpty(id) || placed[id]) {
+	continue;
+      }
+      placed[id] = true;
+      queue.push(id);
+      while (!queue.empty()) {
+	ObjectID v = queue.front();
+	queue.pop();
+	order.push_back(v);
+	if (graph.isEmpty(v)) {
+	  continue;
+	}
+	GraphNode &node = *graph[v];
+	for (auto ni = node.begin(); ni != node.end(); ++ni) {
+	  ObjectID u = (*ni).id;
+	  if (u < placed.size() && !placed[u] && !objects.isEmpty(u)) {
+	    placed[u] = true;
+	    queue.push(u);
+	  }
+	}
+      }
+    }
+  }
+
+  // reverse Cuthill-McKee on the undirected graph.
+  static void 
+    computeOrderByRCM(GraphRepository &graph, ObjectRepository &objects, std::vector<ObjectID> &order) 
+  {
+    std::vector<std::vector<ObjectID>> adjacency;
+    extractUndirectedGraph(graph, objects, adjacency);
+    std::vector<ObjectID> nodes;
+    for (size_t id = 1; id < objects.size(); id++) {
+      if (!objects.isEmpty(id)) {
+	nodes.push_back(id);
+      }
+    }
+    auto lessDegree = [&adjacency](ObjectID a, ObjectID b) {
+      return adjacency[a].size() < adjacency[b].size() || (adjacency[a].size() == adjacency[b].size() && a < b);
+    };
+    std::stable_sort(nodes.begin(), nodes.end(), lessDegree);
+    std::vector<bool> placed(objects.size(), false);
+    std::queue<ObjectID> queue;
+    std::vector<ObjectID> neighbors;
+    for (auto start = nodes.begin(); start != nodes.end(); ++start) {
+      if (placed[*start]) {
+	continue;
+      }
+      placed[*start] = true;
+      queue.push(*start);
+      while (!queue.empty()) {
+	ObjectID v = queue.front();
+	queue.pop();
+	order.push_back(v);
+	neighbors.clear();
+	for (auto u = adjacency[v].begin(); u != adjacency[v].end(); ++u) {
+	  if (!placed[*u]) {
+	    placed[*u] = true;
+	    neighbors.push_back(*u);
+	  }
+	}
+	std::sort(neighbors.begin(), neighbors.end(), lessDegree);
+	for (auto u = neighbors.begin(); u != neighbors.end(); ++u) {
+	  queue.push(*u);
+	}
+      }
+    }
+    std::reverse(order.begin() + 1, order.end());
+  }
+
+  // Gorder-style greedy ordering. The next node is the one that has the most edges to the last window nodes.
+  static void 
+    computeOrderByWindow(GraphRepository &graph, ObjectRepository &objects, size_t window, std::vector<ObjectID> &order) 
+  {
+    if (window == 0) {
+      NGTThrowException("GraphReorderer: The window size should be greater than 0.");
+    }
+    std::vector<std::vector<ObjectID>> adjacency;
+    extractUndirectedGraph(graph, objects, adjacency);
+    std::vector<int64_t> scores(objects.size(), 0);
+    std::vector<bool> placed(objects.size(), false);
+    std::priority_queue<std::pair<int64_t, ObjectID>> candidates;
+    std::deque<ObjectID> recent;
+    size_t next = 1;
+    for (;;) {
+      ObjectID v = 0;
+      while (!candidates.empty()) {
+	auto top = candidates.top();
+	candidates.pop();
+	if (!placed[top.second] && scores[top.second] == top.first && top.first > 0) {
+	  v = top.second;
+	  break;
+	}
+      }
+      if (v == 0) {
+	for (; next < objects.size() && (placed[next] || objects.isEmpty(next)); next++);
+	if (next >= objects.size()) {
+	  break;
+	}
+	v = next;
+      }
+      placed[v] = true;
+      order.push_back(v);
+      recent.push_back(v);
+      for (auto u = adjacency[v].begin(); u != adjacency[v].end(); ++u) {
+	if (!placed[*u]) {
+	  candidates.push(std::make_pair(++scores[*u], *u));
+	}
+      }
+      if (recent.size() > window) {
+	ObjectID old = recent.front();
+	recent.pop_front();
+	for (auto u = adjacency[old].begin(); u != adjacency[old].end(); ++u) {
+	  if (!placed[*u]) {
+	    candidates.push(std::make_pair(--scores[*u], *u));
+	  }
+	}
+      }
+    }
+  }
+
+  static void 
+    extractUndirectedGraph(GraphRepository &graph, ObjectRepository &objects, std::vector<std::vector<ObjectID>> &adjacency) 
+  {
+    adjacency.clear();
+    adjacency.resize(objects.size());
+    for (size_t id = 1; id < graph.size() && id < objects.size(); id++) {
+      if (graph.isEmpty(id) || objects.isEmpty(id)) {
+	continue;
+      }
+      GraphNode &node = *graph[id];
+      for (auto ni = node.begin(); ni != node.end(); ++ni) {
+	ObjectID u = (*ni).id;
+	if (u == id || u >= objects.size() || objects.isEmpty(u)) {
+	  continue;
+	}
+	adjacency[id].push_back(u);
+	adjacency[u].push_back(id);
+      }
+    }
+    for (auto a = adjacency.begin(); a != adjacency.end(); ++a) {
+      std::sort((*a).begin(), (*a).end());
+      (*a).erase(std::unique((*a).begin(), (*a).end()), (*a).end());
+    }
+  }
+
+  // originalIDs is updated to the original IDs of the reordered objects. an empty table means the identity.
+  static void 
+    reorder(NGT::Index &index, char method, size_t window, std::vector<ObjectID> &originalIDs) 
+  {
+#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+    NGTThrowException("GraphReorderer: Not implemented for the shared memory option.");
+#else
+    GraphIndex &graphIndex = static_cast<GraphIndex&>(index.getIndex());
+    ObjectRepository &objects = graphIndex.getObjectSpace().getRepository();
+    GraphRepository &graph = graphIndex.repository;
+
+    if (!originalIDs.empty() && originalIDs.size() < objects.size()) {
+      NGTThrowException("GraphReorderer: The table of the original IDs does not cover the objects.");
+    }
+
+    std::vector<ObjectID> order;
+    computeOrder(graph, objects, method, window, order);
+    std::vector<ObjectID> newIDs(objects.size(), 0);
+    for (size_t i = 1; i < order.size(); i++) {
+      newIDs[order[i]] = i;
+    }
+
+    for (size_t id = 1; id < graph.size(); id++) {
+      if (graph.isEmpty(id)) {
+	continue;
+      }
+      GraphNode &node = *graph[id];
+      size_t dst = 0;
+      for (size_t src = 0; src < node.size(); src++) {
+	ObjectID u = node[src].id;
+	if (u < newIDs.size() && newIDs[u] != 0) {
+	  node[dst] = node[src];
+	  node[dst].id = newIDs[u];
+	  dst++;
+	}
+      }
+      node.resize(dst);
+    }
+    graph.permute(order);
+    objects.permute(order);
+
+    GraphAndTreeIndex *tree = dynamic_cast<GraphAndTreeIndex*>(&graphIndex);
+    if (tree != 0) {
+      tree->DVPTree::replaceObjectIDs(newIDs);
+    }
+
+    std::vector<ObjectID> ids(order.size(), 0);
+    for (size_t i = 1; i < order.size(); i++) {
+      ids[i] = originalIDs.empty() ? order[i] : originalIDs[order[i]];
+    }
+    originalIDs.swap(ids);
+#endif
+  }
+
+  static void 
+    reorder(const std::string &indexPath, const std::string &outIndexPath, char method, size_t window = 5) 
+  {
+    // the table of the original IDs is loaded with the index and saved with it.
+    NGT::Index index(indexPath);
+    index.updateOriginalIDs();
+    reorder(index, method, window, index.getOriginalIDs());
+    index.saveIndex(outIndexPath);
+  }
+
+};
+
+}; // NGT
+
+#endif // !NGT_SHARED_MEMORY_ALLOCATOR
@@ -0,0 +1,116 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include	<stdint.h>
+#include	<cstring>
+#include	<iostream>
+
+namespace NGT {
+
+  // IEEE 754 binary16. Values are converted from float with round-to-nearest-even at ingest,
+  // and the distance kernels widen them to float with F16C/AVX-512 when available.
+  class float16 {
+  public:
+    float16():bits(0) {}
+    float16(float f):bits(fromFloat(f)) {}
+    template <typename T> explicit float16(T v):bits(fromFloat(static_cast<float>(v))) {}
+
+    operator float() const { return toFloat(bits); }
+
+    float16 &operator=(float f) { bits = fromFloat(f); return *this; }
+
+    uint16_t getBits() const { return bits; }
+
+    static uint16_t fromFloat(float f) {
+      uint32_t x;
+      memcpy(&x, &f, sizeof(x));
+      uint16_t sign = (x >> 16) & 0x8000;
+      uint32_t absx = x & 0x7fffffff;
+      if (absx >= 0x7f800000) {
+	// inf or nan. nan keeps a quiet bit.
+	return sign | 0x7c00 | (absx > 0x7f800000 ? 0x0200 | ((absx >> 13) & 0x03ff) : 0);
+      }
+      if (absx >= 0x477ff000) {
+	// overflow after rounding.
+	return sign | 0x7c00;
+      }
+      if (absx < 0x38800000) {
+	// subnormal or zero.
+	if (absx < 0x33000000) {
+	  return sign;
+	}
+	uint32_t exponent = absx >> 23;
+	uint32_t mantissa = (absx & 0x007fffff) | 0x00800000;
+	uint32_t shift = 126 - exponent;
+	uint32_t half = mantissa >> shift;
+	uint32_t rest = mantissa & ((1U << shift) - 1);
+	uint32_t middle = 1U << (shift - 1);
+	if (rest > middle || (rest == middle && (half & 1))) {
+	  half++;
+	}
+	return sign | half;
+      }
+      uint32_t half = absx - 0x38000000;
+      uint32_t rest = half & 0x1fff;
+      half >>= 13;
+      if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+	half++;
+      }
+      return sign | half;
+    }
+
+    static float toFloat(uint16_t h) {
+      uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+      uint32_t exponent = (h >> 10) & 0x1f;
+      uint32_t mantissa = h & 0x03ff;
+      uint32_t x;
+      if (exponent == 0x1f) {
+	x = sign | 0x7f800000 | (mantissa << 13);
+      } else if (exponent != 0) {
+	x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+      } else if (mantissa == 0) {
+	x = sign;
+      } else {
+	exponent = 113;
+	while ((mantissa & 0x0400) == 0) {
+	  mantissa <<= 1;
+	  exponent--;
+	}
+	x = sign | (exponent << 23) | ((mantissa & 0x03ff) << 13);
+      }
+      float f;
+      memcpy(&f, &x, sizeof(f));
+      return f;
+    }
+
+  private:
+    uint16_t bits;
+  };
+
+  inline std::ostream &operator<<(std::ostream &os, const float16 &v) {
+    return os << static_cast<float>(v);
+  }
+
+  inline std::istream &operator>>(std::istream &is, float16 &v) {
+    float f;
+    is >> f;
+    v = f;
+    return is;
+  }
+
+} // namespace NGT
@@ -0,0 +1,197 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include	<vector>
+#include	<mutex>
+#include	<cstring>
+#include	<cerrno>
+#include	<cstdint>
+#include	<iostream>
+#include	<unistd.h>
+#include	<sys/mman.h>
+
+#include	"NGT/Common.h"
+
+namespace NGT {
+
+  // HugePage allocates the anonymous memory backed by 2MB pages to reduce the TLB misses of the random accesses.
+  //   Transparent : the memory is advised with MADV_HUGEPAGE. "madvise" or "always" should be set to
+  //                 /sys/kernel/mm/transparent_hugepage/enabled.
+  //   Explicit    : the memory is allocated from the reserved hugetlb pages (vm.nr_hugepages) with MAP_HUGETLB.
+  //                 when the pages are not reserved enough, the transparent huge pages are used instead.
+  class HugePage {
+  public:
+    enum Mode {
+      ModeNone		= 0,
+      ModeDisabled	= 1,
+      ModeTransparent	= 2,
+      ModeExplicit	= 3
+    };
+    static const size_t pageSize = 2 * 1024 * 1024;
+
+    static bool isEnabled(Mode mode) { return mode == ModeTransparent || mode == ModeExplicit; }
+    static size_t roundUp(size_t size) { return (size + pageSize - 1) / pageSize * pageSize; }
+
+    // the size is rounded up to the huge page size. returns MAP_FAILED when the memory cannot be allocated.
+    static void *allocate(size_t &size, Mode mode) {
+      size = roundUp(size);
+#if defined(MAP_HUGETLB)
+      if (mode == ModeExplicit) {
+	void *addr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (addr != MAP_FAILED) {
+	  return addr;
+	}
+	static bool warned = false;
+	if (!warned) {
+	  warned = true;
+	  std::cerr << "HugePage: Warning. Cannot allocate the hugetlb pages. The transparent huge pages are used. "
+		    << strerror(errno) << std::endl;
+	}
+      }
+#endif
+      // an extra huge page is mapped so that the region is aligned to the huge page boundary.
+      void *addr = mmap(0, size + pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (addr == MAP_FAILED) {
+	return MAP_FAILED;
+      }
+      uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+      uintptr_t aligned = (begin + pageSize - 1) & ~(pageSize - 1);
+      if (aligned != begin) {
+	munmap(addr, aligned - begin);
+      }
+      if (aligned + size != begin + size + pageSize) {
+	munmap(reinterpret_cast<void*>(aligned + size), begin + pageSize - aligned);
+      }
+#if defined(MADV_HUGEPAGE)
+      if (madvise(reinterpret_cast<void*>(aligned), size, MADV_HUGEPAGE) != 0) {
+	std::cerr << "HugePage: Warning. The transparent huge pages are not available. " << strerror(errno) << std::endl;
+      }
+#endif
+      return reinterpret_cast<void*>(aligned);
+    }
+
+    static void deallocate(void *addr, size_t size) {
+      if (addr != 0 && addr != MAP_FAILED) {
+	munmap(addr, size);
+      }
+    }
+
+    // reads the whole file into the huge pages instead of mapping it, because the page cache is not backed
+    // by the huge pages. the size is the file size and is rounded up to the allocated size.
+    static void *read(int fd, size_t &size, Mode mode) {
+      size_t fileSize = size;
+      void *addr = allocate(size, mode);
+      if (addr == MAP_FAILED) {
+	return MAP_FAILED;
+      }
+      char *p = static_cast<char*>(addr);
+      for (size_t pos = 0; pos < fileSize; ) {
+	ssize_t len = pread(fd, p + pos, fileSize - pos, pos);
+	if (len <= 0) {
+	  if (len < 0 && errno == EINTR) {
+	    continue;
+	  }
+	  deallocate(addr, size);
+	  return MAP_FAILED;
+	}
+	pos += len;
+      }
+      return addr;
+    }
+  };
+
+  // ObjectArena hands out the zero-filled blocks of the same size from the chunks of the huge pages.
+  // the freed blocks are reused. the chunks are doubled up to 1GB.
+  class ObjectArena {
+  public:
+    ObjectArena():mode(HugePage::ModeDisabled), blockSize(0), chunkSize(HugePage::pageSize), next(0), end(0) {}
+    ~ObjectArena() { clear(); }
+
+    void setMode(HugePage::Mode m) { mode = m; }
+    bool isEnabled() { return HugePage::isEnabled(mode); }
+
+    void *allocate(size_t size) {
+      void *block;
+      {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (blockSize == 0) {
+	  blockSize = ((size - 1) / 64 + 1) * 64;
+	}
+	if (size > blockSize) {
+	  NGTThrowException("ObjectArena: The size of the block is inconsistent.");
+	}
+	if (!freeBlocks.empty()) {
+	  block = freeBlocks.back();
+	  freeBlocks.pop_back();
+	} else {
+	  if (next + blockSize > end) {
+	    expand();
+	  }
+	  block = next;
+	  next += blockSize;
+	}
+      }
+      memset(block, 0, blockSize);
+      return block;
+    }
+
+    void deallocate(void *block) {
+      std::lock_guard<std::mutex> lock(mutex);
+      freeBlocks.push_back(block);
+    }
+
+    void clear() {
+      for (auto &c : chunks) {
+	HugePage::deallocate(c.first, c.second);
+      }
+      chunks.clear();
+      freeBlocks.clear();
+      blockSize = 0;
+      chunkSize = HugePage::pageSize;
+      next = end = 0;
+    }
+
+  protected:
+    // the distance functions may read a few bytes beyond the end of the object.
+    static const size_t guardSize = 64;
+
+    void expand() {
+      size_t size = std::max(chunkSize, blockSize + guardSize);
+      void *addr = HugePage::allocate(size, mode);
+      if (addr == MAP_FAILED) {
+	std::stringstream msg;
+	msg << "ObjectArena: Cannot allocate the memory. " << size << " " << strerror(errno);
+	NGTThrowException(msg);
+      }
+      chunks.push_back(std::make_pair(addr, size));
+      next = static_cast<uint8_t*>(addr);
+      end = next + size - guardSize;
+      chunkSize = std::min(chunkSize * 2, static_cast<size_t>(1024 * 1024 * 1024));
+    }
+
+    HugePage::Mode				mode;
+    size_t					blockSize;
+    size_t					chunkSize;
+    uint8_t					*next;
+    uint8_t					*end;
+    std::vector<std::pair<void*, size_t>>	chunks;
+    std::vector<void*>				freeBlocks;
+    std::mutex					mutex;
+  };
+
+} // namespace NGT
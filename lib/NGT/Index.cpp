@@ -22,6 +22,11 @@
 #include	"NGT/GraphReconstructor.h"
 #include	"NGT/Version.h"
 
+#include	<cstdio>
+#include	<dirent.h>
+#include	<unistd.h>
+#include	<atomic>
+
 using namespace std;
 using namespace NGT;
 
@@ -40,7 +45,7 @@ Index::getVersion()
 }
 
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
-NGT::Index::Index(NGT::Property &prop, const string &database) {
+NGT::Index::Index(NGT::Property &prop, const string &database):maxOriginalID(0) {
   if (prop.dimension == 0) {
     NGTThrowException("Index::Index. Dimension is not specified.");
   }
@@ -62,7 +67,7 @@ NGT::Index::Index(NGT::Property &prop, const string &database) {
   path = "";
 }
 #else
-NGT::Index::Index(NGT::Property &prop) {
+NGT::Index::Index(NGT::Property &prop):maxOriginalID(0) {
   if (prop.dimension == 0) {
     NGTThrowException("Index::Index. Dimension is not specified.");
   }
@@ -103,6 +108,62 @@ NGT::Index::open(const string &database, bool rdOnly) {
   }
   index = idx;
   path = database;
+  loadOriginalIDs(database, originalIDs);
+  maxOriginalID = 0;
+}
+
+bool
+NGT::Index::loadOriginalIDs(const string &database, vector<ObjectID> &originalIDs)
+{
+  originalIDs.clear();
+  ifstream is(database + "/idm");
+  if (!is.is_open()) {
+    return false;
+  }
+  NGT::Serializer::read(is, originalIDs);
+  return true;
+}
+
+void
+NGT::Index::saveOriginalIDs(const string &database, vector<ObjectID> &originalIDs)
+{
+  ofstream os(database + "/idm");
+  if (!os.is_open()) {
+    stringstream msg;
+    msg << "Index::saveOriginalIDs: Cannot open. " << database << "/idm";
+    NGTThrowException(msg);
+  }
+  NGT::Serializer::write(os, originalIDs);
+}
+
+void
+NGT::Index::destroy(const string &path)
+{
+#ifdef NGT_SHARED_MEMORY_ALLOCATOR
+  std::remove(string(path + "/grp").c_str());
+  std::remove(string(path + "/grpc").c_str());
+  std::remove(string(path + "/trei").c_str());
+  std::remove(string(path + "/treic").c_str());
+  std::remove(string(path + "/trel").c_str());
+  std::remove(string(path + "/trelc").c_str());
+  std::remove(string(path + "/objpo").c_str());
+  std::remove(string(path + "/objpoc").c_str());
+  std::remove(string(path + "/objor").c_str());
+  std::remove(string(path + "/objorc").c_str());
+#else
+  std::remove(string(path + "/grp").c_str());
+  std::remove(string(path + "/sgr").c_str());
+  std::remove(string(path + "/sgv").c_str());
+  std::remove(string(path + "/sgc").c_str());
+  std::remove(string(path + "/tre").c_str());
+  std::remove(string(path + "/obj").c_str());
+  std::remove(string(path + "/objor").c_str());
+  GraphIndex::removeCheckpoint(path);
+#endif
+  std::remove(string(path + "/objsq").c_str());
+  std::remove(string(path + "/idm").c_str());
+  std::remove(string(path + "/prf").c_str());
+  std::remove(path.c_str());
 }
 
 void 
@@ -178,9 +239,13 @@ NGT::Index::loadAndCreateIndex(Index &index, const string &database, const strin
   cerr << "# of objects=" << index.getObjectRepositorySize() - 1 << endl;
   timer.reset();
   timer.start();
+  index.setCheckpointPath(database);
   index.createIndex(threadSize);
   timer.stop();
   index.saveIndex(database);
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  GraphIndex::removeCheckpoint(database);
+#endif
   cerr << "Index creation time=" << timer.time << " (sec) " << timer.time * 1000.0 << " (msec)" << endl;
 }
 
@@ -199,9 +264,13 @@ NGT::Index::append(const string &database, const string &dataFile, size_t thread
   cerr << "# of objects=" << index.getObjectRepositorySize() - 1 << endl;
   timer.reset();
   timer.start();
+  index.setCheckpointPath(database);
   index.createIndex(threadSize);
   timer.stop();
   index.saveIndex(database);
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  GraphIndex::removeCheckpoint(database);
+#endif
   cerr << "Index creation time=" << timer.time << " (sec) " << timer.time * 1000.0 << " (msec)" << endl;
   return;
 }
@@ -221,13 +290,45 @@ NGT::Index::append(const string &database, const float *data, size_t dataSize, s
   cerr << "# of objects=" << index.getObjectRepositorySize() - 1 << endl;
   timer.reset();
   timer.start();
+  index.setCheckpointPath(database);
   index.createIndex(threadSize);
   timer.stop();
   index.saveIndex(database);
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  GraphIndex::removeCheckpoint(database);
+#endif
   cerr << "Index creation time=" << timer.time << " (sec) " << timer.time * 1000.0 << " (msec)" << endl;
   return;
 }
 
+void 
+NGT::Index::resume(const string &database, size_t threadSize) {
+#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  NGTThrowException("Index::resume: Not implemented for the shared memory option.");
+#else
+  string checkpointPath = GraphIndex::getCheckpoint(database);
+  NGT::Index	index(checkpointPath);
+  GraphIndex &graphIndex = static_cast<GraphIndex&>(index.getIndex());
+  graphIndex.loadCheckpoint(checkpointPath);
+  graphIndex.setCheckpointPath(database);
+  GraphIndex::Checkpoint &checkpoint = graphIndex.getCheckpointState();
+  cerr << "Resume from ID=" << checkpoint.id << " # of inserted objects=" << checkpoint.count << endl;
+  if (threadSize == 0) {
+    NGT::Property prop;
+    index.getProperty(prop);
+    threadSize = prop.threadPoolSize;
+  }
+  NGT::Timer	timer;
+  timer.start();
+  index.createIndex(threadSize);
+  timer.stop();
+  checkpoint.reset();
+  index.saveIndex(database);
+  GraphIndex::removeCheckpoint(database);
+  cerr << "Index creation time=" << timer.time << " (sec) " << timer.time * 1000.0 << " (msec)" << endl;
+#endif
+}
+
 void 
 NGT::Index::remove(const string &database, vector<ObjectID> &objects, bool force) {
   NGT::Index	index(database);
@@ -297,6 +398,138 @@ NGT::Index::exportIndex(const string &database, const string &file) {
   cerr << "# of objects=" << idx.getObjectRepositorySize() - 1 << endl;
 }
 
+void 
+NGT::Index::saveImage(const string &database, const string &file) {
+  NGT::Index	idx(database, true);
+  NGT::Timer	timer;
+  timer.start();
+  idx.saveImage(file);
+  timer.stop();
+  cerr << "Image saving time=" << timer.time << " (sec) " << timer.time * 1000.0 << " (msec)" << endl;
+}
+
+size_t
+NGT::Index::warmUp(const string &database, size_t threadSize) {
+  NGT::Index	idx(database, true);
+  NGT::Timer	timer;
+  timer.start();
+  size_t pages = idx.warmUp(threadSize);
+  timer.stop();
+  cerr << "Warm-up time=" << timer.time << " (sec) " << timer.time * 1000.0 << " (msec)" << endl;
+  return pages;
+}
+
+void
+NGT::Index::searchWithRefinement(NGT::SearchContainer &sc)
+{
+  size_t size = sc.size;
+  sc.size = size * getObjectSpace().getRefinementExpansion();
+  try {
+    getIndex().search(sc);
+  } catch(Exception &err) {
+    sc.size = size;
+    throw err;
+  }
+  sc.size = size;
+  if (sc.resultIsAvailable()) {
+    getObjectSpace().refine(sc.object, sc.getResult(), size);
+  } else {
+    ObjectDistances results;
+    results.moveFrom(sc.workingResult);
+    getObjectSpace().refine(sc.object, results, size);
+    for (auto &r : results) {
+      sc.workingResult.push(r);
+    }
+  }
+}
+
+void
+NGT::Index::searchWithRefinement(NGT::SearchQuery &searchQuery)
+{
+  Object *query = allocateObject(searchQuery.getQuery(), searchQuery.getQueryType());
+  try {
+    NGT::SearchContainer sc(searchQuery, *query);
+    searchWithRefinement(sc);
+  } catch(Exception &err) {
+    deleteObject(query);
+    throw err;
+  }
+  deleteObject(query);
+}
+
+void
+NGT::Index::batchSearch(const float *queries, size_t numOfQueries, size_t dimension, size_t size, float epsilon,
+			size_t threadSize, ObjectID *ids, Distance *distances, int edgeSize, Distance radius)
+{
+  if (size == 0 || numOfQueries == 0) {
+    return;
+  }
+#ifdef _OPENMP
+  if (threadSize == 0) {
+    threadSize = omp_get_max_threads();
+  }
+#endif
+  threadSize = threadSize == 0 ? 1 : threadSize;
+  std::atomic<bool> error(false);
+  std::string errorMessage;
+  ObjectSpace &objectSpace = getObjectSpace();
+#ifdef _OPENMP
+#pragma omp parallel num_threads(threadSize)
+#endif
+  {
+    // The query object and the result buffer are allocated once for each thread.
+    NGT::Object *query = 0;
+    NGT::ObjectDistances results;
+    results.reserve(size);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (size_t qidx = 0; qidx < numOfQueries; qidx++) {
+      ObjectID *qids = ids + qidx * size;
+      Distance *qdistances = distances + qidx * size;
+      std::fill(qids, qids + size, 0);
+      std::fill(qdistances, qdistances + size, FLT_MAX);
+      if (error.load(std::memory_order_relaxed)) {
+	continue;
+      }
+      try {
+	if (query == 0) {
+	  query = allocateObject(queries + qidx * dimension, dimension);
+	} else {
+	  objectSpace.setNormalizedObject(*query, queries + qidx * dimension, dimension);
+	}
+	NGT::SearchContainer sc(*query);
+	sc.setResults(&results);
+	sc.setSize(size);
+	sc.setRadius(radius);
+	sc.setEpsilon(epsilon);
+	sc.setEdgeSize(edgeSize);
+	search(sc);
+	for (size_t i = 0; i < results.size(); i++) {
+	  qids[i] = results[i].id;
+	  qdistances[i] = results[i].distance;
+	}
+      } catch(std::exception &err) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+	{
+	  error.store(true, std::memory_order_relaxed);
+	  errorMessage = err.what();
+	}
+      }
+    }
+    if (query != 0) {
+      deleteObject(query);
+    }
+  }
+  if (error) {
+    std::stringstream msg;
+    msg << "NGT::Index::batchSearch: " << errorMessage;
+    NGTThrowException(msg);
+  }
+}
+
 void 
 NGT::GraphIndex::constructObjectSpace(NGT::Property &prop) {
   assert(prop.dimension != 0);
@@ -307,6 +540,12 @@ NGT::GraphIndex::constructObjectSpace(NGT::Property &prop) {
   case NGT::ObjectSpace::ObjectType::Uint8 :
     objectSpace = new ObjectSpaceRepository<unsigned char, int>(prop.dimension, typeid(uint8_t), prop.distanceType);
     break;
+  case NGT::ObjectSpace::ObjectType::Float16 :
+    objectSpace = new ObjectSpaceRepository<float16, double>(prop.dimension, typeid(float16), prop.distanceType);
+    break;
+  case NGT::ObjectSpace::ObjectType::Qint8 :
+    objectSpace = new ObjectSpaceRepository<qint8, double>(prop.dimension, typeid(qint8), prop.distanceType, prop.refinementExpansion);
+    break;
   default:
     stringstream msg;
     msg << "Invalid Object Type in the property. " << prop.objectType;
@@ -314,6 +553,12 @@ NGT::GraphIndex::constructObjectSpace(NGT::Property &prop) {
   }
   prop.prefetchOffset = objectSpace->setPrefetchOffset(prop.prefetchOffset);
   prop.prefetchSize = objectSpace->setPrefetchSize(prop.prefetchSize);
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+  objectSpace->getRepository().setHugePage(prop.hugePage);
+#ifdef NGT_GRAPH_READ_ONLY_GRAPH
+  searchRepository.setHugePage(prop.hugePage);
+#endif
+#endif
 }
 
 void 
@@ -326,6 +571,7 @@ NGT::Index::Property::set(NGT::Property &prop) {
   if (prop.databaseType != DatabaseTypeNone) databaseType = prop.databaseType;
   if (prop.objectAlignment != ObjectAlignmentNone) objectAlignment = prop.objectAlignment;
   if (prop.pathAdjustmentInterval != -1) pathAdjustmentInterval = prop.pathAdjustmentInterval;
+  if (prop.checkpointInterval != -1) checkpointInterval = prop.checkpointInterval;
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
   if (prop.graphSharedMemorySize != -1) graphSharedMemorySize = prop.graphSharedMemorySize;
   if (prop.treeSharedMemorySize != -1) treeSharedMemorySize = prop.treeSharedMemorySize;
@@ -333,6 +579,10 @@ NGT::Index::Property::set(NGT::Property &prop) {
 #endif
   if (prop.prefetchOffset != -1) prefetchOffset = prop.prefetchOffset;
   if (prop.prefetchSize != -1) prefetchSize = prop.prefetchSize;
+  if (prop.refinementExpansion != -1) refinementExpansion = prop.refinementExpansion;
+  if (prop.inlineNeighborVectors != -1) inlineNeighborVectors = prop.inlineNeighborVectors;
+  if (prop.compressedGraph != -1) compressedGraph = prop.compressedGraph;
+  if (prop.hugePage != HugePage::ModeNone) hugePage = prop.hugePage;
 }
 
 void 
@@ -344,6 +594,7 @@ NGT::Index::Property::get(NGT::Property &prop) {
   prop.indexType = indexType;
   prop.databaseType = databaseType;
   prop.pathAdjustmentInterval = pathAdjustmentInterval;
+  prop.checkpointInterval = checkpointInterval;
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
   prop.graphSharedMemorySize = graphSharedMemorySize;
   prop.treeSharedMemorySize = treeSharedMemorySize;
@@ -351,6 +602,10 @@ NGT::Index::Property::get(NGT::Property &prop) {
 #endif
   prop.prefetchOffset = prefetchOffset;
   prop.prefetchSize = prefetchSize;
+  prop.refinementExpansion = refinementExpansion;
+  prop.inlineNeighborVectors = inlineNeighborVectors;
+  prop.compressedGraph = compressedGraph;
+  prop.hugePage = hugePage;
 }
 
 class CreateIndexJob {
@@ -477,9 +732,22 @@ public:
 };
 
 void 
-GraphAndTreeIndex::createTreeIndex() 
+GraphAndTreeIndex::createTreeIndex(size_t threadSize) 
 {
   ObjectRepository &fr = GraphIndex::objectSpace->getRepository();
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  if (DVPTree::isEmpty()) {
+    vector<ObjectID> ids;
+    ids.reserve(fr.size());
+    for (size_t id = 1; id < fr.size(); id++) {
+      if (!fr.isEmpty(id)) {
+	ids.push_back(id);
+      }
+    }
+    DVPTree::bulkLoad(ids, threadSize);
+    return;
+  }
+#endif
   for (size_t id = 0; id < fr.size(); id++){
     if (id % 100000 == 0) {
       cerr << " Processed id=" << id << endl;
@@ -507,6 +775,12 @@ GraphAndTreeIndex::createTreeIndex()
 
 void 
 NGT::GraphIndex::loadIndex(const string &ifile, bool readOnly) {
+#if defined(NGT_GRAPH_READ_ONLY_GRAPH) && !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  if (IndexImage::isImage(ifile)) {
+    loadImage(ifile);
+    return;
+  }
+#endif
   objectSpace->deserialize(ifile + "/obj");
 #ifdef NGT_GRAPH_READ_ONLY_GRAPH
   if (readOnly && property.indexType == NGT::Index::Property::IndexType::Graph) {
@@ -521,6 +795,24 @@ NGT::GraphIndex::loadIndex(const string &ifile, bool readOnly) {
 #endif
 }
 
+#if defined(NGT_GRAPH_READ_ONLY_GRAPH) && !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+// the objects and the graph are not loaded but referred to in the mapped image. the image is always read-only.
+void
+NGT::GraphIndex::loadImage(const string &file) {
+  image.open(file, property.hugePage);
+  readOnly = true;
+  objectSpace->getRepository().setInImage();
+  if (image.getObjectByteSize() < SearchGraphRepository::getVectorSize(*objectSpace)) {
+    NGTThrowException("GraphIndex::loadImage: The object size is inconsistent with the property. " + file);
+  }
+  if (!searchRepository.attach(image.getSection(IndexImage::SectionGraph), image.getSectionSize(IndexImage::SectionGraph),
+			       image.getObjectSize())) {
+    NGTThrowException("GraphIndex::loadImage: The graph is inconsistent with the image. " + file);
+  }
+  searchRepository.setObjectVectors(image.getSection(IndexImage::SectionObject), image.getObjectByteSize());
+}
+#endif
+
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
 NGT::GraphIndex::GraphIndex(const string &allocator, bool rdonly):readOnly(rdonly) {
   NGT::Property prop;
@@ -531,7 +823,8 @@ NGT::GraphIndex::GraphIndex(const string &allocator, bool rdonly):readOnly(rdonl
   initialize(allocator, prop);
 #ifdef NGT_GRAPH_READ_ONLY_GRAPH
   searchUnupdatableGraph = NeighborhoodGraph::Search::getMethod(prop.distanceType, prop.objectType,
-								objectSpace->getRepository().size());
+								objectSpace->getRepository().size(),
+								objectSpace->getPaddedDimension());
 #endif
 }
 
@@ -544,6 +837,16 @@ NGT::GraphIndex::initialize(const string &allocator, NGT::Property &prop) {
   constructObjectSpace(prop);
   repository.open(allocator + "/grp", prop.graphSharedMemorySize);
   objectSpace->open(allocator + "/obj", prop.objectSharedMemorySize);
+  // the objects are accessed at random, while the graph is read ahead as a whole.
+  repository.getAllocator().advise(MADV_WILLNEED);
+  objectSpace->getRepository().getAllocator().advise(MADV_RANDOM);
+#if defined(MADV_HUGEPAGE)
+  // the mapped files are backed by the huge pages only on the file systems which support them, e.g. tmpfs.
+  if (HugePage::isEnabled(prop.hugePage)) {
+    repository.getAllocator().advise(MADV_HUGEPAGE);
+    objectSpace->getRepository().getAllocator().advise(MADV_HUGEPAGE);
+  }
+#endif
   setProperty(prop);
 }
 #else // NGT_SHARED_MEMORY_ALLOCATOR
@@ -558,25 +861,141 @@ NGT::GraphIndex::GraphIndex(const string &database, bool rdOnly):readOnly(rdOnly
   loadIndex(database, readOnly);
 #ifdef NGT_GRAPH_READ_ONLY_GRAPH
   if (prop.searchType == "Large") {
-    searchUnupdatableGraph = NeighborhoodGraph::Search::getMethod(prop.distanceType, prop.objectType, 10000000);
+    searchUnupdatableGraph = NeighborhoodGraph::Search::getMethod(prop.distanceType, prop.objectType, 10000000,
+								  objectSpace->getPaddedDimension());
   } else if (prop.searchType == "Small") {
-    searchUnupdatableGraph = NeighborhoodGraph::Search::getMethod(prop.distanceType, prop.objectType, 0);
+    searchUnupdatableGraph = NeighborhoodGraph::Search::getMethod(prop.distanceType, prop.objectType, 0,
+								  objectSpace->getPaddedDimension());
   } else {
-    searchUnupdatableGraph = NeighborhoodGraph::Search::getMethod(prop.distanceType, prop.objectType,
-                                                                  objectSpace->getRepository().size());
+    size_t objectSize = image.isOpen() ? image.getObjectSize() : objectSpace->getRepository().size();
+    searchUnupdatableGraph = NeighborhoodGraph::Search::getMethod(prop.distanceType, prop.objectType, objectSize,
+                                                                  objectSpace->getPaddedDimension());
   }
 #endif
 }
 #endif
 
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+static void
+removeDirectory(const string &dir)
+{
+  DIR *dp = opendir(dir.c_str());
+  if (dp == 0) {
+    return;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(dp)) != 0) {
+    string name = entry->d_name;
+    if (name != "." && name != "..") {
+      unlink((dir + "/" + name).c_str());
+    }
+  }
+  closedir(dp);
+  rmdir(dir.c_str());
+}
+
+// the checkpoint is saved into the temporary directory first and then renamed,
+// so that a crash during the saving does not break the previous checkpoint.
+void
+GraphIndex::saveCheckpoint(ObjectID id, size_t count, bool treeLoaded)
+{
+  if (checkpoint.path.empty() || id >= objectSpace->getRepository().size()) {
+    return;
+  }
+  string checkpointPath = checkpoint.path + "/checkpoint";
+  try {
+    mkdir(checkpoint.path);
+  } catch(...) {}
+  removeDirectory(checkpointPath + ".tmp");
+  saveIndex(checkpointPath + ".tmp");
+  {
+    ofstream os(checkpointPath + ".tmp/cpt");
+    os << id << " " << count << " " << (treeLoaded ? 1 : 0) << endl;
+    if (!os) {
+      stringstream msg;
+      msg << "GraphIndex::saveCheckpoint: Cannot write. " << checkpointPath << ".tmp/cpt";
+      NGTThrowException(msg);
+    }
+  }
+  removeDirectory(checkpointPath + ".old");
+  ::rename(checkpointPath.c_str(), (checkpointPath + ".old").c_str());
+  if (::rename((checkpointPath + ".tmp").c_str(), checkpointPath.c_str()) != 0) {
+    stringstream msg;
+    msg << "GraphIndex::saveCheckpoint: Cannot rename. " << checkpointPath << ".tmp";
+    NGTThrowException(msg);
+  }
+  removeDirectory(checkpointPath + ".old");
+  cerr << "Saved the checkpoint. ID=" << id << " # of inserted objects=" << count << endl;
+}
+
+void
+GraphIndex::loadCheckpoint(const string &checkpointPath)
+{
+  ifstream is(checkpointPath + "/cpt");
+  int treeLoaded = 0;
+  is >> checkpoint.id >> checkpoint.count >> treeLoaded;
+  if (!is) {
+    stringstream msg;
+    msg << "GraphIndex::loadCheckpoint: Cannot read. " << checkpointPath << "/cpt";
+    NGTThrowException(msg);
+  }
+  checkpoint.treeLoaded = treeLoaded != 0;
+}
+
+// the previous checkpoint remains only when the saving is interrupted between the renames.
+string
+GraphIndex::getCheckpoint(const string &database)
+{
+  string checkpointPath = database + "/checkpoint";
+  struct stat st;
+  if (stat((checkpointPath + "/cpt").c_str(), &st) == 0) {
+    return checkpointPath;
+  }
+  if (stat((checkpointPath + ".old/cpt").c_str(), &st) == 0) {
+    return checkpointPath + ".old";
+  }
+  stringstream msg;
+  msg << "GraphIndex::getCheckpoint: No checkpoint. " << database;
+  NGTThrowException(msg);
+}
+
+void
+GraphIndex::removeCheckpoint(const string &database)
+{
+  string checkpointPath = database + "/checkpoint";
+  removeDirectory(checkpointPath + ".tmp");
+  removeDirectory(checkpointPath);
+  removeDirectory(checkpointPath + ".old");
+}
+#endif
+
+// return the count at which the next checkpoint is saved. zero means no checkpoint.
+static size_t
+getNextCheckpointCount(Index::Property &property, size_t count)
+{
+#if defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  return 0;
+#else
+  if (property.checkpointInterval <= 0) {
+    return 0;
+  }
+  return (count / property.checkpointInterval + 1) * property.checkpointInterval;
+#endif
+}
+
 void
 GraphIndex::createIndex()
 {
   GraphRepository &anngRepo = repository;
   ObjectRepository &fr = objectSpace->getRepository();
   size_t	pathAdjustCount = property.pathAdjustmentInterval;
-  NGT::ObjectID id = 1;
-  size_t count = 0;
+  NGT::ObjectID id = checkpoint.id;
+  size_t count = checkpoint.count;
+  size_t checkpointCount = getNextCheckpointCount(property, count);
+  // the paths are adjusted by the number of the inserted objects, which is restored from the checkpoint.
+  if (pathAdjustCount > 0) {
+    pathAdjustCount = (count / pathAdjustCount + 1) * pathAdjustCount;
+  }
   BuildTimeController buildTimeController(*this, NeighborhoodGraph::property);
   for (; id < fr.size(); id++) {
     if (id < anngRepo.size() && anngRepo[id] != 0) {
@@ -584,10 +1003,16 @@ GraphIndex::createIndex()
     }
     insert(id);
     buildTimeController.adjustEdgeSize(++count);
-    if (pathAdjustCount > 0 && pathAdjustCount <= id) {
+    if (pathAdjustCount > 0 && pathAdjustCount <= count) {
       GraphReconstructor::adjustPathsEffectively(static_cast<GraphIndex&>(*this));
       pathAdjustCount += property.pathAdjustmentInterval;
     }
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+    if (checkpointCount > 0 && checkpointCount <= count) {
+      saveCheckpoint(id + 1, count, false);
+      checkpointCount = getNextCheckpointCount(property, count);
+    }
+#endif
   }
 }
 
@@ -626,10 +1051,65 @@ searchMultipleQueryForCreation(GraphIndex &neighborhoodGraph,
   return cnt;
 }
 
+// the distance between the i-th and the j-th objects of a batch (j < i) in the packed lower triangle.
+static inline size_t
+getBatchDistanceIndex(size_t idxi, size_t idxj)
+{
+  return idxi * (idxi - 1) / 2 + idxj;
+}
+
+// compute the distances among the objects of a batch into the packed lower triangle without the diagonal.
+// the pairs are processed in square blocks so that the objects of both sides stay in the cache.
+static void
+computeBatchDistances(NGT::ObjectSpace &objectSpace,
+		      CreateIndexThreadPool::OutputJobQueue &output,
+		      size_t dataSize,
+		      size_t threadSize,
+		      vector<Distance> &distances)
+{
+  distances.resize(dataSize * (dataSize - 1) / 2);
+  const size_t blockSize = NGT_CREATION_DISTANCE_BLOCK_SIZE;
+  const size_t nOfBlocks = (dataSize + blockSize - 1) / blockSize;
+  vector<pair<size_t, size_t>> blocks;
+  blocks.reserve(nOfBlocks * (nOfBlocks + 1) / 2);
+  for (size_t bi = 0; bi < nOfBlocks; bi++) {
+    for (size_t bj = 0; bj <= bi; bj++) {
+      blocks.push_back(make_pair(bi, bj));
+    }
+  }
+  vector<Object*> objects(dataSize);
+  for (size_t idx = 0; idx < dataSize; idx++) {
+    objects[idx] = output[idx].object;
+  }
+  NGT::ObjectSpace::Comparator &comparator = objectSpace.getComparator();
+#ifdef _OPENMP
+  if (threadSize == 0) {
+    threadSize = omp_get_max_threads();
+  }
+#endif
+  threadSize = threadSize == 0 ? 1 : threadSize;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(threadSize)
+#endif
+  for (size_t bidx = 0; bidx < blocks.size(); bidx++) {
+    size_t begini = blocks[bidx].first * blockSize;
+    size_t endi = std::min(begini + blockSize, dataSize);
+    size_t beginj = blocks[bidx].second * blockSize;
+    size_t endj = std::min(beginj + blockSize, dataSize);
+    for (size_t idxi = begini; idxi < endi; idxi++) {
+      Distance *row = idxi == 0 ? 0 : &distances[getBatchDistanceIndex(idxi, 0)];
+      for (size_t idxj = beginj; idxj < endj && idxj < idxi; idxj++) {
+	row[idxj] = comparator(*objects[idxi], *objects[idxj]);
+      }
+    }
+  }
+}
+
 void
 insertMultipleSearchResults(GraphIndex &neighborhoodGraph, 
 			    CreateIndexThreadPool::OutputJobQueue &output, 
-			    size_t dataSize)
+			    size_t dataSize,
+			    size_t threadSize = 1)
 {
   // compute distances among all of the resultant objects
   if (neighborhoodGraph.NeighborhoodGraph::property.graphType == NeighborhoodGraph::GraphTypeANNG ||
@@ -645,12 +1125,14 @@ insertMultipleSearchResults(GraphIndex &neighborhoodGraph,
 
     sort(output.begin(), output.end());	// sort by batchIdx
 
+    vector<Distance> distances;
+    computeBatchDistances(*neighborhoodGraph.objectSpace, output, dataSize, threadSize, distances);
     for (size_t idxi = 0; idxi < dataSize; idxi++) {
       // add distances
       ObjectDistances &objs = *output[idxi].results;
       for (size_t idxj = 0; idxj < idxi; idxj++) {
 	ObjectDistance	r;
-	r.distance = neighborhoodGraph.objectSpace->getComparator()(*output[idxi].object, *output[idxj].object);
+	r.distance = distances[getBatchDistanceIndex(idxi, idxj)];
 	r.id = output[idxj].id;
 	objs.push_back(r);
       }
@@ -662,6 +1144,10 @@ insertMultipleSearchResults(GraphIndex &neighborhoodGraph,
     } // for (size_t idxi ....
   } // if (neighborhoodGraph.graphType == NeighborhoodGraph::GraphTypeUDNNG)
   // insert resultant objects into the graph as edges
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  std::vector<std::pair<ObjectID, ObjectDistances*>> nodes;
+  bool parallel = threadSize > 1 && neighborhoodGraph.isParallelInsertionAvailable();
+#endif
   for (size_t i = 0; i < dataSize; i++) {
     CreateIndexJob &gr = output[i];
     if ((*gr.results).size() == 0) {
@@ -673,8 +1159,19 @@ insertMultipleSearchResults(GraphIndex &neighborhoodGraph,
       cerr << "  The number of edges for the node=" << gr.results->size() << endl;
       cerr << "  The pruned parameter (edgeSizeForSearch [-S])=" << neighborhoodGraph.NeighborhoodGraph::property.edgeSizeForSearch << endl;
     }
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+    if (parallel) {
+      nodes.push_back(std::make_pair(gr.id, gr.results));
+      continue;
+    }
+#endif
     neighborhoodGraph.insertNode(gr.id, *gr.results);
   }
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  if (parallel) {
+    neighborhoodGraph.insertNodesInParallel(nodes, threadSize);
+  }
+#endif
 }
 
 void 
@@ -685,11 +1182,15 @@ GraphIndex::createIndex(size_t threadPoolSize)
   } else {
     Timer		timer;
     size_t	timerInterval = 100000;
-    size_t	timerCount = timerInterval;
-    size_t	count = 0;
+    size_t	count = checkpoint.count;
+    size_t	timerCount = (count / timerInterval + 1) * timerInterval;
     timer.start();
 
     size_t	pathAdjustCount = property.pathAdjustmentInterval;
+    if (pathAdjustCount > 0) {
+      pathAdjustCount = (count / pathAdjustCount + 1) * pathAdjustCount;
+    }
+    size_t	checkpointCount = getNextCheckpointCount(property, count);
     CreateIndexThreadPool threads(threadPoolSize);
     CreateIndexSharedData sd(*this);
 
@@ -701,7 +1202,7 @@ GraphIndex::createIndex(size_t threadPoolSize)
 
     try {
       CreateIndexJob job;
-      NGT::ObjectID id = 1;
+      NGT::ObjectID id = checkpoint.id;
       for (;;) {
 	// search for the nearest neighbors
 	size_t cnt = searchMultipleQueryForCreation(*this, id, job, threads);
@@ -715,7 +1216,7 @@ GraphIndex::createIndex(size_t threadPoolSize)
 	  cnt = output.size();
 	}
 	// insertion
-	insertMultipleSearchResults(*this, output, cnt);
+	insertMultipleSearchResults(*this, output, cnt, threadPoolSize);
 
 	while (!output.empty()) {
 	  delete output.front().results;
@@ -734,9 +1235,15 @@ GraphIndex::createIndex(size_t threadPoolSize)
 	}
 	buildTimeController.adjustEdgeSize(count);
 	if (pathAdjustCount > 0 && pathAdjustCount <= count) {
-	  GraphReconstructor::adjustPathsEffectively(static_cast<GraphIndex&>(*this));
+	  GraphReconstructor::adjustPathsEffectively(static_cast<GraphIndex&>(*this), threadPoolSize);
 	  pathAdjustCount += property.pathAdjustmentInterval;
 	}
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+	if (checkpointCount > 0 && checkpointCount <= count) {
+	  saveCheckpoint(id, count, false);
+	  checkpointCount = getNextCheckpointCount(property, count);
+	}
+#endif
       }
     } catch(Exception &err) {
       threads.terminate();
@@ -754,11 +1261,15 @@ GraphAndTreeIndex::createIndex(size_t threadPoolSize)
 
   Timer	timer;
   size_t	timerInterval = 100000;
-  size_t	timerCount = timerInterval;
-  size_t	count = 0;
+  size_t	count = checkpoint.count;
+  size_t	timerCount = (count / timerInterval + 1) * timerInterval;
   timer.start();
 
   size_t	pathAdjustCount = property.pathAdjustmentInterval;
+  if (pathAdjustCount > 0) {
+    pathAdjustCount = (count / pathAdjustCount + 1) * pathAdjustCount;
+  }
+  size_t	checkpointCount = getNextCheckpointCount(property, count);
   CreateIndexThreadPool threads(threadPoolSize);
 
   CreateIndexSharedData sd(*this);
@@ -769,9 +1280,19 @@ GraphAndTreeIndex::createIndex(size_t threadPoolSize)
 
   BuildTimeController buildTimeController(*this, NeighborhoodGraph::property);
 
+  // when the index is built from scratch, the tree is loaded with all of the objects at once ahead of the graph.
+  // a resumed construction continues with the tree of the checkpoint.
+  bool treeLoaded = checkpoint.treeLoaded;
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+  if (!treeLoaded && DVPTree::isEmpty()) {
+    createTreeIndex(threadPoolSize);
+    treeLoaded = true;
+  }
+#endif
+
   try {
     CreateIndexJob job;
-    NGT::ObjectID id = 1;
+    NGT::ObjectID id = checkpoint.id;
     for (;;) {
       size_t cnt = searchMultipleQueryForCreation(*this, id, job, threads);
 
@@ -785,9 +1306,9 @@ GraphAndTreeIndex::createIndex(size_t threadPoolSize)
 	cnt = output.size();
       }
 
-      insertMultipleSearchResults(*this, output, cnt);
+      insertMultipleSearchResults(*this, output, cnt, threadPoolSize);
 
-      for (size_t i = 0; i < cnt; i++) {
+      for (size_t i = 0; i < cnt && !treeLoaded; i++) {
 	CreateIndexJob &job = output[i];
 	if (((job.results->size() > 0) && ((*job.results)[0].distance != 0.0)) ||
 	    (job.results->size() == 0)) {
@@ -833,9 +1354,15 @@ GraphAndTreeIndex::createIndex(size_t threadPoolSize)
       }
       buildTimeController.adjustEdgeSize(count);
       if (pathAdjustCount > 0 && pathAdjustCount <= count) {
-	GraphReconstructor::adjustPathsEffectively(static_cast<GraphIndex&>(*this));
+	GraphReconstructor::adjustPathsEffectively(static_cast<GraphIndex&>(*this), threadPoolSize);
 	pathAdjustCount += property.pathAdjustmentInterval;
       }
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+      if (checkpointCount > 0 && checkpointCount <= count) {
+	saveCheckpoint(id, count, treeLoaded);
+	checkpointCount = getNextCheckpointCount(property, count);
+      }
+#endif
     }
   } catch(Exception &err) {
     threads.terminate();
@@ -905,6 +1432,8 @@ GraphAndTreeIndex::createIndex(const vector<pair<NGT::Object*, size_t> > &object
 	  // add distances from a current object to subsequence objects to imitate of sequential insertion.
 
 	  sort(output.begin(), output.end());	
+	  vector<Distance> distances;
+	  computeBatchDistances(*GraphIndex::objectSpace, output, cnt, threadPoolSize, distances);
 	  for (size_t idxi = 0; idxi < cnt; idxi++) {
 	    // add distances
 	    ObjectDistances &objs = *output[idxi].results;
@@ -914,7 +1443,7 @@ GraphAndTreeIndex::createIndex(const vector<pair<NGT::Object*, size_t> > &object
 		continue;
 	      }
 	      ObjectDistance	r;
-	      r.distance = GraphIndex::objectSpace->getComparator()(*output[idxi].object, *output[idxj].object);
+	      r.distance = distances[getBatchDistanceIndex(idxi, idxj)];
 	      r.id = output[idxj].id;
 	      objs.push_back(r);
 	    }
@@ -33,6 +33,7 @@
 #include	"NGT/Tree.h"
 #include	"NGT/Thread.h"
 #include	"NGT/Graph.h"
+#include	"NGT/IndexImage.h"
 
 
 namespace NGT {
@@ -72,6 +73,7 @@ namespace NGT {
 	indexType	= IndexType::GraphAndTree;
 	objectAlignment	= ObjectAlignment::ObjectAlignmentFalse;
 	pathAdjustmentInterval = 0;
+	checkpointInterval = 0;
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
 	databaseType	= DatabaseType::MemoryMappedFile;
       	graphSharedMemorySize	= 512; // MB
@@ -82,6 +84,10 @@ namespace NGT {
 #endif
 	prefetchOffset	= 0;
 	prefetchSize	= 0;
+	refinementExpansion	= 0;
+	inlineNeighborVectors	= 0;
+	compressedGraph	= 0;
+	hugePage	= HugePage::ModeDisabled;
       }
       void clear() {
 	dimension 	= -1;
@@ -92,6 +98,7 @@ namespace NGT {
 	databaseType	= DatabaseTypeNone;
 	objectAlignment	= ObjectAlignment::ObjectAlignmentNone;
 	pathAdjustmentInterval	= -1;
+	checkpointInterval	= -1;
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
       	graphSharedMemorySize	= -1;
       	treeSharedMemorySize	= -1;
@@ -99,6 +106,10 @@ namespace NGT {
 #endif
 	prefetchOffset	= -1;
 	prefetchSize	= -1;
+	refinementExpansion	= -1;
+	inlineNeighborVectors	= -1;
+	compressedGraph	= -1;
+	hugePage	= HugePage::ModeNone;
       }
 
       void exportProperty(NGT::PropertySet &p) {
@@ -107,6 +118,8 @@ namespace NGT {
 	switch (objectType) {
 	case ObjectSpace::ObjectType::Uint8: p.set("ObjectType", "Integer-1"); break;
 	case ObjectSpace::ObjectType::Float: p.set("ObjectType", "Float-4"); break;
+	case ObjectSpace::ObjectType::Float16: p.set("ObjectType", "Float-2"); break;
+	case ObjectSpace::ObjectType::Qint8: p.set("ObjectType", "ScalarQuantized-1"); break;
 	default : std::cerr << "Fatal error. Invalid object type. " << objectType << std::endl; abort();
 	}
 	switch (distanceType) {
@@ -138,6 +151,7 @@ namespace NGT {
 	default : std::cerr << "Fatal error. Invalid objectAlignment. " << objectAlignment << std::endl; abort();
 	}
 	p.set("PathAdjustmentInterval", pathAdjustmentInterval);
+	p.set("CheckpointInterval", checkpointInterval);
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
 	p.set("GraphSharedMemorySize", graphSharedMemorySize);
 	p.set("TreeSharedMemorySize", treeSharedMemorySize);
@@ -145,6 +159,16 @@ namespace NGT {
 #endif
 	p.set("PrefetchOffset", prefetchOffset);
 	p.set("PrefetchSize", prefetchSize);
+	p.set("RefinementExpansion", refinementExpansion);
+	p.set("InlineNeighborVectors", inlineNeighborVectors);
+	p.set("CompressedGraph", compressedGraph);
+	switch (hugePage) {
+	case HugePage::ModeNone:	p.set("HugePage", "None"); break;
+	case HugePage::ModeDisabled:	p.set("HugePage", "Disabled"); break;
+	case HugePage::ModeTransparent:	p.set("HugePage", "Transparent"); break;
+	case HugePage::ModeExplicit:	p.set("HugePage", "Explicit"); break;
+	default : std::cerr << "Fatal error. Invalid huge page mode. " << hugePage << std::endl; abort();
+	}
       }
 
       void importProperty(NGT::PropertySet &p) {
@@ -155,6 +179,10 @@ namespace NGT {
 	if (it != p.end()) {
 	  if (it->second == "Float-4") {
 	    objectType = ObjectSpace::ObjectType::Float;
+	  } else if (it->second == "Float-2") {
+	    objectType = ObjectSpace::ObjectType::Float16;
+	  } else if (it->second == "ScalarQuantized-1") {
+	    objectType = ObjectSpace::ObjectType::Qint8;
 	  } else if (it->second == "Integer-1") {
 	    objectType = ObjectSpace::ObjectType::Uint8;
 	  } else {
@@ -229,6 +257,7 @@ namespace NGT {
 	  objectAlignment = ObjectAlignment::ObjectAlignmentFalse;
 	}
 	pathAdjustmentInterval  = p.getl("PathAdjustmentInterval", pathAdjustmentInterval);
+	checkpointInterval  = p.getl("CheckpointInterval", checkpointInterval);
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
 	graphSharedMemorySize  = p.getl("GraphSharedMemorySize", graphSharedMemorySize);
 	treeSharedMemorySize   = p.getl("TreeSharedMemorySize", treeSharedMemorySize);
@@ -236,6 +265,23 @@ namespace NGT {
 #endif
 	prefetchOffset = p.getl("PrefetchOffset", prefetchOffset);
 	prefetchSize = p.getl("PrefetchSize", prefetchSize);
+	refinementExpansion = p.getl("RefinementExpansion", refinementExpansion);
+	inlineNeighborVectors = p.getl("InlineNeighborVectors", inlineNeighborVectors);
+	compressedGraph = p.getl("CompressedGraph", compressedGraph);
+	it = p.find("HugePage");
+	if (it != p.end()) {
+	  if (it->second == "None") {
+	    hugePage = HugePage::ModeNone;
+	  } else if (it->second == "Disabled") {
+	    hugePage = HugePage::ModeDisabled;
+	  } else if (it->second == "Transparent") {
+	    hugePage = HugePage::ModeTransparent;
+	  } else if (it->second == "Explicit") {
+	    hugePage = HugePage::ModeExplicit;
+	  } else {
+	    std::cerr << "Invalid Huge Page in the property. " << it->first << ":" << it->second << std::endl;
+	  }
+	}
 	it = p.find("SearchType");
 	if (it != p.end()) {
 	  searchType = it->second;
@@ -252,6 +298,7 @@ namespace NGT {
       DatabaseType	databaseType;
       ObjectAlignment	objectAlignment;
       int		pathAdjustmentInterval;
+      int		checkpointInterval;	// save the checkpoint every specified number of inserted objects during the construction.
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
       int		graphSharedMemorySize;
       int		treeSharedMemorySize;
@@ -259,6 +306,10 @@ namespace NGT {
 #endif
       int		prefetchOffset;
       int		prefetchSize;
+      int		refinementExpansion;	// keep the originals of the scalar quantized objects when it is not zero.
+      int		inlineNeighborVectors;	// save the copies of the neighbor objects (sgv) for the read-only graph when it is not zero.
+      int		compressedGraph;	// save the compressed graph (sgc), which is used instead of the sgr, when it is not zero.
+      HugePage::Mode	hugePage;	// back the objects, the read-only graph and the image with the huge pages.
       std::string	searchType;	// test
     };
 
@@ -271,14 +322,14 @@ namespace NGT {
       Distance	distance; // the distance between the centroid and the inserted object.
     };
 
-    Index():index(0) {}
+    Index():index(0), maxOriginalID(0) {}
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
     Index(NGT::Property &prop, const std::string &database);
 #else
     Index(NGT::Property &prop);
 #endif
-    Index(const std::string &database, bool rdOnly = false):index(0) { open(database, rdOnly); }
-    Index(const std::string &database, NGT::Property &prop):index(0) { open(database, prop);  }
+    Index(const std::string &database, bool rdOnly = false):index(0), maxOriginalID(0) { open(database, rdOnly); }
+    Index(const std::string &database, NGT::Property &prop):index(0), maxOriginalID(0) { open(database, prop);  }
     virtual ~Index() { close(); }
 
     void open(const std::string &database, NGT::Property &prop) {
@@ -293,6 +344,8 @@ namespace NGT {
 	index = 0;
       } 
       path.clear();
+      originalIDs.clear();
+      maxOriginalID = 0;
     }
     void save() {
       if (path.empty()) {
@@ -314,20 +367,31 @@ namespace NGT {
     template<typename T> size_t append(std::vector<T> &object);
     static void append(const std::string &database, const std::string &dataFile, size_t threadSize, size_t dataSize); 
     static void append(const std::string &database, const float *data, size_t dataSize, size_t threadSize);
+    static void resume(const std::string &database, size_t threadSize = 0);
     static void remove(const std::string &database, std::vector<ObjectID> &objects, bool force = false);
     static void exportIndex(const std::string &database, const std::string &file);
     static void importIndex(const std::string &database, const std::string &file);
-    virtual void load(const std::string &ifile, size_t dataSize) { getIndex().load(ifile, dataSize); }
-    virtual void append(const std::string &ifile, size_t dataSize) { getIndex().append(ifile, dataSize); }
+    static void saveImage(const std::string &database, const std::string &file);
+    static size_t warmUp(const std::string &database, size_t threadSize = 0);
+    virtual void load(const std::string &ifile, size_t dataSize) {
+      getIndex().load(ifile, dataSize);
+      updateOriginalIDs();
+    }
+    virtual void append(const std::string &ifile, size_t dataSize) {
+      getIndex().append(ifile, dataSize);
+      updateOriginalIDs();
+    }
     virtual void append(const float *data, size_t dataSize) { 
       redirector.begin();
       try {
 	getIndex().append(data, dataSize); 
       } catch(Exception &err) {
 	redirector.end();
+	updateOriginalIDs();
 	throw err;
       }
       redirector.end();
+      updateOriginalIDs();
     }
     virtual void append(const double *data, size_t dataSize) { 
       redirector.begin();
@@ -335,11 +399,15 @@ namespace NGT {
 	getIndex().append(data, dataSize); 
       } catch(Exception &err) {
 	redirector.end();
+	updateOriginalIDs();
 	throw err;
       }
       redirector.end();
+      updateOriginalIDs();
     }
     virtual size_t getObjectRepositorySize() { return getIndex().getObjectRepositorySize(); }
+    // the index image is only searched in place. its objects are neither referred to nor updated.
+    virtual bool isImage() { return getIndex().isImage(); }
     virtual void createIndex(size_t threadNumber) {
       redirector.begin();
       try {
@@ -350,7 +418,13 @@ namespace NGT {
       }
       redirector.end();
     }
-    virtual void saveIndex(const std::string &ofile) { getIndex().saveIndex(ofile); }
+    virtual void saveIndex(const std::string &ofile) {
+      getIndex().saveIndex(ofile);
+      if (!originalIDs.empty()) {
+	saveOriginalIDs(ofile, originalIDs);
+      }
+    }
+    virtual void setCheckpointPath(const std::string &database) { getIndex().setCheckpointPath(database); }
     virtual void loadIndex(const std::string &ofile) { getIndex().loadIndex(ofile); }
     virtual Object *allocateObject(const std::string &textLine, const std::string &sep) { return getIndex().allocateObject(textLine, sep); }
     virtual Object *allocateObject(const std::vector<double> &obj) { return getIndex().allocateObject(obj); }
@@ -363,12 +437,39 @@ namespace NGT {
     virtual void deleteObject(Object *po) { getIndex().deleteObject(po); }
     virtual void linearSearch(NGT::SearchContainer &sc) { getIndex().linearSearch(sc); }
     virtual void linearSearch(NGT::SearchQuery &sc) { getIndex().linearSearch(sc); }
-    virtual void search(NGT::SearchContainer &sc) { getIndex().search(sc); }
-    virtual void search(NGT::SearchQuery &sc) { getIndex().search(sc); }
+    virtual void search(NGT::SearchContainer &sc) {
+      if (getObjectSpace().getRefinementExpansion() != 0) {
+	searchWithRefinement(sc);
+      } else {
+	getIndex().search(sc);
+      }
+    }
+    virtual void search(NGT::SearchQuery &sc) {
+      if (getObjectSpace().getRefinementExpansion() != 0) {
+	searchWithRefinement(sc);
+      } else {
+	getIndex().search(sc);
+      }
+    }
+    // search the expanded number of objects with the quantized distances and refine them with the originals.
+    void searchWithRefinement(NGT::SearchContainer &sc);
+    void searchWithRefinement(NGT::SearchQuery &sc);
     virtual void search(NGT::SearchContainer &sc, ObjectDistances &seeds) { getIndex().search(sc, seeds); }
-    virtual void remove(ObjectID id, bool force = false) { getIndex().remove(id, force); }
+    // The queries are a numOfQueries x dimension row-major matrix. The results are stored in numOfQueries x size
+    // matrices of ids and distances. Missing results are filled with the id 0 and FLT_MAX.
+    // The thread size 0 means the default number of the OpenMP threads.
+    void batchSearch(const float *queries, size_t numOfQueries, size_t dimension, size_t size, float epsilon,
+		     size_t threadSize, ObjectID *ids, Distance *distances, int edgeSize = -1, Distance radius = FLT_MAX);
+    virtual void remove(ObjectID id, bool force = false) {
+      getIndex().remove(id, force);
+      if (id < originalIDs.size()) {
+	originalIDs[id] = 0;
+      }
+    }
     virtual void exportIndex(const std::string &file) { getIndex().exportIndex(file); }
     virtual void importIndex(const std::string &file) { getIndex().importIndex(file); }
+    virtual void saveImage(const std::string &file) { getIndex().saveImage(file); }
+    virtual size_t warmUp(size_t threadSize = 0) { return getIndex().warmUp(threadSize); }
     virtual bool verify(std::vector<uint8_t> &status, bool info = false, char mode = '-') { return getIndex().verify(status, info, mode); }
     virtual ObjectSpace &getObjectSpace() { return getIndex().getObjectSpace(); }
     virtual size_t getSharedMemorySize(std::ostream &os, SharedMemoryAllocator::GetMemorySizeType t = SharedMemoryAllocator::GetTotalMemorySize) {
@@ -397,25 +498,41 @@ namespace NGT {
     void enableLog() { redirector.disable(); }
     void disableLog() { redirector.enable(); }
 
-    static void destroy(const std::string &path) {
-#ifdef NGT_SHARED_MEMORY_ALLOCATOR
-      std::remove(std::string(path + "/grp").c_str());
-      std::remove(std::string(path + "/grpc").c_str());
-      std::remove(std::string(path + "/trei").c_str());
-      std::remove(std::string(path + "/treic").c_str());
-      std::remove(std::string(path + "/trel").c_str());
-      std::remove(std::string(path + "/trelc").c_str());
-      std::remove(std::string(path + "/objpo").c_str());
-      std::remove(std::string(path + "/objpoc").c_str());
-#else
-      std::remove(std::string(path + "/grp").c_str());
-      std::remove(std::string(path + "/tre").c_str());
-      std::remove(std::string(path + "/obj").c_str());
-#endif
-      std::remove(std::string(path + "/prf").c_str());
-      std::remove(path.c_str());
-    }
+    static void destroy(const std::string &path);
     
+    // the ID of the object before the index was reordered. 0 is returned for the removed objects.
+    ObjectID getOriginalID(ObjectID id) {
+      if (originalIDs.empty()) {
+	return id;
+      }
+      return id < originalIDs.size() ? originalIDs[id] : 0;
+    }
+    std::vector<ObjectID> &getOriginalIDs() { return originalIDs; }
+    // once the index is reordered, the table covers all of the objects. the objects added after that
+    // get the new original IDs above the current maximum, so that they never collide with the others.
+    void updateOriginalIDs() {
+      if (originalIDs.empty()) {
+	return;
+      }
+      size_t size = getObjectSpace().getRepository().size();
+      while (originalIDs.size() < size) {
+	originalIDs.push_back(getNewOriginalID());
+      }
+    }
+    void updateOriginalID(ObjectID id) {
+      if (originalIDs.empty()) {
+	return;
+      }
+      if (id < originalIDs.size()) {
+	// the ID of the removed object is reused.
+	originalIDs[id] = getNewOriginalID();
+      } else {
+	updateOriginalIDs();
+      }
+    }
+    static bool loadOriginalIDs(const std::string &database, std::vector<ObjectID> &originalIDs);
+    static void saveOriginalIDs(const std::string &database, std::vector<ObjectID> &originalIDs);
+
     static void version(std::ostream &os);
     static std::string getVersion();
     std::string getPath(){ return path; }
@@ -445,8 +562,17 @@ namespace NGT {
     static void loadAndCreateIndex(Index &index, const std::string &database, const std::string &dataFile,
 				   size_t threadSize, size_t dataSize);
 
+    ObjectID getNewOriginalID() {
+      if (maxOriginalID == 0) {
+	maxOriginalID = *std::max_element(originalIDs.begin(), originalIDs.end());
+      }
+      return ++maxOriginalID;
+    }
+
     Index *index;
     std::string path;
+    std::vector<ObjectID> originalIDs;	// empty unless the index is reordered.
+    ObjectID maxOriginalID;		// the cached maximum of the original IDs. 0 means not yet computed.
     StdOstreamRedirector redirector;
   };
 
@@ -492,6 +618,18 @@ namespace NGT {
 	ObjectSpaceRepository<unsigned char, int> *os = (ObjectSpaceRepository<unsigned char, int>*)objectSpace;
 #ifndef NGT_SHARED_MEMORY_ALLOCATOR
 	os->deleteAll();
+#endif
+	delete os;
+      } else if (property.objectType == NGT::ObjectSpace::ObjectType::Float16) {
+	ObjectSpaceRepository<float16, double> *os = (ObjectSpaceRepository<float16, double>*)objectSpace;
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+	os->deleteAll();
+#endif
+	delete os;
+      } else if (property.objectType == NGT::ObjectSpace::ObjectType::Qint8) {
+	ObjectSpaceRepository<qint8, double> *os = (ObjectSpaceRepository<qint8, double>*)objectSpace;
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+	os->deleteAll();
 #endif
 	delete os;
       } else {
@@ -505,6 +643,10 @@ namespace NGT {
       if (ifile.empty()) {
 	return;
       }
+      if (VectorFile::isBinary(ifile)) {
+	objectSpace->readBinary(ifile, dataSize);
+	return;
+      }
       std::istream *is;
       std::ifstream *ifs = 0;
       if (ifile == "-") {
@@ -533,6 +675,10 @@ namespace NGT {
     }
 
     virtual void append(const std::string &ifile, size_t dataSize = 0) {
+      if (VectorFile::isBinary(ifile)) {
+	objectSpace->appendBinary(ifile, dataSize);
+	return;
+      }
       std::ifstream is(ifile.c_str());
       objectSpace->appendText(is, dataSize);
     }
@@ -558,10 +704,77 @@ namespace NGT {
 	NGTThrowException(msg);
       }
       repository.serialize(osg);
+#ifdef NGT_GRAPH_READ_ONLY_GRAPH
+      // the graph files are written into the temporary files first and then renamed, because the mapped
+      // graph may be read from the files being replaced, when the read-only index is saved to its own path.
+      std::string sfname = ofile + "/sgr";
+      {
+	std::ofstream oss(sfname + ".tmp");
+	if (!oss.is_open()) {
+	  std::stringstream msg;
+	  msg << "saveIndex:: Cannot open. " << sfname << ".tmp";
+	  NGTThrowException(msg);
+	}
+	if (readOnly && repository.size() == 0) {
+	  searchRepository.serialize(oss);
+	} else {
+	  SearchGraphRepository::serialize(oss, repository);
+	}
+      }
+      renameFile(sfname + ".tmp", sfname);
+      std::string cfname = ofile + "/sgc";
+      if (property.compressedGraph > 0) {
+	{
+	  std::ofstream osc(cfname + ".tmp");
+	  if (!osc.is_open()) {
+	    std::stringstream msg;
+	    msg << "saveIndex:: Cannot open. " << cfname << ".tmp";
+	    NGTThrowException(msg);
+	  }
+	  // the order of the edges is lost, so that only the edges for the search are kept.
+	  size_t truncation = NeighborhoodGraph::property.edgeSizeForSearch > 0 ? NeighborhoodGraph::property.edgeSizeForSearch : 0;
+	  if (readOnly && repository.size() == 0) {
+	    searchRepository.serializeCompressed(osc, truncation);
+	  } else {
+	    SearchGraphRepository::serializeCompressed(osc, repository, truncation);
+	  }
+	}
+	renameFile(cfname + ".tmp", cfname);
+      } else {
+	std::remove(cfname.c_str());
+      }
+      std::string vfname = ofile + "/sgv";
+      if (property.inlineNeighborVectors > 0 && property.compressedGraph <= 0 && objectSpace != 0) {
+	{
+	  std::ofstream osv(vfname + ".tmp");
+	  if (!osv.is_open()) {
+	    std::stringstream msg;
+	    msg << "saveIndex:: Cannot open. " << vfname << ".tmp";
+	    NGTThrowException(msg);
+	  }
+	  if (readOnly && repository.size() == 0) {
+	    searchRepository.serializeVectors(osv, *objectSpace);
+	  } else {
+	    SearchGraphRepository::serializeVectors(osv, repository, *objectSpace);
+	  }
+	}
+	renameFile(vfname + ".tmp", vfname);
+      } else {
+	std::remove(vfname.c_str());
+      }
+#endif
 #endif
       saveProperty(ofile);
     }
 
+    static void renameFile(const std::string &from, const std::string &to) {
+      if (std::rename(from.c_str(), to.c_str()) != 0) {
+	std::stringstream msg;
+	msg << "saveIndex:: Cannot rename. " << from << " to " << to;
+	NGTThrowException(msg);
+      }
+    }
+
     void saveProperty(const std::string &file) {
       NGT::PropertySet prop;
       assert(property.dimension != 0);
@@ -579,6 +792,9 @@ namespace NGT {
     }
 
     virtual void loadIndex(const std::string &ifile, bool readOnly);
+#if defined(NGT_GRAPH_READ_ONLY_GRAPH) && !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+    void loadImage(const std::string &file);
+#endif
 
     virtual void exportIndex(const std::string &ofile) {
       try {
@@ -606,7 +822,78 @@ namespace NGT {
       repository.deserializeAsText(isg);
     }
 
+#if defined(NGT_GRAPH_READ_ONLY_GRAPH) && !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+    virtual void saveImage(const std::string &file) {
+      if (image.isOpen()) {
+	NGTThrowException("saveImage: The index is already an image.");
+      }
+      if (property.objectType == NGT::ObjectSpace::ObjectType::Qint8) {
+	NGTThrowException("saveImage: The scalar quantized objects are not supported.");
+      }
+      IndexImage::Writer writer(file);
+      writeImage(writer);
+      writer.close();
+    }
+
+    virtual void writeImage(IndexImage::Writer &writer) {
+      NGT::PropertySet prop;
+      GraphIndex::property.exportProperty(prop);
+      NeighborhoodGraph::property.exportProperty(prop);
+      std::stringstream text;
+      prop.save(text);
+      writer.beginSection(IndexImage::SectionProperty);
+      writer.write(text.str().data(), text.str().size());
+
+      ObjectRepository &repo = objectSpace->getRepository();
+      IndexImage::Header &header = writer.getHeader();
+      size_t vectorSize = SearchGraphRepository::getVectorSize(*objectSpace);
+      header.objectSize = repo.size();
+      header.objectByteSize = IndexImage::getObjectByteSize(vectorSize);
+      std::vector<uint8_t> vector(header.objectByteSize);
+      writer.beginSection(IndexImage::SectionObject);
+      for (size_t id = 0; id < repo.size(); id++) {
+	std::fill(vector.begin(), vector.end(), 0);
+	if (!repo.isEmpty(id)) {
+	  memcpy(vector.data(), objectSpace->getObject(id), vectorSize);
+	}
+	writer.write(vector.data(), vector.size());
+      }
+
+      writer.beginSection(IndexImage::SectionGraph);
+      if (readOnly && repository.size() == 0) {
+	searchRepository.serialize(writer.getStream());
+      } else {
+	SearchGraphRepository::serialize(writer.getStream(), repository);
+      }
+      writer.endSection();
+    }
+#else
+    virtual void saveImage(const std::string &file) {
+      NGTThrowException("saveImage: Not supported. The read-only graph is disabled or the shared memory is enabled.");
+    }
+#endif
+
+    // pre-faults the mapped pages of the index in parallel so that the first searches do not wait for the disk.
+    // the graph is read first and then the objects. the indexes on the heap are already resident.
+    virtual size_t warmUp(size_t threadSize = 0) {
+      size_t pages = 0;
+#ifdef NGT_SHARED_MEMORY_ALLOCATOR
+      pages += repository.getAllocator().prefault(threadSize);
+      pages += objectSpace->getRepository().getAllocator().prefault(threadSize);
+#elif defined(NGT_GRAPH_READ_ONLY_GRAPH)
+      if (image.isOpen()) {
+	pages += image.prefault(threadSize);
+      } else {
+	pages += searchRepository.prefault(threadSize);
+      }
+#endif
+      return pages;
+    }
+
     void linearSearch(NGT::SearchContainer &sc) {
+      if (isImage()) {
+	NGTThrowException("GraphIndex::linearSearch: Not supported for the index image.");
+      }
       ObjectSpace::ResultSet results;
       objectSpace->linearSearch(sc.object, sc.radius, sc.size, results);
       ObjectDistances &qresults = sc.getResult();
@@ -614,6 +901,9 @@ namespace NGT {
     }
 
     void linearSearch(NGT::SearchQuery &searchQuery) {
+      if (isImage()) {
+	NGTThrowException("GraphIndex::linearSearch: Not supported for the index image.");
+      }
       Object *query = Index::allocateObject(searchQuery.getQuery(), searchQuery.getQueryType());
       try {
         NGT::SearchContainer sc(searchQuery, *query);
@@ -632,7 +922,8 @@ namespace NGT {
     virtual void search(NGT::SearchContainer &sc) {
       sc.distanceComputationCount = 0;
       sc.visitCount = 0;
-      ObjectDistances seeds;
+      static thread_local ObjectDistances seeds;
+      seeds.clear();
       search(sc, seeds);
     }
 
@@ -642,7 +933,8 @@ namespace NGT {
         NGT::SearchContainer sc(searchQuery, *query);
 	sc.distanceComputationCount = 0;
 	sc.visitCount = 0;
-	ObjectDistances seeds;
+	static thread_local ObjectDistances seeds;
+	seeds.clear();
 	search(sc, seeds);
       } catch(Exception &err) {
 	deleteObject(query);
@@ -756,6 +1048,26 @@ namespace NGT {
     virtual void createIndex();
     virtual void createIndex(size_t threadNumber);
 
+    // the state of the construction that is saved periodically so that the construction can be resumed.
+    class Checkpoint {
+    public:
+      Checkpoint():id(1), count(0), treeLoaded(false) {}
+      void reset() { id = 1; count = 0; treeLoaded = false; }
+      std::string	path;		// the index that the checkpoints are saved in.
+      ObjectID		id;		// the cursor of the objects to be inserted next.
+      size_t		count;		// the number of the objects inserted so far.
+      bool		treeLoaded;	// the tree already includes all of the objects.
+    };
+
+    virtual void setCheckpointPath(const std::string &database) { checkpoint.path = database; }
+    Checkpoint &getCheckpointState() { return checkpoint; }
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+    void saveCheckpoint(ObjectID id, size_t count, bool treeLoaded);
+    void loadCheckpoint(const std::string &checkpointPath);
+    static std::string getCheckpoint(const std::string &database);
+    static void removeCheckpoint(const std::string &database);
+#endif
+
     void checkGraph()
     {
       GraphRepository &repo = repository;
@@ -1258,7 +1570,20 @@ namespace NGT {
       return valid;
     }
 
-    size_t getObjectRepositorySize() { return objectSpace->getRepository().size(); }
+    size_t getObjectRepositorySize() {
+      if (isImage()) {
+	NGTThrowException("GraphIndex::getObjectRepositorySize: The objects of the index image are not available.");
+      }
+      return objectSpace->getRepository().size();
+    }
+
+    bool isImage() {
+#if defined(NGT_GRAPH_READ_ONLY_GRAPH) && !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+      return image.isOpen();
+#else
+      return false;
+#endif
+    }
 
     size_t getSizeOfElement() { return objectSpace->getSizeOfElement(); }
 
@@ -1370,10 +1695,14 @@ namespace NGT {
     }
 
     Index::Property			property;
+    Checkpoint				checkpoint;
 
     bool readOnly;
 #ifdef NGT_GRAPH_READ_ONLY_GRAPH
     void (*searchUnupdatableGraph)(NGT::NeighborhoodGraph&, NGT::SearchContainer&, NGT::ObjectDistances&);
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+    IndexImage image;
+#endif
 #endif
   };
 
@@ -1540,8 +1869,86 @@ namespace NGT {
 #endif
     }
 
+    // the tree is read before the graph, because the seeds of every search come from the tree.
+    size_t warmUp(size_t threadSize = 0) {
+      size_t pages = 0;
+#ifdef NGT_SHARED_MEMORY_ALLOCATOR
+      pages += DVPTree::internalNodes.getAllocator().prefault(threadSize);
+      pages += DVPTree::leafNodes.getAllocator().prefault(threadSize);
+#endif
+      return pages + GraphIndex::warmUp(threadSize);
+    }
+
+#if defined(NGT_GRAPH_READ_ONLY_GRAPH) && !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+    void writeImage(IndexImage::Writer &writer) {
+      GraphIndex::writeImage(writer);
+      IndexImage::Header &header = writer.getHeader();
+      size_t vectorSize = SearchGraphRepository::getVectorSize(*GraphIndex::objectSpace);
+      header.rootID = DVPTree::getRootNode()->id.get();
+      header.childrenSize = DVPTree::internalChildrenSize;
+      header.internalNodeSize = DVPTree::internalNodes.size();
+      header.leafNodeSize = DVPTree::leafNodes.size();
+
+      std::vector<uint8_t> node(IndexImage::getTreeNodeSize(header.childrenSize));
+      writer.beginSection(IndexImage::SectionTreeNode);
+      for (size_t id = 0; id < DVPTree::internalNodes.size(); id++) {
+	std::fill(node.begin(), node.end(), 0);
+	if (!DVPTree::internalNodes.isEmpty(id)) {
+	  InternalNode &n = *DVPTree::internalNodes[id];
+	  if (n.childrenSize != header.childrenSize) {
+	    NGTThrowException("GraphAndTreeIndex::writeImage: Inconsistent children size.");
+	  }
+	  Node::NodeID *children = reinterpret_cast<Node::NodeID*>(node.data());
+	  Distance *borders = reinterpret_cast<Distance*>(children + header.childrenSize);
+	  for (size_t ci = 0; ci < n.childrenSize; ci++) {
+	    children[ci] = n.getChildren()[ci].get();
+	  }
+	  for (size_t bi = 0; bi < n.childrenSize - 1; bi++) {
+	    borders[bi] = n.getBorders()[bi];
+	  }
+	}
+	writer.write(node.data(), node.size());
+      }
+
+      std::vector<uint8_t> pivot(header.objectByteSize);
+      writer.beginSection(IndexImage::SectionTreePivot);
+      for (size_t id = 0; id < DVPTree::internalNodes.size(); id++) {
+	std::fill(pivot.begin(), pivot.end(), 0);
+	if (!DVPTree::internalNodes.isEmpty(id) && !DVPTree::internalNodes[id]->pivotIsEmpty()) {
+	  memcpy(pivot.data(), DVPTree::internalNodes[id]->getPivot().getPointer(), vectorSize);
+	}
+	writer.write(pivot.data(), pivot.size());
+      }
+
+      writer.beginSection(IndexImage::SectionTreeLeaf);
+      uint64_t offset = 0;
+      writer.write(&offset, sizeof(offset));
+      for (size_t id = 0; id < DVPTree::leafNodes.size(); id++) {
+	if (!DVPTree::leafNodes.isEmpty(id)) {
+	  offset += DVPTree::leafNodes[id]->getObjectSize();
+	}
+	writer.write(&offset, sizeof(offset));
+      }
+      writer.beginSection(IndexImage::SectionTreeObject);
+      for (size_t id = 0; id < DVPTree::leafNodes.size(); id++) {
+	if (!DVPTree::leafNodes.isEmpty(id)) {
+	  writer.write(DVPTree::leafNodes[id]->getObjectIDs(), DVPTree::leafNodes[id]->getObjectSize() * sizeof(ObjectDistance));
+	}
+      }
+      writer.endSection();
+    }
+#endif
+
     void loadIndex(const std::string &ifile, bool readOnly) {
       DVPTree::objectSpace = GraphIndex::objectSpace;
+#if defined(NGT_GRAPH_READ_ONLY_GRAPH) && !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+      if (image.isOpen()) {
+	if (!image.hasTree()) {
+	  NGTThrowException("GraphAndTreeIndex::loadIndex: The image has no tree. " + ifile);
+	}
+	return;
+      }
+#endif
       std::ifstream ist(ifile + "/tre");
       DVPTree::deserialize(ist);
 #ifdef NGT_GRAPH_READ_ONLY_GRAPH
@@ -1692,10 +2099,13 @@ namespace NGT {
 
     void createIndex(size_t threadNumber);
 
+    // without the shared memory, the inserted objects are owned by the index. so they should be allocated
+    // as the persistent objects, whose layout differs from the queries for the scalar quantized objects.
     void createIndex(const std::vector<std::pair<NGT::Object*, size_t> > &objects, std::vector<InsertionResult> &ids,
 		     double range, size_t threadNumber);
 
-    void createTreeIndex();
+    // insert all of the objects into the tree. an empty tree is loaded top down at once.
+    void createTreeIndex(size_t threadSize = 0);
 
     // GraphAndTreeIndex
     void getSeedsFromTree(NGT::SearchContainer &sc, ObjectDistances &seeds) {
@@ -1705,24 +2115,56 @@ namespace NGT {
       tso.size = 1;
       tso.distanceComputationCount = 0;
       tso.visitCount = 0;
-      try {
-	DVPTree::search(tso);
-      } catch (Exception &err) {
-	std::stringstream msg;
-	msg << "GraphAndTreeIndex::getSeeds: Cannot search for tree.:" << err.what();
-	NGTThrowException(msg);
-      }
+#if defined(NGT_GRAPH_READ_ONLY_GRAPH) && !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+      if (image.isOpen()) {
+	try {
+	  tso.nodeID = image.searchLeaf(GraphIndex::objectSpace->getComparator(), sc.object, tso.distanceComputationCount);
+	  image.getObjectIDsFromLeaf(tso.nodeID, seeds);
+	} catch (Exception &err) {
+	  std::stringstream msg;
+	  msg << "GraphAndTreeIndex::getSeeds: Cannot search for the tree in the image.:" << err.what();
+	  NGTThrowException(msg);
+	}
+      } else
+#endif
+      {
+	try {
+	  DVPTree::search(tso);
+	} catch (Exception &err) {
+	  std::stringstream msg;
+	  msg << "GraphAndTreeIndex::getSeeds: Cannot search for tree.:" << err.what();
+	  NGTThrowException(msg);
+	}
 
-      try {
-	DVPTree::getObjectIDsFromLeaf(tso.nodeID, seeds);
-      } catch (Exception &err) {
-	std::stringstream msg;
-	msg << "GraphAndTreeIndex::getSeeds: Cannot get a leaf.:" << err.what();
-	NGTThrowException(msg);
+	try {
+	  DVPTree::getObjectIDsFromLeaf(tso.nodeID, seeds);
+	} catch (Exception &err) {
+	  std::stringstream msg;
+	  msg << "GraphAndTreeIndex::getSeeds: Cannot get a leaf.:" << err.what();
+	  NGTThrowException(msg);
+	}
       }
       sc.distanceComputationCount += tso.distanceComputationCount;
       sc.visitCount += tso.visitCount;
-      if (sc.useAllNodesInLeaf || NeighborhoodGraph::property.seedType == NeighborhoodGraph::SeedTypeAllLeafNodes) {
+      if (sc.useAllNodesInLeaf) {
+	// the tree may be loaded ahead of the graph during the construction.
+	size_t size = 0;
+	for (size_t i = 0; i < seeds.size(); i++) {
+#if defined(NGT_GRAPH_READ_ONLY_GRAPH) && !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+	  if (image.isOpen() ? searchRepository.isEmpty(seeds[i].id) : GraphIndex::repository.isEmpty(seeds[i].id)) {
+	    continue;
+	  }
+#else
+	  if (GraphIndex::repository.isEmpty(seeds[i].id)) {
+	    continue;
+	  }
+#endif
+	  seeds[size++] = seeds[i];
+	}
+	seeds.resize(size);
+	return;
+      }
+      if (NeighborhoodGraph::property.seedType == NeighborhoodGraph::SeedTypeAllLeafNodes) {
 	return;
       }
       // if seedSize is zero, the result size of the query is used as seedSize.
@@ -1747,7 +2189,8 @@ namespace NGT {
     void search(NGT::SearchContainer &sc) {
       sc.distanceComputationCount = 0;
       sc.visitCount = 0;
-      ObjectDistances	seeds;
+      static thread_local ObjectDistances seeds;
+      seeds.clear();
       getSeedsFromTree(sc, seeds);
       GraphIndex::search(sc, seeds);
     }
@@ -1758,7 +2201,8 @@ namespace NGT {
         NGT::SearchContainer sc(searchQuery, *query);
         sc.distanceComputationCount = 0;
         sc.visitCount = 0;
-        ObjectDistances	seeds;
+	static thread_local ObjectDistances seeds;
+	seeds.clear();
 	getSeedsFromTree(sc, seeds);
 	GraphIndex::search(sc, seeds);
       } catch(Exception &err) {
@@ -1792,7 +2236,11 @@ namespace NGT {
     }
     void load(const std::string &file) {
       NGT::PropertySet prop;
-      prop.load(file + "/prf");
+      if (IndexImage::isImage(file)) {
+	IndexImage::loadProperty(file, prop);
+      } else {
+	prop.load(file + "/prf");
+      }
       Index::Property::importProperty(prop);
       NeighborhoodGraph::Property::importProperty(prop);
     }
@@ -1810,6 +2258,9 @@ namespace NGT {
 template<typename T>
 size_t NGT::Index::append(std::vector<T> &object) 
 {
+  if (isImage()) {
+    NGTThrowException("NGT::Index::append: The index image cannot be updated.");
+  }
   if (getObjectSpace().getRepository().size() == 0) {
     getObjectSpace().getRepository().initialize();
   }
@@ -1817,18 +2268,23 @@ size_t NGT::Index::append(std::vector<T> &object)
   auto *o = getObjectSpace().getRepository().allocateNormalizedPersistentObject(object);
   getObjectSpace().getRepository().push_back(dynamic_cast<PersistentObject*>(o));
   size_t oid = getObjectSpace().getRepository().size() - 1;
+  updateOriginalID(oid);
   return oid;
 }
 
 template<typename T>
 size_t NGT::Index::insert(std::vector<T> &object) 
 {
+  if (isImage()) {
+    NGTThrowException("NGT::Index::insert: The index image cannot be updated.");
+  }
   if (getObjectSpace().getRepository().size() == 0) {
     getObjectSpace().getRepository().initialize();
   }
 
   auto *o = getObjectSpace().getRepository().allocateNormalizedPersistentObject(object);
   size_t oid = getObjectSpace().getRepository().insert(dynamic_cast<PersistentObject*>(o));
+  updateOriginalID(oid);
   return oid;
 }
 
@@ -0,0 +1,367 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include	<string>
+#include	<vector>
+#include	<fstream>
+#include	<sstream>
+#include	<cstring>
+#include	<stdint.h>
+#include	<fcntl.h>
+#include	<unistd.h>
+#include	<sys/mman.h>
+#include	<sys/stat.h>
+
+#include	"NGT/Common.h"
+#include	"NGT/Node.h"
+
+namespace NGT {
+
+  // IndexImage is a single file of a whole index that is opened with one mmap and searched in place
+  // without any deserialization. The file consists of the header and the sections below, each of
+  // which is aligned to the page size.
+  //   property  : the text of the property file.
+  //   object    : the padded vectors of the objects in the order of the IDs. (objectByteSize each)
+  //   graph     : the read-only graph in the same layout as sgr.
+  //   treeNode  : the children and the borders of each internal node of the tree.
+  //   treePivot : the pivot of each internal node. (objectByteSize each)
+  //   treeLeaf  : the offsets of the objects of each leaf node.
+  //   treeObject: the IDs and the distances of the objects of the leaf nodes.
+  // The tree sections are empty for the graph index.
+  class IndexImage {
+  public:
+    enum Section {
+      SectionProperty	= 0,
+      SectionObject	= 1,
+      SectionGraph	= 2,
+      SectionTreeNode	= 3,
+      SectionTreePivot	= 4,
+      SectionTreeLeaf	= 5,
+      SectionTreeObject	= 6,
+      SectionSize	= 7
+    };
+
+    class Header {
+    public:
+      char	magic[8];
+      uint64_t	version;
+      uint64_t	fileSize;
+      uint64_t	objectSize;		// the number of the objects including the dummy head.
+      uint64_t	objectByteSize;
+      uint64_t	rootID;			// the raw ID of the root node of the tree.
+      uint64_t	childrenSize;		// the number of the children of each internal node.
+      uint64_t	internalNodeSize;
+      uint64_t	leafNodeSize;
+      uint64_t	offset[SectionSize];
+      uint64_t	size[SectionSize];
+    };
+
+    static const uint64_t	version = 1;
+    static const size_t		alignment = 4096;
+
+    // Writer writes the sections in order, and the header is written at last.
+    class Writer {
+    public:
+      Writer(const std::string &f):file(f), stream(f, std::ios::binary | std::ios::trunc), section(-1) {
+	if (!stream.is_open()) {
+	  NGTThrowException("IndexImage: Cannot open the specified file. " + file);
+	}
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, getMagic(), sizeof(header.magic));
+	header.version = version;
+	pad();
+      }
+      void beginSection(Section s) {
+	if (section >= 0) {
+	  endSection();
+	}
+	pad();
+	section = s;
+	header.offset[section] = stream.tellp();
+      }
+      void endSection() {
+	if (section < 0) {
+	  return;
+	}
+	header.size[section] = static_cast<uint64_t>(stream.tellp()) - header.offset[section];
+	section = -1;
+      }
+      void write(const void *data, size_t size) { stream.write(static_cast<const char*>(data), size); }
+      void close() {
+	endSection();
+	pad();
+	header.fileSize = stream.tellp();
+	stream.seekp(0);
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	stream.close();
+	if (stream.fail()) {
+	  NGTThrowException("IndexImage: Cannot write the specified file. " + file);
+	}
+      }
+      std::ofstream &getStream() { return stream; }
+      Header &getHeader() { return header; }
+    protected:
+      void pad() {
+	size_t pos = stream.tellp();
+	size_t npos = (pos + alignment - 1) / alignment * alignment;
+	if (npos == 0) {
+	  npos = alignment;
+	}
+	std::vector<char> zero(npos - pos, 0);
+	stream.write(zero.data(), zero.size());
+      }
+      std::string	file;
+      std::ofstream	stream;
+      Header		header;
+      int		section;
+    };
+
+    IndexImage():address(0), mappedSize(0), header(0) {}
+    ~IndexImage() { close(); }
+
+    static const char *getMagic() { return "NGTIMAGE"; }
+
+    // the image is a regular file while the ordinary index is a directory.
+    static bool isImage(const std::string &file) {
+      struct stat st;
+      if (stat(file.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+	return false;
+      }
+      std::ifstream is(file, std::ios::binary);
+      char magic[8];
+      if (!is.read(magic, sizeof(magic))) {
+	return false;
+      }
+      return memcmp(magic, getMagic(), sizeof(magic)) == 0;
+    }
+
+    // only the header and the property section are read.
+    static void loadProperty(const std::string &file, PropertySet &prop) {
+      std::ifstream is(file, std::ios::binary);
+      Header h;
+      if (!is.read(reinterpret_cast<char*>(&h), sizeof(h)) || memcmp(h.magic, getMagic(), sizeof(h.magic)) != 0) {
+	NGTThrowException("IndexImage: Not an index image. " + file);
+      }
+      std::string text(h.size[SectionProperty], 0);
+      is.seekg(h.offset[SectionProperty]);
+      if (!is.read(&text[0], text.size())) {
+	NGTThrowException("IndexImage: The property section is broken. " + file);
+      }
+      std::istringstream iss(text);
+      prop.load(iss);
+    }
+
+    // when the huge pages are enabled, the image is read into them and is not shared among the processes.
+    void open(const std::string &file, HugePage::Mode hugePage = HugePage::ModeDisabled) {
+      close();
+      int fd = ::open(file.c_str(), O_RDONLY);
+      if (fd < 0) {
+	NGTThrowException("IndexImage: Cannot open the specified file. " + file);
+      }
+      struct stat st;
+      if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+	::close(fd);
+	NGTThrowException("IndexImage: The specified file is too short. " + file);
+      }
+      size_t size = st.st_size;
+      void *addr = HugePage::isEnabled(hugePage) ? HugePage::read(fd, size, hugePage) :
+	mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (addr == MAP_FAILED) {
+	NGTThrowException("IndexImage: Cannot map the specified file. " + file);
+      }
+      address = static_cast<uint8_t*>(addr);
+      mappedSize = size;
+      header = reinterpret_cast<Header*>(address);
+      try {
+	checkHeader(st.st_size);
+      } catch (Exception &err) {
+	close();
+	std::stringstream msg;
+	msg << err.what() << " " << file;
+	NGTThrowException(msg);
+      }
+      // the objects are accessed at random, while the graph and the tree are read ahead as a whole.
+      MemoryCache::advise(getSection(SectionObject), getSectionSize(SectionObject), MADV_RANDOM);
+      MemoryCache::advise(getSection(SectionTreePivot), getSectionSize(SectionTreePivot), MADV_RANDOM);
+      MemoryCache::advise(getSection(SectionGraph), getSectionSize(SectionGraph), MADV_WILLNEED);
+      MemoryCache::advise(getSection(SectionTreeNode), getSectionSize(SectionTreeNode), MADV_WILLNEED);
+      MemoryCache::advise(getSection(SectionTreeLeaf), getSectionSize(SectionTreeLeaf), MADV_WILLNEED);
+      MemoryCache::advise(getSection(SectionTreeObject), getSectionSize(SectionTreeObject), MADV_WILLNEED);
+    }
+
+    // pre-fault the graph and the tree first, and then the objects.
+    size_t prefault(size_t threadSize = 0) {
+      static const Section order[] = {SectionTreeNode, SectionTreePivot, SectionTreeLeaf, SectionTreeObject,
+				      SectionGraph, SectionObject};
+      size_t pages = 0;
+      for (auto s : order) {
+	pages += MemoryCache::prefault(getSection(s), getSectionSize(s), threadSize);
+      }
+      return pages;
+    }
+
+    void close() {
+      if (address != 0) {
+	munmap(address, mappedSize);
+      }
+      address = 0;
+      mappedSize = 0;
+      header = 0;
+    }
+
+    bool isOpen() { return address != 0; }
+    bool hasTree() { return header->internalNodeSize + header->leafNodeSize != 0; }
+    size_t getObjectSize() { return header->objectSize; }
+    size_t getObjectByteSize() { return header->objectByteSize; }
+    uint8_t *getSection(Section s) { return address + header->offset[s]; }
+    size_t getSectionSize(Section s) { return header->size[s]; }
+
+    // descend the tree to the leaf which includes the query, as the search of the tree in the leaf mode.
+    Node::ID searchLeaf(ObjectSpace::Comparator &comparator, Object &query, size_t &distanceComputationCount) {
+      Node::ID id;
+      id.setRaw(header->rootID);
+      size_t bsize = header->childrenSize - 1;
+      // the children are checked at the open, but a cycle of the internal nodes is only detected here.
+      size_t depth = 0;
+      while (id.getType() == Node::ID::Internal) {
+	if (depth++ > header->internalNodeSize) {
+	  NGTThrowException("IndexImage: The tree is broken.");
+	}
+	const uint8_t *node = getSection(SectionTreeNode) + id.getID() * getTreeNodeSize();
+	const Node::NodeID *children = reinterpret_cast<const Node::NodeID*>(node);
+	const Distance *borders = reinterpret_cast<const Distance*>(children + header->childrenSize);
+	Distance d = comparator(query, getSection(SectionTreePivot) + id.getID() * header->objectByteSize);
+	distanceComputationCount++;
+	size_t mid;
+	for (mid = 0; mid < bsize; mid++) {
+	  if (d < borders[mid]) {
+	    break;
+	  }
+	}
+	id.setRaw(children[mid]);
+	if (id.get() == 0) {
+	  NGTThrowException("IndexImage: The tree is broken.");
+	}
+      }
+      return id;
+    }
+
+    void getObjectIDsFromLeaf(Node::ID id, ObjectDistances &objects) {
+      const uint64_t *offsets = reinterpret_cast<const uint64_t*>(getSection(SectionTreeLeaf));
+      const ObjectDistance *leafObjects = reinterpret_cast<const ObjectDistance*>(getSection(SectionTreeObject));
+      objects.clear();
+      objects.insert(objects.end(), leafObjects + offsets[id.getID()], leafObjects + offsets[id.getID() + 1]);
+    }
+
+    size_t getTreeNodeSize() { return getTreeNodeSize(header->childrenSize); }
+    static size_t getTreeNodeSize(size_t childrenSize) {
+      return childrenSize * sizeof(Node::NodeID) + (childrenSize - 1) * sizeof(Distance);
+    }
+    static size_t getObjectByteSize(size_t byteSize) {
+      return (byteSize + 63) / 64 * 64;
+    }
+
+  protected:
+    void checkHeader(size_t fileSize) {
+      if (memcmp(header->magic, getMagic(), sizeof(header->magic)) != 0) {
+	NGTThrowException("IndexImage: Not an index image.");
+      }
+      if (header->version != version) {
+	std::stringstream msg;
+	msg << "IndexImage: Unsupported version. " << header->version;
+	NGTThrowException(msg);
+      }
+      if (header->fileSize != fileSize) {
+	NGTThrowException("IndexImage: The file size is inconsistent with the header.");
+      }
+      for (size_t s = 0; s < SectionSize; s++) {
+	if (header->offset[s] % alignment != 0 || header->size[s] > fileSize || header->offset[s] > fileSize - header->size[s]) {
+	  std::stringstream msg;
+	  msg << "IndexImage: The section is out of the file. " << s;
+	  NGTThrowException(msg);
+	}
+      }
+      if (header->objectSize * header->objectByteSize != header->size[SectionObject]) {
+	NGTThrowException("IndexImage: The object section is inconsistent with the header.");
+      }
+      if (!hasTree()) {
+	return;
+      }
+      if (header->childrenSize < 2 ||
+	  header->internalNodeSize * getTreeNodeSize() != header->size[SectionTreeNode] ||
+	  header->internalNodeSize * header->objectByteSize != header->size[SectionTreePivot] ||
+	  (header->leafNodeSize + 1) * sizeof(uint64_t) != header->size[SectionTreeLeaf]) {
+	NGTThrowException("IndexImage: The tree sections are inconsistent with the header.");
+      }
+      const uint64_t *offsets = reinterpret_cast<const uint64_t*>(getSection(SectionTreeLeaf));
+      if (offsets[header->leafNodeSize] * sizeof(ObjectDistance) != header->size[SectionTreeObject]) {
+	NGTThrowException("IndexImage: The leaf objects are inconsistent with the header.");
+      }
+      checkTree();
+    }
+
+    // the IDs and the offsets which are read from the image are used as the indexes of the sections without
+    // any check during the search, so that those of the tree are checked here. those of the graph section are
+    // checked by SearchGraphRepository::attach when the graph is attached.
+    void checkTree() {
+      Node::ID root;
+      root.setRaw(header->rootID);
+      if (!isValidNode(root)) {
+	NGTThrowException("IndexImage: The root of the tree is out of the range.");
+      }
+      for (size_t i = 0; i < header->internalNodeSize; i++) {
+	const Node::NodeID *children = reinterpret_cast<const Node::NodeID*>(getSection(SectionTreeNode) + i * getTreeNodeSize());
+	for (size_t c = 0; c < header->childrenSize; c++) {
+	  Node::ID child;
+	  child.setRaw(children[c]);
+	  if (child.get() != 0 && !isValidNode(child)) {
+	    std::stringstream msg;
+	    msg << "IndexImage: The child of the internal node is out of the range. " << i << ":" << c;
+	    NGTThrowException(msg);
+	  }
+	}
+      }
+      const uint64_t *offsets = reinterpret_cast<const uint64_t*>(getSection(SectionTreeLeaf));
+      for (size_t i = 0; i < header->leafNodeSize; i++) {
+	if (offsets[i] > offsets[i + 1]) {
+	  std::stringstream msg;
+	  msg << "IndexImage: The offsets of the leaf node are inconsistent. " << i;
+	  NGTThrowException(msg);
+	}
+      }
+      const ObjectDistance *leafObjects = reinterpret_cast<const ObjectDistance*>(getSection(SectionTreeObject));
+      for (size_t i = 0; i < offsets[header->leafNodeSize]; i++) {
+	if (leafObjects[i].id >= header->objectSize) {
+	  std::stringstream msg;
+	  msg << "IndexImage: The object of the leaf node is out of the range. " << leafObjects[i].id;
+	  NGTThrowException(msg);
+	}
+      }
+    }
+
+    bool isValidNode(Node::ID id) {
+      return id.getID() < (id.getType() == Node::ID::Internal ? header->internalNodeSize : header->leafNodeSize);
+    }
+
+    uint8_t	*address;
+    size_t	mappedSize;
+    Header	*header;
+  };
+
+} // namespace NGT
@@ -60,6 +60,51 @@ namespace MemoryManager{
   void MmapManager::setEntryHook(const void *entry_p){
     _impl->mmapCntlHead->entry_p = getRelAddr(entry_p);
   }
+
+  void MmapManager::advise(const int advice)
+  {
+    _impl->advices.push_back(advice);
+    if(_impl->isOpen == false){
+      return;
+    }
+    for(uint16_t i = 0; i < _impl->mmapCntlHead->unit_num; i++){
+      errno = 0;
+      if(madvise(_impl->mmapDataAddr[i], _impl->mmapCntlHead->base_size, advice) == -1){
+        std::cerr << _impl->filePath << "[WARN] : madvise error " << getErrorStr(errno) << std::endl;
+      }
+    }
+  }
+
+  size_t MmapManager::prefault(size_t threadSize) const
+  {
+    if(_impl->isOpen == false){
+      return 0;
+    }
+#ifdef _OPENMP
+    if(threadSize == 0){
+      threadSize = omp_get_max_threads();
+    }
+#endif
+    threadSize = threadSize == 0 ? 1 : threadSize;
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t page_num = 0;
+    for(uint16_t i = 0; i < _impl->mmapCntlHead->unit_num; i++){
+      const size_t size = (i == _impl->mmapCntlHead->active_unit) ?
+        _impl->mmapCntlHead->data_headers[i].break_p : _impl->mmapCntlHead->base_size;
+      const volatile char *data = (const volatile char *)_impl->mmapDataAddr[i];
+      const int64_t num = (size + page_size - 1) / page_size;
+      char sum = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:sum) num_threads(threadSize)
+#endif
+      for(int64_t p = 0; p < num; p++){
+        sum += data[p * page_size];
+      }
+      (void)sum;
+      page_num += num;
+    }
+    return page_num;
+  }
   
   
   bool MmapManager::init(const std::string &filePath, size_t size, const init_option_st *optionst) const
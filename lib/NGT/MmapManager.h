@@ -82,6 +82,9 @@ namespace MemoryManager{
     void *getEntryHook() const;
     void setEntryHook(const void *entry_p);
 
+    void advise(const int advice);   // madvise for the mapped units including the ones expanded later. the advices are accumulated.
+    size_t prefault(size_t threadSize = 0) const; // read each used page of the units. returns the number of the pages.
+
     // static method --- 
     static void setDefaultOptionValue(init_option_st &optionst);
     static size_t getAlignSize(size_t size);
@@ -23,9 +23,14 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 #include <iostream>
 #include <sstream>
 #include <cstring>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include <cassert>
 
 namespace MemoryManager{
@@ -42,6 +47,7 @@ namespace MemoryManager{
     control_st *mmapCntlHead;
     std::string filePath;         
     void *mmapDataAddr[MMAP_MAX_UNIT_NUM];
+    std::vector<int> advices;
 
     void initBootStruct(boot_st &bst, size_t size) const;
     void initFreeStruct(free_st &fst) const;
@@ -155,6 +161,11 @@ namespace MemoryManager{
       throw MmapManagerException("mmap error" + err_str);
     }
     if(close(fd) == -1) std::cerr << filePath << "[WARN] : filedescript cannot close" << std::endl;
+    for(auto advice : advices){
+      if(madvise(new_area, mmapCntlHead->base_size, advice) == -1){
+        std::cerr << filePath << "[WARN] : madvise error " << getErrorStr(errno) << std::endl;
+      }
+    }
     
     mmapDataAddr[mmapCntlHead->unit_num] = new_area;
     
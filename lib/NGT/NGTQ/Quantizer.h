@@ -477,6 +477,11 @@ public:
 #if defined(NGT_AVX_DISABLED) || !defined(__AVX__)
   template <typename T>
   inline double getL2DistanceUint8(NGT::Object &object, size_t objectID, T localID[]) {
+#if !defined(NGT_AVX_DISABLED) && defined(NGT_RUNTIME_DISPATCH)
+    if (NGT::CpuInfo::getSimdLevel() != NGT::CpuInfo::SimdLevelNone) {
+      return getL2DistanceUint8AVX(object, objectID, localID);
+    }
+#endif
     assert(globalCodebook != 0);
     NGT::PersistentObject &gcentroid = *globalCodebook->getObjectSpace().getRepository().get(objectID);
     size_t sizeOfObject = globalCodebook->getObjectSpace().getByteSizeOfObject();
@@ -506,10 +511,16 @@ public:
     }
     return sqrt(distance);
   }
-#else 
+#endif
+#if !defined(NGT_AVX_DISABLED) && (defined(__AVX__) || defined(NGT_RUNTIME_DISPATCH))
   // AVX
   template <typename T>
+#if defined(__AVX__)
   inline double getL2DistanceUint8(NGT::Object &object, size_t objectID, T localID[]) {
+#else
+  __attribute__((target("avx")))
+  double getL2DistanceUint8AVX(NGT::Object &object, size_t objectID, T localID[]) {
+#endif
     assert(globalCodebook != 0);
     NGT::PersistentObject &gcentroid = *globalCodebook->getObjectSpace().getRepository().get(objectID);
     size_t sizeOfObject = globalCodebook->getObjectSpace().getByteSizeOfObject();
@@ -0,0 +1,375 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include	"NGT/Index.h"
+#include	"NGT/GraphReconstructor.h"
+
+#include	<mutex>
+#include	<random>
+
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+
+namespace NGT {
+
+// NNDescent builds the k nearest neighbor graph of all of the objects in an index at once by the local
+// joins of NN-Descent instead of inserting the objects one by one with graph searches. Each iteration
+// samples the new and old neighbors of every node with their reverse neighbors, and compares the
+// sampled neighbors with each other in parallel over the nodes. The resultant KNNG is stored as is,
+// or converted into an ANNG by adding the reverse edges, or into an ONNG by GraphReconstructor.
+class NNDescent {
+ public:
+  class Parameters {
+  public:
+    Parameters():edgeSize(0), poolSize(0), iteration(10), sampleRate(1.0), terminationRate(0.001), threadSize(0), seed(0) {}
+    size_t	edgeSize;		// k of the KNNG. 0 means edgeSizeForCreation of the index.
+    size_t	poolSize;		// the number of the neighbors kept during the iterations. 0 means twice the edge size.
+    size_t	iteration;		// the maximum number of the iterations.
+    float	sampleRate;		// the rate of the sampled neighbors of each node per iteration.
+    float	terminationRate;	// the iterations stop when the rate of the updated edges is less than this.
+    size_t	threadSize;		// 0 means threadPoolSize of the index.
+    size_t	seed;
+  };
+
+  class Neighbor {
+  public:
+    Neighbor() {}
+    Neighbor(uint32_t i, Distance d, bool n):id(i), distance(d), isNew(n) {}
+    bool operator<(const Neighbor &n) const { return distance < n.distance || (distance == n.distance && id < n.id); }
+    uint32_t	id;
+    Distance	distance;
+    bool	isNew;
+  };
+  typedef std::vector<Neighbor>	Neighbors;
+
+  // builds the KNNG of the objects in the repository. graph[id - 1] is the neighbors of the object id
+  // sorted by the distance, as GraphReconstructor::extractGraph does.
+  static void
+    construct(ObjectSpace &objectSpace, Parameters &parameters, std::vector<ObjectDistances> &graph)
+  {
+    ObjectRepository &repository = objectSpace.getRepository();
+    std::vector<ObjectID> ids;
+    for (size_t id = 1; id < repository.size(); id++) {
+      if (!repository.isEmpty(id)) {
+	ids.push_back(id);
+      }
+    }
+    graph.clear();
+    graph.resize(repository.size() == 0 ? 0 : repository.size() - 1);
+    if (ids.size() < 2) {
+      return;
+    }
+    std::vector<Object*> objects(ids.size());
+    for (size_t idx = 0; idx < ids.size(); idx++) {
+      objects[idx] = repository[ids[idx]];
+    }
+    // a small k converges to a poor graph. the neighbors are searched in a larger pool and cut at the end.
+    size_t poolSize = parameters.poolSize == 0 ? parameters.edgeSize * 2 : std::max(parameters.poolSize, parameters.edgeSize);
+    size_t k = std::min(poolSize, ids.size() - 1);
+    size_t threadSize = parameters.threadSize == 0 ? 1 : parameters.threadSize;
+    std::vector<Neighbors> knng(ids.size());
+
+    NGT::Timer timer;
+    timer.start();
+    initialize(objectSpace.getComparator(), objects, k, parameters.seed, threadSize, knng);
+    for (size_t iteration = 0; iteration < parameters.iteration; iteration++) {
+      size_t updates = join(objectSpace.getComparator(), objects, k, parameters, iteration, threadSize, knng);
+      timer.stop();
+      std::cerr << "NNDescent: iteration=" << iteration << " updates=" << updates << " time=" << timer << std::endl;
+      timer.start();
+      if (updates <= parameters.terminationRate * knng.size() * k) {
+	break;
+      }
+    }
+
+    for (size_t idx = 0; idx < knng.size(); idx++) {
+      ObjectDistances &node = graph[ids[idx] - 1];
+      size_t size = std::min(knng[idx].size(), parameters.edgeSize);
+      node.reserve(size);
+      for (size_t i = 0; i < size; i++) {
+	node.push_back(ObjectDistance(ids[knng[idx][i].id], knng[idx][i].distance));
+      }
+    }
+  }
+
+  // builds the graph of an index the objects of which are already loaded. The graph type of the index
+  // decides the resultant graph. The objects are also inserted into the tree if the index has a tree.
+  static void
+    construct(Index &index, Parameters parameters)
+  {
+    GraphIndex &graphIndex = static_cast<GraphIndex&>(index.getIndex());
+    NeighborhoodGraph::Property &property = graphIndex.getGraphProperty();
+    if (graphIndex.repository.size() > 1) {
+      NGTThrowException("NNDescent::construct: The graph is not empty.");
+    }
+    if (parameters.edgeSize == 0) {
+      parameters.edgeSize = property.edgeSizeForCreation;
+    }
+    if (parameters.threadSize == 0) {
+      NGT::Property prop;
+      index.getProperty(prop);
+      parameters.threadSize = prop.threadPoolSize;
+    }
+
+    std::vector<ObjectDistances> graph;
+    construct(graphIndex.getObjectSpace(), parameters, graph);
+
+    switch (property.graphType) {
+    case NeighborhoodGraph::GraphTypeKNNG:
+      insertNodes(graphIndex, graph);
+      break;
+    case NeighborhoodGraph::GraphTypeANNG:
+      {
+	std::vector<ObjectDistances> anng;
+	addReverseEdges(graph, parameters.threadSize, anng);
+	insertNodes(graphIndex, anng);
+      }
+      break;
+    case NeighborhoodGraph::GraphTypeONNG:
+      insertNodes(graphIndex, graph);
+      GraphReconstructor::reconstructGraph(graph, index, std::min(static_cast<size_t>(property.outgoingEdge), parameters.edgeSize),
+					   property.incomingEdge);
+      break;
+    default:
+      NGTThrowException("NNDescent::construct: The graph type is not supported. Specify KNNG, ANNG or ONNG.");
+    }
+
+    GraphAndTreeIndex *tree = dynamic_cast<GraphAndTreeIndex*>(&graphIndex);
+    if (tree != 0) {
+      tree->createTreeIndex(parameters.threadSize);
+    }
+  }
+
+  // loads the objects into an empty index and builds the graph.
+  static void
+    construct(const std::string &database, const std::string &dataFile, size_t dataSize, Parameters &parameters)
+  {
+    NGT::Index	index(database);
+    NGT::Timer	timer;
+    timer.start();
+    index.load(dataFile, dataSize);
+    timer.stop();
+    std::cerr << "Data loading time=" << timer.time << " (sec) " << timer.time * 1000.0 << " (msec)" << std::endl;
+    if (index.getObjectRepositorySize() == 0) {
+      NGTThrowException("NNDescent::construct: Data file is empty.");
+    }
+    std::cerr << "# of objects=" << index.getObjectRepositorySize() - 1 << std::endl;
+    timer.reset();
+    timer.start();
+    construct(index, parameters);
+    timer.stop();
+    index.saveIndex(database);
+    std::cerr << "Index creation time=" << timer.time << " (sec) " << timer.time * 1000.0 << " (msec)" << std::endl;
+  }
+
+ protected:
+  static bool
+    update(Neighbors &neighbors, size_t k, const Neighbor &neighbor)
+  {
+    if (neighbors.size() >= k && !(neighbor < neighbors.back())) {
+      return false;
+    }
+    for (auto &n : neighbors) {
+      if (n.id == neighbor.id) {
+	return false;
+      }
+    }
+    neighbors.insert(std::upper_bound(neighbors.begin(), neighbors.end(), neighbor), neighbor);
+    if (neighbors.size() > k) {
+      neighbors.pop_back();
+    }
+    return true;
+  }
+
+  static void
+    initialize(ObjectSpace::Comparator &comparator, std::vector<Object*> &objects, size_t k, size_t seed, size_t threadSize,
+	       std::vector<Neighbors> &knng)
+  {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(threadSize)
+#endif
+    for (size_t idx = 0; idx < knng.size(); idx++) {
+      std::mt19937 mt(seed + idx);
+      std::uniform_int_distribution<size_t> dist(0, knng.size() - 1);
+      Neighbors &neighbors = knng[idx];
+      neighbors.reserve(k + 1);
+      while (neighbors.size() < k) {
+	size_t n = dist(mt);
+	if (n == idx) {
+	  continue;
+	}
+	update(neighbors, k, Neighbor(n, comparator(*objects[idx], *objects[n]), true));
+      }
+    }
+  }
+
+  // adds an element to a sample of a limited size so that each element is kept with the same probability.
+  static void
+    sample(std::vector<uint32_t> &samples, size_t &count, size_t size, uint32_t id, std::mt19937 &mt)
+  {
+    count++;
+    if (samples.size() < size) {
+      samples.push_back(id);
+    } else {
+      size_t r = mt() % count;
+      if (r < size) {
+	samples[r] = id;
+      }
+    }
+  }
+
+  static size_t
+    join(ObjectSpace::Comparator &comparator, std::vector<Object*> &objects, size_t k, Parameters &parameters,
+	 size_t iteration, size_t threadSize, std::vector<Neighbors> &knng)
+  {
+    size_t sampleSize = std::max(static_cast<size_t>(1), static_cast<size_t>(parameters.sampleRate * k));
+    std::vector<std::vector<uint32_t>> newNeighbors(knng.size());
+    std::vector<std::vector<uint32_t>> oldNeighbors(knng.size());
+    std::vector<std::vector<uint32_t>> reverseNewNeighbors(knng.size());
+    std::vector<std::vector<uint32_t>> reverseOldNeighbors(knng.size());
+    std::vector<size_t> reverseNewCounts(knng.size(), 0);
+    std::vector<size_t> reverseOldCounts(knng.size(), 0);
+    std::vector<std::mutex> locks(NGT_GRAPH_INSERTION_LOCK_SIZE);
+    size_t seed = parameters.seed + (iteration + 1) * knng.size();
+
+    // sample the neighbors, and collect the reverse neighbors.
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(threadSize)
+#endif
+    for (size_t idx = 0; idx < knng.size(); idx++) {
+      std::mt19937 mt(seed + idx);
+      size_t newCount = 0;
+      size_t oldCount = 0;
+      std::vector<uint32_t> &news = newNeighbors[idx];
+      std::vector<uint32_t> &olds = oldNeighbors[idx];
+      std::vector<size_t> sampled;
+      for (size_t i = 0; i < knng[idx].size(); i++) {
+	Neighbor &n = knng[idx][i];
+	if (n.isNew) {
+	  newCount++;
+	  if (sampled.size() < sampleSize) {
+	    sampled.push_back(i);
+	  } else {
+	    size_t r = mt() % newCount;
+	    if (r < sampleSize) {
+	      sampled[r] = i;
+	    }
+	  }
+	} else {
+	  sample(olds, oldCount, sampleSize, n.id, mt);
+	}
+      }
+      for (auto i : sampled) {
+	knng[idx][i].isNew = false;
+	news.push_back(knng[idx][i].id);
+      }
+      for (auto n : news) {
+	std::lock_guard<std::mutex> lock(locks[n % locks.size()]);
+	sample(reverseNewNeighbors[n], reverseNewCounts[n], sampleSize, idx, mt);
+      }
+      for (auto n : olds) {
+	std::lock_guard<std::mutex> lock(locks[n % locks.size()]);
+	sample(reverseOldNeighbors[n], reverseOldCounts[n], sampleSize, idx, mt);
+      }
+    }
+
+    // compare the sampled neighbors with each other.
+    size_t updates = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 256) num_threads(threadSize) reduction(+:updates)
+#endif
+    for (size_t idx = 0; idx < knng.size(); idx++) {
+      std::vector<uint32_t> &news = newNeighbors[idx];
+      std::vector<uint32_t> &olds = oldNeighbors[idx];
+      news.insert(news.end(), reverseNewNeighbors[idx].begin(), reverseNewNeighbors[idx].end());
+      olds.insert(olds.end(), reverseOldNeighbors[idx].begin(), reverseOldNeighbors[idx].end());
+      std::sort(news.begin(), news.end());
+      news.erase(std::unique(news.begin(), news.end()), news.end());
+      std::sort(olds.begin(), olds.end());
+      olds.erase(std::unique(olds.begin(), olds.end()), olds.end());
+      for (size_t i = 0; i < news.size(); i++) {
+	uint32_t a = news[i];
+	for (size_t j = i + 1; j < news.size(); j++) {
+	  updates += join(comparator, objects, k, a, news[j], locks, knng);
+	}
+	for (auto b : olds) {
+	  if (a != b) {
+	    updates += join(comparator, objects, k, a, b, locks, knng);
+	  }
+	}
+      }
+    }
+    return updates;
+  }
+
+  static size_t
+    join(ObjectSpace::Comparator &comparator, std::vector<Object*> &objects, size_t k, uint32_t a, uint32_t b,
+	 std::vector<std::mutex> &locks, std::vector<Neighbors> &knng)
+  {
+    Distance d = comparator(*objects[a], *objects[b]);
+    size_t updates = 0;
+    {
+      std::lock_guard<std::mutex> lock(locks[a % locks.size()]);
+      updates += update(knng[a], k, Neighbor(b, d, true)) ? 1 : 0;
+    }
+    {
+      std::lock_guard<std::mutex> lock(locks[b % locks.size()]);
+      updates += update(knng[b], k, Neighbor(a, d, true)) ? 1 : 0;
+    }
+    return updates;
+  }
+
+  // merges the reverse edges into the KNNG to make an ANNG.
+  static void
+    addReverseEdges(std::vector<ObjectDistances> &knng, size_t threadSize, std::vector<ObjectDistances> &anng)
+  {
+    std::vector<ObjectDistances> reverse(knng.size());
+    for (size_t idx = 0; idx < knng.size(); idx++) {
+      for (auto &n : knng[idx]) {
+	reverse[n.id - 1].push_back(ObjectDistance(idx + 1, n.distance));
+      }
+    }
+    anng.resize(knng.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(threadSize)
+#endif
+    for (size_t idx = 0; idx < knng.size(); idx++) {
+      ObjectDistances &node = anng[idx];
+      node = knng[idx];
+      node.insert(node.end(), reverse[idx].begin(), reverse[idx].end());
+      std::sort(node.begin(), node.end());
+      node.erase(std::unique(node.begin(), node.end(),
+			     [](const ObjectDistance &a, const ObjectDistance &b) { return a.id == b.id; }), node.end());
+    }
+  }
+
+  static void
+    insertNodes(GraphIndex &graphIndex, std::vector<ObjectDistances> &graph)
+  {
+    ObjectRepository &objects = graphIndex.getObjectSpace().getRepository();
+    for (size_t id = 1; id <= graph.size(); id++) {
+      if (objects.isEmpty(id)) {
+	continue;
+      }
+      graphIndex.repository.insert(id, graph[id - 1]);
+    }
+  }
+};
+
+} // namespace NGT
+
+#endif
@@ -16,6 +16,11 @@
 
 #pragma once
 
+// the size of the text that is read at once and parsed in parallel.
+#ifndef NGT_TEXT_CHUNK_SIZE
+#define NGT_TEXT_CHUNK_SIZE	(16 * 1024 * 1024)
+#endif
+
 namespace NGT {
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
   class ObjectRepository : 
@@ -26,13 +31,20 @@ namespace NGT {
       std::string file = smfile;
       file.append("po");
       Parent::open(file, sharedMemorySize);
+      if (quantizer != 0) {
+	quantizerFile = smfile + "sq";
+	quantizer->deserialize(quantizerFile);
+	if (quantizer->isKeepingOriginals()) {
+	  quantizer->getOriginals().open(smfile + "or", sharedMemorySize);
+	}
+      }
     }
 #else
   class ObjectRepository : public Repository<Object> {
   public:
     typedef Repository<Object>	Parent;
 #endif
-    ObjectRepository(size_t dim, const std::type_info &ot):dimension(dim), type(ot) { }
+    ObjectRepository(size_t dim, const std::type_info &ot):dimension(dim), type(ot), quantizer(0), inImage(false) { }
 
     void initialize() {
       deleteAll();
@@ -47,6 +59,7 @@ namespace NGT {
 	NGTThrowException(msg);
       }
       Parent::serialize(objs, ospace); 
+      serializeQuantizer(ofile);
     }
 
     void deserialize(const std::string &ifile, ObjectSpace *ospace) { 
@@ -58,6 +71,10 @@ namespace NGT {
 	NGTThrowException(msg);
       }
       Parent::deserialize(objs, ospace);
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+      moveToArena();
+#endif
+      deserializeQuantizer(ifile);
     }
 
     void serializeAsText(const std::string &ofile, ObjectSpace *ospace) { 
@@ -68,6 +85,7 @@ namespace NGT {
 	NGTThrowException(msg);
       }
       Parent::serializeAsText(objs, ospace); 
+      serializeQuantizer(ofile);
     }
 
     void deserializeAsText(const std::string &ifile, ObjectSpace *ospace) { 
@@ -78,6 +96,36 @@ namespace NGT {
 	NGTThrowException(msg);
       }
       Parent::deserializeAsText(objs, ospace); 
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+      moveToArena();
+#endif
+      deserializeQuantizer(ifile);
+    }
+
+    // the ranges are not saved until they are learned so that they are learned from the objects appended later.
+    // the originals of the shared memory are not saved, because they are in their own mapped file.
+    void serializeQuantizer(const std::string &ofile) {
+      if (quantizer == 0 || !quantizer->isTrained()) {
+	return;
+      }
+      quantizer->serialize(ofile + "sq");
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+      if (quantizer->isKeepingOriginals()) {
+	quantizer->getOriginals().serialize(ofile + "or");
+      }
+#endif
+    }
+
+    void deserializeQuantizer(const std::string &ifile) {
+      if (quantizer == 0) {
+	return;
+      }
+      quantizer->deserialize(ifile + "sq");
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+      if (quantizer->isKeepingOriginals()) {
+	quantizer->getOriginals().deserialize(ifile + "or");
+      }
+#endif
     }
 
     void readText(std::istream &is, size_t dataSize = 0) {
@@ -118,18 +166,12 @@ namespace NGT {
       if (dataSize > 0) {
 	reserve(size() + dataSize);
       }
-      std::string line;
-      size_t lineNo = 0;
-      while (getline(is, line)) {
-	lineNo++;
-	if (dataSize > 0 && (dataSize <= size() - prevDataSize)) {
-	  std::cerr << "The size of data reached the specified size. The remaining data in the file are not inserted. " 
-	       << dataSize << std::endl;
-	  break;
-	}
-	std::vector<double> object;
-	try {
-	  extractObjectFromText(line, "\t ", object);
+      if (quantizer != 0 && !quantizer->isTrained()) {
+	trainQuantizer(is, dataSize);
+      }
+      std::vector<double> object(dimension);
+      parseText(is, dataSize, true, [&](const double *values) {
+	  object.assign(values, values + dimension);
 	  PersistentObject *obj = 0;
 	  try {
 	    obj = allocateNormalizedPersistentObject(object);
@@ -138,12 +180,248 @@ namespace NGT {
 	    obj = allocatePersistentObject(object);
 	  }
 	  push_back(obj);
+	});
+    }
+
+    // read the text by the chunks of whole lines and parse the lines of each chunk in parallel.
+    // the objects are passed to the function in the order of the lines.
+    template <typename FUNCTION>
+    void parseText(std::istream &is, size_t dataSize, bool verbose, FUNCTION function) {
+      const size_t chunkSize = NGT_TEXT_CHUNK_SIZE;
+      std::vector<char> chunk;
+      std::vector<std::pair<size_t, size_t>> lines;
+      std::vector<double> objects;
+      std::vector<int> status;
+      size_t lineNo = 0;
+      size_t count = 0;
+      size_t remainder = 0;
+      bool eof = false;
+      while (!eof) {
+	chunk.resize(remainder + chunkSize);
+	is.read(chunk.data() + remainder, chunkSize);
+	chunk.resize(remainder + is.gcount());
+	eof = !is;
+	size_t end = chunk.size();
+	if (!eof) {
+	  // the last incomplete line is left for the next chunk.
+	  while (end > 0 && chunk[end - 1] != '\n') {
+	    end--;
+	  }
+	  if (end == 0) {
+	    remainder = chunk.size();
+	    continue;
+	  }
+	}
+	lines.clear();
+	for (size_t begin = 0; begin < end;) {
+	  const char *newline = static_cast<const char*>(memchr(&chunk[begin], '\n', end - begin));
+	  size_t next = newline == 0 ? end : newline - chunk.data();
+	  lines.push_back(std::make_pair(begin, next));
+	  begin = next + 1;
+	}
+	objects.resize(lines.size() * dimension);
+	status.resize(lines.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+	for (size_t i = 0; i < lines.size(); i++) {
+	  status[i] = parseLine(&chunk[0] + lines[i].first, &chunk[0] + lines[i].second, &objects[i * dimension], dimension);
+	}
+	for (size_t i = 0; i < lines.size(); i++) {
+	  lineNo++;
+	  if (dataSize > 0 && dataSize <= count) {
+	    if (verbose) {
+	      std::cerr << "The size of data reached the specified size. The remaining data in the file are not inserted. " 
+			<< dataSize << std::endl;
+	    }
+	    return;
+	  }
+	  if (status[i] == ParseInvalidLine) {
+	    if (verbose) {
+	      std::string line(&chunk[0] + lines[i].first, &chunk[0] + lines[i].second);
+	      std::cerr << "ObjectSpace::readText: Warning! Invalid line. [" << line << "] Skip the line " << lineNo << " and continue." << std::endl;
+	    }
+	    continue;
+	  }
+	  if (status[i] == ParseNotNumerical && verbose) {
+	    std::cerr << "ObjectSpace::readText: Warning! Not numerical value. Line " << lineNo << std::endl;
+	  }
+	  function(&objects[i * dimension]);
+	  count++;
+	}
+	remainder = chunk.size() - end;
+	std::copy(chunk.begin() + end, chunk.end(), chunk.begin());
+      }
+    }
+
+    enum ParseStatus {
+      ParseSucceeded	= 0,
+      ParseNotNumerical	= 1,
+      ParseInvalidLine	= 2
+    };
+
+    // parse the values delimited by a tab or a space like extractObjectFromText but without any allocation.
+    // the values after a non-numerical value are left zero.
+    static int parseLine(const char *begin, const char *end, double *object, size_t dimension) {
+      size_t separators = 0;
+      for (const char *p = begin; p < end && separators + 1 < dimension; p++) {
+	if (*p == '\t' || *p == ' ') {
+	  separators++;
+	}
+      }
+      if (separators + 1 < dimension) {
+	return ParseInvalidLine;
+      }
+      const char *p = begin;
+      for (size_t idx = 0; idx < dimension; idx++) {
+	const char *e = p;
+	while (e < end && *e != '\t' && *e != ' ') {
+	  e++;
+	}
+	if (e == p) {
+	  return ParseInvalidLine;
+	}
+	if (!parseValue(p, e, object[idx])) {
+	  std::fill(object + idx + 1, object + dimension, 0.0);
+	  return ParseNotNumerical;
+	}
+	p = e + 1;
+      }
+      return ParseSucceeded;
+    }
+
+    // parse the decimal number without the locale. the number is exactly converted only when the digits and the exponent
+    // are small enough so that the result is identical to strtod. otherwise, strtod is used.
+    static bool parseValue(const char *begin, const char *end, double &value) {
+      static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+      const char *p = begin;
+      bool negative = false;
+      if (p < end && (*p == '-' || *p == '+')) {
+	negative = *p == '-';
+	p++;
+      }
+      uint64_t mantissa = 0;
+      int digits = 0;
+      int exponent = 0;
+      bool found = false;
+      for (; p < end && *p >= '0' && *p <= '9'; p++) {
+	found = true;
+	if (mantissa != 0 || *p != '0') {
+	  mantissa = mantissa * 10 + (*p - '0');
+	  digits++;
+	}
+      }
+      if (p < end && *p == '.') {
+	for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+	  found = true;
+	  if (mantissa != 0 || *p != '0') {
+	    mantissa = mantissa * 10 + (*p - '0');
+	    digits++;
+	  }
+	  exponent--;
+	}
+      }
+      if (found && p < end && (*p == 'e' || *p == 'E')) {
+	const char *q = p + 1;
+	bool negativeExponent = false;
+	if (q < end && (*q == '-' || *q == '+')) {
+	  negativeExponent = *q == '-';
+	  q++;
+	}
+	int e = 0;
+	const char *digitBegin = q;
+	for (; q < end && *q >= '0' && *q <= '9' && e < 10000; q++) {
+	  e = e * 10 + (*q - '0');
+	}
+	if (q != digitBegin) {
+	  exponent += negativeExponent ? -e : e;
+	  p = q;
+	}
+      }
+      if (found && p == end && digits <= 15 && exponent >= -22 && exponent <= 22) {
+	value = static_cast<double>(mantissa);
+	value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+	value = negative ? -value : value;
+	return true;
+      }
+      std::string token(begin, end);
+      char *e;
+      value = std::strtod(token.c_str(), &e);
+      return *e == 0;
+    }
+
+    void readBinary(const std::string &file, size_t dataSize = 0) {
+      initialize();
+      appendBinary(file, dataSize);
+    }
+
+    // append the vectors of the binary file, which are read from the mapped file without parsing.
+    void appendBinary(const std::string &file, size_t dataSize = 0) {
+      if (dimension == 0) {
+	NGTThrowException("ObjectSpace::appendBinary: Dimension is not specified.");
+      }
+      VectorFile vectors;
+      vectors.open(file, dimension);
+      if (vectors.getDimension() != dimension) {
+	std::stringstream msg;
+	msg << "ObjectSpace::appendBinary: The dimensions are inconsistent. " << vectors.getDimension() << ":" << dimension;
+	NGTThrowException(msg);
+      }
+      size_t objectCount = vectors.size();
+      if (dataSize > 0 && dataSize < objectCount) {
+	objectCount = dataSize;
+      }
+      if (size() == 0) {
+	// First entry should be always a dummy entry.
+	// If it is empty, the dummy entry should be inserted.
+	push_back((PersistentObject*)0);
+      }
+      reserve(size() + objectCount);
+      if (quantizer != 0 && !quantizer->isTrained()) {
+	quantizer->resetRange();
+	std::vector<float> buffer(dimension);
+	for (size_t idx = 0; idx < objectCount; idx++) {
+	  quantizer->expandRange(getBinaryObject(vectors, idx, buffer));
+	}
+	quantizer->fixRange();
+	saveQuantizer();
+      }
+      std::vector<float> buffer(dimension);
+      for (size_t idx = 0; idx < objectCount; idx++) {
+	const float *object = getBinaryObject(vectors, idx, buffer);
+	PersistentObject *obj = 0;
+	try {
+	  obj = allocateNormalizedPersistentObject(object, dimension);
 	} catch (Exception &err) {
-	  std::cerr << "ObjectSpace::readText: Warning! Invalid line. [" << line << "] Skip the line " << lineNo << " and continue." << std::endl;
+	  std::cerr << err.what() << " continue..." << std::endl;
+	  obj = allocatePersistentObject(object, dimension);
 	}
+	push_back(obj);
       }
     }
 
+    // the float vectors are returned without copying. the others are converted into the buffer.
+    const float *getBinaryObject(VectorFile &vectors, size_t idx, std::vector<float> &buffer) {
+      const void *v = vectors.get(idx);
+      switch (vectors.getElementType()) {
+      case VectorFile::ElementTypeFloat:
+	return static_cast<const float*>(v);
+      case VectorFile::ElementTypeUint8:
+	std::copy(static_cast<const uint8_t*>(v), static_cast<const uint8_t*>(v) + dimension, buffer.begin());
+	break;
+      case VectorFile::ElementTypeInt32:
+	std::copy(static_cast<const int32_t*>(v), static_cast<const int32_t*>(v) + dimension, buffer.begin());
+	break;
+      case VectorFile::ElementTypeDouble:
+	std::copy(static_cast<const double*>(v), static_cast<const double*>(v) + dimension, buffer.begin());
+	break;
+      default:
+	NGTThrowException("ObjectSpace::appendBinary: Invalid element type.");
+      }
+      return buffer.data();
+    }
+
     template <typename T>
     void append(T *data, size_t objectCount) {
       if (dimension == 0) {
@@ -157,6 +435,10 @@ namespace NGT {
       if (objectCount > 0) {
 	reserve(size() + objectCount);
       }
+      if (quantizer != 0 && !quantizer->isTrained()) {
+	quantizer->train(data, objectCount);
+	saveQuantizer();
+      }
       for (size_t idx = 0; idx < objectCount; idx++, data += dimension) {
 	std::vector<double> object;
 	object.reserve(dimension);
@@ -179,8 +461,28 @@ namespace NGT {
       }
     }
 
+    // learn the ranges of the quantizer from the text before the objects are appended.
+    void trainQuantizer(std::istream &is, size_t dataSize) {
+      std::streampos start = is.tellg();
+      if (start == std::streampos(-1)) {
+	NGTThrowException("ObjectSpace::trainQuantizer: The ranges cannot be learned from the unseekable stream.");
+      }
+      quantizer->resetRange();
+      parseText(is, dataSize, false, [&](const double *object) { quantizer->expandRange(object); });
+      is.clear();
+      is.seekg(start);
+      quantizer->fixRange();
+      saveQuantizer();
+    }
+
+    void saveQuantizer() {
+      if (!quantizerFile.empty()) {
+	quantizer->serialize(quantizerFile);
+      }
+    }
+
     Object *allocateObject() {
-      return (Object*) new Object(paddedByteSize);
+      return (Object*) new Object(queryByteSize);
     }
 
     // This method is called during search to generate query.
@@ -221,13 +523,20 @@ namespace NGT {
 
     template <typename T>
       Object *allocateObject(T *o, size_t size = 0) {
-      Object *po = new Object(paddedByteSize);
+      Object *po = new Object(queryByteSize);
+      setObject(*po, o, size);
+      return po;
+    }
+
+    // the scalar quantized object is set in the layout of the queries unless it is persistent.
+    template <typename T>
+      void setObject(Object &po, T *o, size_t size = 0, bool persistent = false) {
       if (size != 0 && dimension != size) {
 	std::cerr << "ObjectSpace::allocateObject: Fatal error! dimension is invalid. The indexed objects=" 
 	     << dimension << " The specified object=" << size << std::endl;
 	assert(dimension == size);
       }
-      void *object = static_cast<void*>(&(*po)[0]);
+      void *object = static_cast<void*>(&po[0]);
       if (type == typeid(uint8_t)) {
 	uint8_t *obj = static_cast<uint8_t*>(object);
 	for (size_t i = 0; i < dimension; i++) {
@@ -238,11 +547,21 @@ namespace NGT {
 	for (size_t i = 0; i < dimension; i++) {
 	  obj[i] = static_cast<float>(o[i]);
 	}
+      } else if (type == typeid(float16)) {
+	float16 *obj = static_cast<float16*>(object);
+	for (size_t i = 0; i < dimension; i++) {
+	  obj[i] = static_cast<float>(o[i]);
+	}
+      } else if (type == typeid(qint8)) {
+	if (persistent) {
+	  quantizer->quantizePersistent(o, static_cast<qint8*>(object));
+	} else {
+	  quantizer->quantizeQuery(o, static_cast<qint8*>(object));
+	}
       } else {
 	std::cerr << "ObjectSpace::allocate: Fatal error: unsupported type!" << std::endl;
 	abort();
       }
-      return po;
     }
 
     template <typename T>
@@ -258,6 +577,10 @@ namespace NGT {
 	cpsize *= sizeof(uint8_t);
       } else if (type == typeid(float)) {
 	cpsize *= sizeof(float);
+      } else if (type == typeid(float16)) {
+	cpsize *= sizeof(float16);
+      } else if (type == typeid(qint8)) {
+	cpsize = 0;
       } else {
 	std::cerr << "ObjectSpace::allocate: Fatal error: unsupported type!" << std::endl;
 	abort();
@@ -265,7 +588,12 @@ namespace NGT {
       PersistentObject *po = new (objectAllocator) PersistentObject(objectAllocator, paddedByteSize);
       void *dsto = &(*po).at(0, allocator);
       void *srco = &o[0];
-      memcpy(dsto, srco, cpsize);
+      if (type == typeid(qint8)) {
+	// the original which follows the codes of the query is moved to the repository of the originals.
+	quantizer->persist(static_cast<qint8*>(srco), static_cast<qint8*>(dsto));
+      } else {
+	memcpy(dsto, srco, cpsize);
+      }
       return po;
     }
 
@@ -289,6 +617,13 @@ namespace NGT {
 	for (size_t i = 0; i < dimension; i++) {
 	  obj[i] = static_cast<float>(o[i]);
 	}
+      } else if (type == typeid(float16)) {
+	float16 *obj = static_cast<float16*>(object);
+	for (size_t i = 0; i < dimension; i++) {
+	  obj[i] = static_cast<float>(o[i]);
+	}
+      } else if (type == typeid(qint8)) {
+	quantizer->quantizePersistent(o, static_cast<qint8*>(object));
       } else {
 	std::cerr << "ObjectSpace::allocate: Fatal error: unsupported type!" << std::endl;
 	abort();
@@ -305,7 +640,45 @@ namespace NGT {
     // ObjectRepository
     template <typename T>
     PersistentObject *allocatePersistentObject(const std::vector<T> &o) {
-      return allocateObject(o);
+      return allocatePersistentObject(o.data(), o.size());
+    }
+
+    template <typename T>
+    PersistentObject *allocatePersistentObject(T *o, size_t size = 0) {
+      Object *po = arena.isEnabled() ? new ArenaObject(arena, paddedByteSize) : new Object(paddedByteSize);
+      setObject(*po, o, size, true);
+      return po;
+    }
+
+    // the object of another repository of the same type and dimension is copied as is.
+    PersistentObject *copyPersistentObject(Object &o) {
+      Object *po = arena.isEnabled() ? new ArenaObject(arena, paddedByteSize) : new Object(paddedByteSize);
+      memcpy(po->getPointer(), o.getPointer(), paddedByteSize);
+      return po;
+    }
+
+    // the indexed objects are placed in the huge pages. the queries are allocated as usual.
+    void setHugePage(HugePage::Mode mode) {
+      if (mode != HugePage::ModeNone) {
+	arena.setMode(mode);
+      }
+    }
+
+    // the objects which are read from the file are copied into the arena.
+    void moveToArena() {
+      if (!arena.isEnabled()) {
+	return;
+      }
+      for (size_t id = 0; id < Parent::size(); id++) {
+	Object *o = (*this)[id];
+	if (o == 0) {
+	  continue;
+	}
+	Object *po = new ArenaObject(arena, paddedByteSize);
+	memcpy(po->getPointer(), o->getPointer(), paddedByteSize);
+	delete o;
+	(*this)[id] = po;
+      }
     }
 #endif
 
@@ -325,6 +698,14 @@ namespace NGT {
 	for (size_t i = 0; i < dimension; i++) {
 	  d.push_back(obj[i]);
 	}
+      } else if (type == typeid(float16)) {
+	float16 *obj = (float16*)object;
+	for (size_t i = 0; i < dimension; i++) {
+	  d.push_back(obj[i]);
+	}
+      } else if (type == typeid(qint8)) {
+	d.resize(d.size() + dimension);
+	quantizer->dequantize((qint8*)object, d.data() + d.size() - dimension);
       } else {
 	std::cerr << "ObjectSpace::allocate: Fatal error: unsupported type!" << std::endl;
 	abort();
@@ -350,14 +731,27 @@ namespace NGT {
     void setPaddedLength(size_t l) {
       paddedByteSize = l;
     }
+    void setQueryLength(size_t l) {
+      queryByteSize = l;
+    }
 
     size_t getByteSize() { return byteSize; }
+    // the objects are not loaded, because they are referred to in the index image.
+    void setInImage() { inImage = true; }
+    bool isInImage() { return inImage; }
     size_t insert(PersistentObject *obj) { return Parent::insert(obj); }
     const size_t dimension;
     const std::type_info &type;
    protected:
     size_t byteSize;		// the length of all of elements.
     size_t paddedByteSize;
+    size_t queryByteSize;	// the queries of the scalar quantized objects have the originals.
+    ScalarQuantizer *quantizer;	// only for the scalar quantized objects.
+    std::string quantizerFile;
+    bool inImage;
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+    ObjectArena arena;
+#endif
   };
 
 } // namespace NGT
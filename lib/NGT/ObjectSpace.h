@@ -17,6 +17,8 @@
 #pragma once
 
 #include "PrimitiveComparator.h"
+#include "HugePage.h"
+#include "SlabAllocator.h"
 
 class ObjectSpace;
 
@@ -132,7 +134,71 @@ namespace NGT {
       return *this;
     }
 #else // NGT_SHARED_MEMORY_ALLOCATOR
-  typedef ObjectDistances	GraphNode;
+  // GraphNode keeps the edges in a block of the slab instead of a separately allocated array. the capacity is
+  // rounded up to the block so that the edges are added in place until the block is full.
+  // the node itself, its pointer in the graph repository and its previous size in prevsize are still kept
+  // for each node apart from the block.
+  class GraphNode : public std::vector<ObjectDistance, SlabAllocator<ObjectDistance>> {
+  public:
+    typedef std::vector<ObjectDistance, SlabAllocator<ObjectDistance>>	Base;
+    GraphNode(NGT::ObjectSpace *os = 0) {}
+    GraphNode(const GraphNode &node):Base() { *this = node; }
+    GraphNode(const ObjectDistances &objs) { *this = objs; }
+    GraphNode &operator=(const GraphNode &node) { return this == &node ? *this : assign(node.begin(), node.end()); }
+    GraphNode &operator=(const ObjectDistances &objs) { return assign(objs.begin(), objs.end()); }
+    explicit operator ObjectDistances() const {
+      ObjectDistances objs;
+      objs.assign(begin(), end());
+      return objs;
+    }
+
+    template <typename ITERATOR>
+    GraphNode &assign(ITERATOR b, ITERATOR e) {
+      size_t s = std::distance(b, e);
+      if (s > capacity()) {
+	Base().swap(*this);
+	reserve(SlabAllocator<ObjectDistance>::getCapacity(s));
+      }
+      Base::assign(b, e);
+      return *this;
+    }
+
+    void serialize(std::ofstream &os, ObjectSpace *objspace = 0) {
+      uint32_t s = size();
+      NGT::Serializer::write(os, s);
+      os.write(reinterpret_cast<const char*>(data()), s * sizeof(ObjectDistance));
+    }
+    void deserialize(std::ifstream &is, ObjectSpace *objspace = 0) {
+      uint32_t s;
+      NGT::Serializer::read(is, s);
+      clear();
+      if (s > capacity()) {
+	reserve(SlabAllocator<ObjectDistance>::getCapacity(s));
+      }
+      resize(s);
+      is.read(reinterpret_cast<char*>(data()), s * sizeof(ObjectDistance));
+    }
+    void serializeAsText(std::ofstream &os, ObjectSpace *objspace = 0) {
+      NGT::Serializer::writeAsText(os, size());
+      os << " ";
+      for (size_t i = 0; i < size(); i++) {
+	(*this)[i].serializeAsText(os);
+	os << " ";
+      }
+    }
+    void deserializeAsText(std::ifstream &is, ObjectSpace *objspace = 0) {
+      size_t s;
+      NGT::Serializer::readAsText(is, s);
+      clear();
+      if (s > capacity()) {
+	reserve(SlabAllocator<ObjectDistance>::getCapacity(s));
+      }
+      resize(s);
+      for (size_t i = 0; i < size(); i++) {
+	(*this)[i].deserializeAsText(is);
+      }
+    }
+  };
 #endif // NGT_SHARED_MEMORY_ALLOCATOR
 
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
@@ -157,6 +223,10 @@ namespace NGT {
       virtual double operator()(Object &objecta, PersistentObject &objectb) = 0;
       virtual double operator()(PersistentObject &objecta, PersistentObject &objectb) = 0;
 #endif
+      // compares with a raw vector such as a copy in the inline vectors of the read-only graph or an object in the index image.
+      virtual double operator()(Object &objecta, const void *objectb) {
+	NGTThrowException("ObjectSpace::Comparator: Not supported for the inline vectors.");
+      }
       size_t dimension;
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
       SharedMemoryAllocator &allocator;
@@ -178,12 +248,14 @@ namespace NGT {
     enum ObjectType {
       ObjectTypeNone	= 0,
       Uint8		= 1,
-      Float		= 2
+      Float		= 2,
+      Float16		= 3,
+      Qint8		= 4
     };
 
 
     typedef std::priority_queue<ObjectDistance, std::vector<ObjectDistance>, std::less<ObjectDistance> > ResultSet;
-    ObjectSpace(size_t d):dimension(d), distanceType(DistanceTypeNone), comparator(0), normalization(false) {}
+    ObjectSpace(size_t d):dimension(d), distanceType(DistanceTypeNone), comparator(0), normalization(false), refinementExpansion(0) {}
     virtual ~ObjectSpace() { if (comparator != 0) { delete comparator; } }
     
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
@@ -207,6 +279,8 @@ namespace NGT {
     virtual void deserializeAsText(const std::string &of) = 0;
     virtual void readText(std::istream &is, size_t dataSize) = 0;
     virtual void appendText(std::istream &is, size_t dataSize) = 0;
+    virtual void readBinary(const std::string &file, size_t dataSize) = 0;
+    virtual void appendBinary(const std::string &file, size_t dataSize) = 0;
     virtual void append(const float *data, size_t dataSize) = 0;
     virtual void append(const double *data, size_t dataSize) = 0;
 
@@ -225,6 +299,7 @@ namespace NGT {
     virtual Object *allocateNormalizedObject(const std::vector<float> &obj) = 0;
     virtual Object *allocateNormalizedObject(const std::vector<uint8_t> &obj) = 0;
     virtual Object *allocateNormalizedObject(const float *obj, size_t size) = 0;
+    virtual void setNormalizedObject(Object &object, const float *obj, size_t size) = 0;
     virtual PersistentObject *allocateNormalizedPersistentObject(const std::vector<double> &obj) = 0;
     virtual PersistentObject *allocateNormalizedPersistentObject(const std::vector<float> &obj) = 0;
     virtual void deleteObject(Object *po) = 0;
@@ -239,6 +314,11 @@ namespace NGT {
     virtual void getObject(size_t idx, std::vector<float> &v) = 0;
     virtual void getObjects(const std::vector<size_t> &idxs, std::vector<std::vector<float>> &vs) = 0;
 
+    // recompute the distances of the results with the original objects, and keep the nearest size results.
+    // only the scalar quantized objects that keep their originals are refined.
+    virtual void refine(Object &query, ObjectDistances &results, size_t size) {}
+    size_t getRefinementExpansion() { return refinementExpansion; }
+
     size_t getDimension() { return dimension; }
     size_t getPaddedDimension() { return ((dimension - 1) / 16 + 1) * 16; }
 
@@ -258,6 +338,8 @@ namespace NGT {
 	data[i] = (double)data[i] / sum;
       }
     }
+    // the scalar quantized objects are not normalized, because their cosines are computed with their norms.
+    void normalize(qint8 *data, size_t dim) {}
     uint32_t getPrefetchOffset() { return prefetchOffset; }
     uint32_t setPrefetchOffset(size_t offset) {
       if (offset == 0) {
@@ -281,6 +363,7 @@ namespace NGT {
     DistanceType	distanceType;
     Comparator		*comparator;
     bool		normalization;
+    size_t		refinementExpansion;
     uint32_t		prefetchOffset;
     uint32_t		prefetchSize;
   };
@@ -308,6 +391,10 @@ namespace NGT {
 	NGT::Serializer::writeAsText(os, (uint8_t*)ref, dimension); 
       } else if (t == typeid(float)) {
 	NGT::Serializer::writeAsText(os, (float*)ref, dimension); 
+      } else if (t == typeid(float16)) {
+	NGT::Serializer::writeAsText(os, (float16*)ref, dimension); 
+      } else if (t == typeid(qint8)) {
+	NGT::Serializer::writeAsText(os, (uint8_t*)ref, objectspace->getByteSizeOfObject()); 
       } else if (t == typeid(double)) {
 	NGT::Serializer::writeAsText(os, (double*)ref, dimension); 
       } else if (t == typeid(uint16_t)) {
@@ -329,6 +416,10 @@ namespace NGT {
 	NGT::Serializer::readAsText(is, (uint8_t*)ref, dimension); 
       } else if (t == typeid(float)) {
 	NGT::Serializer::readAsText(is, (float*)ref, dimension); 
+      } else if (t == typeid(float16)) {
+	NGT::Serializer::readAsText(is, (float16*)ref, dimension); 
+      } else if (t == typeid(qint8)) {
+	NGT::Serializer::readAsText(is, (uint8_t*)ref, objectspace->getByteSizeOfObject()); 
       } else if (t == typeid(double)) {
 	NGT::Serializer::readAsText(is, (double*)ref, dimension); 
       } else if (t == typeid(uint16_t)) {
@@ -370,6 +461,10 @@ namespace NGT {
     void *getPointer(size_t idx = 0) const { return vector + idx; }
 
     static Object *allocate(ObjectSpace &objectspace) { return new Object(&objectspace); }
+  protected:
+    // the vector is not owned by the object. it should be released before the destruction.
+    Object(uint8_t *v):vector(v) {}
+    uint8_t *release() { uint8_t *v = vector; vector = 0; return v; }
   private:
     void clear() {
       if (vector != 0) {
@@ -388,6 +483,17 @@ namespace NGT {
     uint8_t* vector;
   };
 
+#ifndef NGT_SHARED_MEMORY_ALLOCATOR
+  // the object whose vector is in the huge pages of the arena.
+  class ArenaObject : public Object {
+  public:
+    ArenaObject(ObjectArena &a, size_t s):Object(static_cast<uint8_t*>(a.allocate(s))), arena(a) {}
+    ~ArenaObject() { arena.deallocate(release()); }
+  private:
+    ObjectArena &arena;
+  };
+#endif
+
 
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
   class PersistentObject : public BaseObject {
@@ -19,6 +19,7 @@
 
 #include	"Common.h"
 #include	"ObjectSpace.h"
+#include	"VectorFile.h"
 #include	"ObjectRepository.h"
 #include	"PrimitiveComparator.h"
 
@@ -30,190 +31,276 @@ namespace NGT {
     class ObjectSpaceRepository : public ObjectSpace, public ObjectRepository {
   public:
 
+    template <typename PRIMITIVE_COMPARATOR>
     class ComparatorL1 : public Comparator {
       public:
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
         ComparatorL1(size_t d, SharedMemoryAllocator &a) : Comparator(d, a) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareL1((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareL1((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 	double operator()(Object &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareL1((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareL1((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 	double operator()(PersistentObject &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareL1((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareL1((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 #else
         ComparatorL1(size_t d) : Comparator(d) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareL1((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareL1((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 #endif
+	double operator()(Object &objecta, const void *objectb) {
+	  return PRIMITIVE_COMPARATOR::compareL1((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)objectb, dimension);
+	}
     };
 
+    template <typename PRIMITIVE_COMPARATOR>
     class ComparatorL2 : public Comparator {
       public:
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
         ComparatorL2(size_t d, SharedMemoryAllocator &a) : Comparator(d, a) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareL2((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareL2((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 	double operator()(Object &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareL2((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareL2((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 	double operator()(PersistentObject &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareL2((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareL2((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 #else
         ComparatorL2(size_t d) : Comparator(d) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareL2((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareL2((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 #endif
+	double operator()(Object &objecta, const void *objectb) {
+	  return PRIMITIVE_COMPARATOR::compareL2((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)objectb, dimension);
+	}
     };
 
+    template <typename PRIMITIVE_COMPARATOR>
     class ComparatorHammingDistance : public Comparator {
       public:
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
         ComparatorHammingDistance(size_t d, SharedMemoryAllocator &a) : Comparator(d, a) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareHammingDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareHammingDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 	double operator()(Object &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareHammingDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareHammingDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 	double operator()(PersistentObject &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareHammingDistance((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareHammingDistance((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 #else
         ComparatorHammingDistance(size_t d) : Comparator(d) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareHammingDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareHammingDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 #endif
+	double operator()(Object &objecta, const void *objectb) {
+	  return PRIMITIVE_COMPARATOR::compareHammingDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)objectb, dimension);
+	}
     };
 
+    template <typename PRIMITIVE_COMPARATOR>
     class ComparatorJaccardDistance : public Comparator {
       public:
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
         ComparatorJaccardDistance(size_t d, SharedMemoryAllocator &a) : Comparator(d, a) {}
         double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareJaccardDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareJaccardDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 	double operator()(Object &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareJaccardDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareJaccardDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 	double operator()(PersistentObject &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareJaccardDistance((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareJaccardDistance((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 #else
         ComparatorJaccardDistance(size_t d) : Comparator(d) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareJaccardDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareJaccardDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 #endif
+	double operator()(Object &objecta, const void *objectb) {
+	  return PRIMITIVE_COMPARATOR::compareJaccardDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)objectb, dimension);
+	}
     };
 
+    template <typename PRIMITIVE_COMPARATOR>
     class ComparatorAngleDistance : public Comparator {
       public:
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
         ComparatorAngleDistance(size_t d, SharedMemoryAllocator &a) : Comparator(d, a) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 	double operator()(Object &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 	double operator()(PersistentObject &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareAngleDistance((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareAngleDistance((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 #else
         ComparatorAngleDistance(size_t d) : Comparator(d) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 #endif
+	double operator()(Object &objecta, const void *objectb) {
+	  return PRIMITIVE_COMPARATOR::compareAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)objectb, dimension);
+	}
     };
 
+    template <typename PRIMITIVE_COMPARATOR>
     class ComparatorNormalizedAngleDistance : public Comparator {
       public:
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
         ComparatorNormalizedAngleDistance(size_t d, SharedMemoryAllocator &a) : Comparator(d, a) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareNormalizedAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareNormalizedAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 	double operator()(Object &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareNormalizedAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareNormalizedAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 	double operator()(PersistentObject &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareNormalizedAngleDistance((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareNormalizedAngleDistance((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 #else
         ComparatorNormalizedAngleDistance(size_t d) : Comparator(d) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareNormalizedAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareNormalizedAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 #endif
+	double operator()(Object &objecta, const void *objectb) {
+	  return PRIMITIVE_COMPARATOR::compareNormalizedAngleDistance((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)objectb, dimension);
+	}
     };
 
+    template <typename PRIMITIVE_COMPARATOR>
     class ComparatorCosineSimilarity : public Comparator {
       public:
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
         ComparatorCosineSimilarity(size_t d, SharedMemoryAllocator &a) : Comparator(d, a) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 	double operator()(Object &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 	double operator()(PersistentObject &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareCosineSimilarity((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareCosineSimilarity((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 #else
         ComparatorCosineSimilarity(size_t d) : Comparator(d) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 #endif
+	double operator()(Object &objecta, const void *objectb) {
+	  return PRIMITIVE_COMPARATOR::compareCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)objectb, dimension);
+	}
     };
 
+    template <typename PRIMITIVE_COMPARATOR>
     class ComparatorNormalizedCosineSimilarity : public Comparator {
       public:
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
         ComparatorNormalizedCosineSimilarity(size_t d, SharedMemoryAllocator &a) : Comparator(d, a) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareNormalizedCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareNormalizedCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 	double operator()(Object &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareNormalizedCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareNormalizedCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 	double operator()(PersistentObject &objecta, PersistentObject &objectb) {
-	  return PrimitiveComparator::compareNormalizedCosineSimilarity((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
+	  return PRIMITIVE_COMPARATOR::compareNormalizedCosineSimilarity((OBJECT_TYPE*)&objecta.at(0, allocator), (OBJECT_TYPE*)&objectb.at(0, allocator), dimension);
 	}
 #else
         ComparatorNormalizedCosineSimilarity(size_t d) : Comparator(d) {}
 	double operator()(Object &objecta, Object &objectb) {
-	  return PrimitiveComparator::compareNormalizedCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
+	  return PRIMITIVE_COMPARATOR::compareNormalizedCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)&objectb[0], dimension);
 	}
 #endif
+	double operator()(Object &objecta, const void *objectb) {
+	  return PRIMITIVE_COMPARATOR::compareNormalizedCosineSimilarity((OBJECT_TYPE*)&objecta[0], (OBJECT_TYPE*)objectb, dimension);
+	}
     };
 
-    ObjectSpaceRepository(size_t d, const std::type_info &ot, DistanceType t) : ObjectSpace(d), ObjectRepository(d, ot) {
+    template <typename PRIMITIVE_COMPARATOR, int DISTANCE_TYPE>
+    class ComparatorScalarQuantized : public Comparator {
+      public:
+#ifdef NGT_SHARED_MEMORY_ALLOCATOR
+        ComparatorScalarQuantized(size_t d, SharedMemoryAllocator &a, ScalarQuantizer &q) : Comparator(d, a), scale(q.getScale()), offset(q.getOffset()) {}
+	double operator()(Object &objecta, Object &objectb) {
+	  return compare((qint8*)&objecta[0], (qint8*)&objectb[0]);
+	}
+	double operator()(Object &objecta, PersistentObject &objectb) {
+	  return compare((qint8*)&objecta[0], (qint8*)&objectb.at(0, allocator));
+	}
+	double operator()(PersistentObject &objecta, PersistentObject &objectb) {
+	  return compare((qint8*)&objecta.at(0, allocator), (qint8*)&objectb.at(0, allocator));
+	}
+#else
+        ComparatorScalarQuantized(size_t d, ScalarQuantizer &q) : Comparator(d), scale(q.getScale()), offset(q.getOffset()) {}
+	double operator()(Object &objecta, Object &objectb) {
+	  return compare((qint8*)&objecta[0], (qint8*)&objectb[0]);
+	}
+#endif
+	double operator()(Object &objecta, const void *objectb) {
+	  return compare((qint8*)&objecta[0], static_cast<const qint8*>(objectb));
+	}
+	double compare(const qint8 *a, const qint8 *b) {
+	  switch (DISTANCE_TYPE) {
+	  case DistanceTypeL1:		return PRIMITIVE_COMPARATOR::compareL1(a, b, scale, dimension);
+	  case DistanceTypeAngle:	return PRIMITIVE_COMPARATOR::compareAngleDistance(a, b, scale, offset, dimension);
+	  case DistanceTypeCosine:	return PRIMITIVE_COMPARATOR::compareCosineSimilarity(a, b, scale, offset, dimension);
+	  default:			return PRIMITIVE_COMPARATOR::compareL2(a, b, scale, dimension);
+	  }
+	}
+	const float *scale;
+	const float *offset;
+    };
+
+    ObjectSpaceRepository(size_t d, const std::type_info &ot, DistanceType t, size_t expansion = 0) : ObjectSpace(d), ObjectRepository(d, ot) {
      size_t objectSize = 0;
      if (ot == typeid(uint8_t)) {
        objectSize = sizeof(uint8_t);
      } else if (ot == typeid(float)) {
        objectSize = sizeof(float);
+     } else if (ot == typeid(float16)) {
+       objectSize = sizeof(float16);
+     } else if (ot == typeid(qint8)) {
+       objectSize = sizeof(qint8);
+       refinementExpansion = expansion;
+       quantizer = new ScalarQuantizer(d, ObjectSpace::getPaddedDimension(), expansion > 0);
      } else {
        std::stringstream msg;
        msg << "ObjectSpace::constructor: Not supported type. " << ot.name();
        NGTThrowException(msg);
      }
-     setLength(objectSize * d);
-     setPaddedLength(objectSize * ObjectSpace::getPaddedDimension());
+     if (quantizer != 0) {
+       setLength(quantizer->getByteSize());
+       setPaddedLength(quantizer->getByteSize());
+       setQueryLength(quantizer->getQueryByteSize());
+     } else {
+       setLength(objectSize * d);
+       setPaddedLength(objectSize * ObjectSpace::getPaddedDimension());
+       setQueryLength(objectSize * ObjectSpace::getPaddedDimension());
+     }
      setDistanceType(t);
    }
 
+    ~ObjectSpaceRepository() {
+      if (quantizer != 0) {
+	delete quantizer;
+      }
+    }
+
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
     void open(const std::string &f, size_t sharedMemorySize) { ObjectRepository::open(f, sharedMemorySize); }
     void copy(PersistentObject &objecta, PersistentObject &objectb) { objecta = objectb; }
@@ -230,6 +317,17 @@ namespace NGT {
 	for (size_t i = 0; i < getDimension(); i++) {
 	  os << optr[i] << " ";
 	}
+      } else if (t == typeid(float16)) {
+	float16 *optr = reinterpret_cast<float16*>(&object.at(0,allocator));
+	for (size_t i = 0; i < getDimension(); i++) {
+	  os << optr[i] << " ";
+	}
+      } else if (t == typeid(qint8)) {
+	std::vector<float> v(getDimension());
+	quantizer->dequantize(reinterpret_cast<qint8*>(&object.at(0,allocator)), v.data());
+	for (size_t i = 0; i < getDimension(); i++) {
+	  os << v[i] << " ";
+	}
       } else {
 	os << " not implement for the type.";
       }
@@ -265,58 +363,94 @@ namespace NGT {
       }
       assert(ObjectSpace::dimension != 0);
       distanceType = t; 
+#if defined(NGT_RUNTIME_DISPATCH)
+      switch (CpuInfo::getSimdLevel()) {
+      case CpuInfo::SimdLevelAVX512:	comparator = newComparator<NGT::avx512::PrimitiveComparator>(); break;
+      case CpuInfo::SimdLevelAVX2:	comparator = newComparator<NGT::avx2::PrimitiveComparator>(); break;
+      default:				comparator = newComparator<NGT::PrimitiveComparator>(); break;
+      }
+#else
+      comparator = newComparator<NGT::PrimitiveComparator>();
+#endif
+      if ((distanceType == DistanceTypeNormalizedAngle || distanceType == DistanceTypeNormalizedCosine) && quantizer == 0) {
+	normalization = true;
+      }
+    }
+
+    template <typename PRIMITIVE_COMPARATOR>
+    Comparator *newComparator() {
+      return newComparator<PRIMITIVE_COMPARATOR>(static_cast<OBJECT_TYPE*>(0));
+    }
+
+    // the normalized distances of the scalar quantized objects are computed as the unnormalized ones.
+    template <typename PRIMITIVE_COMPARATOR>
+    Comparator *newComparator(qint8 *) {
+      switch (distanceType) {
+#ifdef NGT_SHARED_MEMORY_ALLOCATOR
+      case DistanceTypeL1:
+	return new ComparatorScalarQuantized<PRIMITIVE_COMPARATOR, DistanceTypeL1>(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator, *quantizer);
+      case DistanceTypeL2:
+	return new ComparatorScalarQuantized<PRIMITIVE_COMPARATOR, DistanceTypeL2>(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator, *quantizer);
+      case DistanceTypeAngle:
+      case DistanceTypeNormalizedAngle:
+	return new ComparatorScalarQuantized<PRIMITIVE_COMPARATOR, DistanceTypeAngle>(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator, *quantizer);
+      case DistanceTypeCosine:
+      case DistanceTypeNormalizedCosine:
+	return new ComparatorScalarQuantized<PRIMITIVE_COMPARATOR, DistanceTypeCosine>(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator, *quantizer);
+#else
+      case DistanceTypeL1:
+	return new ComparatorScalarQuantized<PRIMITIVE_COMPARATOR, DistanceTypeL1>(ObjectSpace::getPaddedDimension(), *quantizer);
+      case DistanceTypeL2:
+	return new ComparatorScalarQuantized<PRIMITIVE_COMPARATOR, DistanceTypeL2>(ObjectSpace::getPaddedDimension(), *quantizer);
+      case DistanceTypeAngle:
+      case DistanceTypeNormalizedAngle:
+	return new ComparatorScalarQuantized<PRIMITIVE_COMPARATOR, DistanceTypeAngle>(ObjectSpace::getPaddedDimension(), *quantizer);
+      case DistanceTypeCosine:
+      case DistanceTypeNormalizedCosine:
+	return new ComparatorScalarQuantized<PRIMITIVE_COMPARATOR, DistanceTypeCosine>(ObjectSpace::getPaddedDimension(), *quantizer);
+#endif
+      default:
+	std::stringstream msg;
+	msg << "ObjectSpace::newComparator: Not supported distance type for the scalar quantized objects. " << distanceType;
+	NGTThrowException(msg);
+      }
+    }
+
+    template <typename PRIMITIVE_COMPARATOR, typename T>
+    Comparator *newComparator(T *) {
       switch (distanceType) {
 #ifdef NGT_SHARED_MEMORY_ALLOCATOR
       case DistanceTypeL1:
-	comparator = new ObjectSpaceRepository::ComparatorL1(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
-	break;
+	return new ComparatorL1<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
       case DistanceTypeL2:
-	comparator = new ObjectSpaceRepository::ComparatorL2(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
-	break;
+	return new ComparatorL2<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
       case DistanceTypeHamming:
-	comparator = new ObjectSpaceRepository::ComparatorHammingDistance(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
-	break;
+	return new ComparatorHammingDistance<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
       case DistanceTypeAngle:
-	comparator = new ObjectSpaceRepository::ComparatorAngleDistance(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
-	break;
+	return new ComparatorAngleDistance<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
       case DistanceTypeCosine:
-	comparator = new ObjectSpaceRepository::ComparatorCosineSimilarity(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
-	break;
+	return new ComparatorCosineSimilarity<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
       case DistanceTypeNormalizedAngle:
-	comparator = new ObjectSpaceRepository::ComparatorNormalizedAngleDistance(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
-	normalization = true;
-	break;
+	return new ComparatorNormalizedAngleDistance<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
       case DistanceTypeNormalizedCosine:
-	comparator = new ObjectSpaceRepository::ComparatorNormalizedCosineSimilarity(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
-	normalization = true;
-	break;
+	return new ComparatorNormalizedCosineSimilarity<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension(), ObjectRepository::allocator);
 #else
       case DistanceTypeL1:
-	comparator = new ObjectSpaceRepository::ComparatorL1(ObjectSpace::getPaddedDimension());
-	break;
+	return new ComparatorL1<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension());
       case DistanceTypeL2:
-	comparator = new ObjectSpaceRepository::ComparatorL2(ObjectSpace::getPaddedDimension());
-	break;
+	return new ComparatorL2<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension());
       case DistanceTypeHamming:
-	comparator = new ObjectSpaceRepository::ComparatorHammingDistance(ObjectSpace::getPaddedDimension());
-	break;
+	return new ComparatorHammingDistance<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension());
       case DistanceTypeJaccard:
-	comparator = new ObjectSpaceRepository::ComparatorJaccardDistance(ObjectSpace::getPaddedDimension());
-	break;
+	return new ComparatorJaccardDistance<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension());
       case DistanceTypeAngle:
-	comparator = new ObjectSpaceRepository::ComparatorAngleDistance(ObjectSpace::getPaddedDimension());
-	break;
+	return new ComparatorAngleDistance<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension());
       case DistanceTypeCosine:
-	comparator = new ObjectSpaceRepository::ComparatorCosineSimilarity(ObjectSpace::getPaddedDimension());
-	break;
+	return new ComparatorCosineSimilarity<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension());
       case DistanceTypeNormalizedAngle:
-	comparator = new ObjectSpaceRepository::ComparatorNormalizedAngleDistance(ObjectSpace::getPaddedDimension());
-	normalization = true;
-	break;
+	return new ComparatorNormalizedAngleDistance<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension());
       case DistanceTypeNormalizedCosine:
-	comparator = new ObjectSpaceRepository::ComparatorNormalizedCosineSimilarity(ObjectSpace::getPaddedDimension());
-	normalization = true;
-	break;
+	return new ComparatorNormalizedCosineSimilarity<PRIMITIVE_COMPARATOR>(ObjectSpace::getPaddedDimension());
 #endif
       default:
 	std::cerr << "Distance type is not specified" << std::endl;
@@ -332,6 +466,8 @@ namespace NGT {
     void deserializeAsText(const std::string &ifile) { ObjectRepository::deserializeAsText(ifile, this); }
     void readText(std::istream &is, size_t dataSize) { ObjectRepository::readText(is, dataSize); }
     void appendText(std::istream &is, size_t dataSize) { ObjectRepository::appendText(is, dataSize); }
+    void readBinary(const std::string &file, size_t dataSize) { ObjectRepository::readBinary(file, dataSize); }
+    void appendBinary(const std::string &file, size_t dataSize) { ObjectRepository::appendBinary(file, dataSize); }
 
     void append(const float *data, size_t dataSize) { ObjectRepository::append(data, dataSize); }
     void append(const double *data, size_t dataSize) { ObjectRepository::append(data, dataSize); }
@@ -386,6 +522,9 @@ namespace NGT {
 
     void *getObject(size_t idx) {
       if (isEmpty(idx)) {
+	if (isInImage()) {
+	  NGTThrowException("NGT::ObjectSpaceRepository: The objects of the index image are not available.");
+	}
 	std::stringstream msg;
 	msg << "NGT::ObjectSpaceRepository: The specified ID is out of the range. The object ID should be greater than zero. " << idx << ":" << ObjectRepository::size() << ".";
 	NGTThrowException(msg);
@@ -402,11 +541,57 @@ namespace NGT {
       OBJECT_TYPE *obj = static_cast<OBJECT_TYPE*>(getObject(idx));
       size_t dim = getDimension();
       v.resize(dim);
+      convertToFloat(obj, v.data());
+    }
+
+    template <typename T>
+    void convertToFloat(const T *obj, float *v) {
+      size_t dim = getDimension();
       for (size_t i = 0; i < dim; i++) {
 	v[i] = static_cast<float>(obj[i]);
       }
     }
 
+    void convertToFloat(const qint8 *obj, float *v) {
+      quantizer->dequantize(obj, v);
+    }
+
+    void refine(Object &query, ObjectDistances &results, size_t size) {
+      if (quantizer == 0 || !quantizer->isKeepingOriginals()) {
+	return;
+      }
+#if defined(NGT_RUNTIME_DISPATCH)
+      switch (CpuInfo::getSimdLevel()) {
+      case CpuInfo::SimdLevelAVX512:	refine<NGT::avx512::PrimitiveComparator>(query, results); break;
+      case CpuInfo::SimdLevelAVX2:	refine<NGT::avx2::PrimitiveComparator>(query, results); break;
+      default:				refine<NGT::PrimitiveComparator>(query, results); break;
+      }
+#else
+      refine<NGT::PrimitiveComparator>(query, results);
+#endif
+      std::sort(results.begin(), results.end());
+      if (results.size() > size) {
+	results.resize(size);
+      }
+    }
+
+    template <typename PRIMITIVE_COMPARATOR>
+    void refine(Object &query, ObjectDistances &results) {
+      const float *q = quantizer->getOriginal(reinterpret_cast<qint8*>(&query[0]));
+      size_t dim = getPaddedDimension();
+      for (auto &r : results) {
+	const float *o = quantizer->getStoredOriginal(static_cast<qint8*>(getObject(r.id)));
+	switch (distanceType) {
+	case DistanceTypeL1:			r.distance = PRIMITIVE_COMPARATOR::L1Float::compare(q, o, dim); break;
+	case DistanceTypeAngle:
+	case DistanceTypeNormalizedAngle:	r.distance = PRIMITIVE_COMPARATOR::AngleFloat::compare(q, o, dim); break;
+	case DistanceTypeCosine:
+	case DistanceTypeNormalizedCosine:	r.distance = PRIMITIVE_COMPARATOR::CosineSimilarityFloat::compare(q, o, dim); break;
+	default:				r.distance = PRIMITIVE_COMPARATOR::L2Float::compare(q, o, dim); break;
+	}
+      }
+    }
+
     void getObjects(const std::vector<size_t> &idxs, std::vector<std::vector<float>> &vs) {
       vs.resize(idxs.size());
       auto v = vs.begin();
@@ -464,6 +649,12 @@ namespace NGT {
       }
       return allocatedObject;
     }
+    void setNormalizedObject(Object &object, const float *obj, size_t size) {
+      ObjectRepository::setObject(object, obj, size);
+      if (normalization) {
+	normalize(object);
+      }
+    }
 
     PersistentObject *allocateNormalizedPersistentObject(const std::vector<double> &obj) {
       PersistentObject *allocatedObject = ObjectRepository::allocatePersistentObject(obj);
@@ -489,6 +680,14 @@ namespace NGT {
       return allocatedObject;
     }
 
+    PersistentObject *allocateNormalizedPersistentObject(const float *obj, size_t size) {
+      PersistentObject *allocatedObject = ObjectRepository::allocatePersistentObject(obj, size);
+      if (normalization) {
+	normalize(*allocatedObject);
+      }
+      return allocatedObject;
+    }
+
     size_t getSize() { return ObjectRepository::size(); }
     size_t getSizeOfElement() { return sizeof(OBJECT_TYPE); }
     const std::type_info &getObjectType() { return typeid(OBJECT_TYPE); };
@@ -508,6 +707,17 @@ namespace NGT {
 	for (size_t i = 0; i < getDimension(); i++) {
 	  os << optr[i] << " ";
 	}
+      } else if (t == typeid(float16)) {
+	float16 *optr = reinterpret_cast<float16*>(&object[0]);
+	for (size_t i = 0; i < getDimension(); i++) {
+	  os << optr[i] << " ";
+	}
+      } else if (t == typeid(qint8)) {
+	std::vector<float> v(getDimension());
+	quantizer->dequantize(reinterpret_cast<qint8*>(&object[0]), v.data());
+	for (size_t i = 0; i < getDimension(); i++) {
+	  os << v[i] << " ";
+	}
       } else {
 	os << " not implement for the type.";
       }
@@ -539,6 +749,10 @@ namespace NGT {
       NGT::Serializer::writeAsText(os, (uint8_t*)ref, dimension); 
     } else if (t == typeid(float)) {
       NGT::Serializer::writeAsText(os, (float*)ref, dimension); 
+    } else if (t == typeid(float16)) {
+      NGT::Serializer::writeAsText(os, (float16*)ref, dimension); 
+    } else if (t == typeid(qint8)) {
+      NGT::Serializer::writeAsText(os, (uint8_t*)ref, objectspace->getByteSizeOfObject()); 
     } else if (t == typeid(double)) {
       NGT::Serializer::writeAsText(os, (double*)ref, dimension); 
     } else if (t == typeid(uint16_t)) {
@@ -562,6 +776,10 @@ namespace NGT {
       NGT::Serializer::readAsText(is, (uint8_t*)ref, dimension); 
     } else if (t == typeid(float)) {
       NGT::Serializer::readAsText(is, (float*)ref, dimension); 
+    } else if (t == typeid(float16)) {
+      NGT::Serializer::readAsText(is, (float16*)ref, dimension); 
+    } else if (t == typeid(qint8)) {
+      NGT::Serializer::readAsText(is, (uint8_t*)ref, objectspace->getByteSizeOfObject()); 
     } else if (t == typeid(double)) {
       NGT::Serializer::readAsText(is, (double*)ref, dimension); 
     } else if (t == typeid(uint16_t)) {
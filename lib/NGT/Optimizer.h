@@ -1013,6 +1013,33 @@ namespace NGT {
 	  os << std::endl;
 	}
 	break;
+      case NGT::ObjectSpace::ObjectType::Float16:
+	{
+	  auto *obj1 = static_cast<NGT::float16*>(index.getObjectSpace().getObject(id1));
+	  auto *obj2 = static_cast<NGT::float16*>(index.getObjectSpace().getObject(id2));
+	  for (int i = 0; i < prop.dimension; i++) {
+	    os << (*obj1++ + *obj2++) / 2.0F;
+	    if (i + 1 != prop.dimension) {
+	      os << "\t";
+	    }
+	  }
+	  os << std::endl;
+	}
+	break;
+      case NGT::ObjectSpace::ObjectType::Qint8:
+	{
+	  std::vector<float> obj1, obj2;
+	  index.getObjectSpace().getObject(id1, obj1);
+	  index.getObjectSpace().getObject(id2, obj2);
+	  for (int i = 0; i < prop.dimension; i++) {
+	    os << (obj1[i] + obj2[i]) / 2.0F;
+	    if (i + 1 != prop.dimension) {
+	      os << "\t";
+	    }
+	  }
+	  os << std::endl;
+	}
+	break;
       default:
       case NGT::ObjectSpace::ObjectType::Float:
 	{
@@ -17,8 +17,19 @@
 #pragma once
 
 #include	"NGT/defines.h"
+#include	"NGT/ScalarQuantizer.h"
+
+#include	<cstdlib>
+#include	<cstring>
+#include	<cerrno>
+#include	<iostream>
+#include	<unistd.h>
+#include	<sys/mman.h>
+#ifdef _OPENMP
+#include	<omp.h>
+#endif
 
-#if defined(NGT_NO_AVX)
+#if defined(NGT_NO_AVX) && !defined(NGT_RUNTIME_DISPATCH)
 #warning "*** SIMD is *NOT* available! ***"
 #else
 #include	<immintrin.h>
@@ -26,10 +37,55 @@
 
 namespace NGT {
 
+  class CpuInfo {
+  public:
+    enum SimdLevel {
+      SimdLevelNone	= 0,
+      SimdLevelAVX2	= 1,
+      SimdLevelAVX512	= 2
+    };
+
+    // The detected level can be lowered by the environment variable NGT_SIMD_LEVEL (none, avx2 or avx512).
+    static SimdLevel getSimdLevel() {
+      static const SimdLevel level = detectSimdLevel();
+      return level;
+    }
+
+    static const char *getSimdLevelName() {
+      switch (getSimdLevel()) {
+      case SimdLevelAVX512: return "avx512";
+      case SimdLevelAVX2: return "avx2";
+      default: return "none";
+      }
+    }
+
+  private:
+    static SimdLevel detectSimdLevel() {
+      SimdLevel level = SimdLevelNone;
+#if defined(NGT_RUNTIME_DISPATCH)
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+	level = SimdLevelAVX512;
+      } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c") && __builtin_cpu_supports("popcnt")) {
+	level = SimdLevelAVX2;
+      }
+      const char *limit = getenv("NGT_SIMD_LEVEL");
+      if (limit != 0) {
+	if (strcmp(limit, "none") == 0) {
+	  level = SimdLevelNone;
+	} else if (strcmp(limit, "avx2") == 0 && level > SimdLevelAVX2) {
+	  level = SimdLevelAVX2;
+	}
+      }
+#endif
+      return level;
+    }
+  };
+
   class MemoryCache {
   public:
     inline static void prefetch(unsigned char *ptr, const size_t byteSizeOfObject) {
-#if !defined(NGT_NO_AVX)
+#if !defined(NGT_NO_AVX) || defined(NGT_RUNTIME_DISPATCH)
       switch((byteSizeOfObject - 1) >> 6) {
       default:
       case 28: _mm_prefetch(ptr, _MM_HINT_T0); ptr += 64;
@@ -100,549 +156,72 @@ namespace NGT {
       delete[] p;
 #endif
     }
-  };
-
-  class PrimitiveComparator {
-  public:
-
-    static double absolute(double v) { return fabs(v); }
-    static int absolute(int v) { return abs(v); }
-
-#if defined(NGT_NO_AVX)
-    template <typename OBJECT_TYPE, typename COMPARE_TYPE> 
-    inline static double compareL2(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
-      const OBJECT_TYPE *last = a + size;
-      const OBJECT_TYPE *lastgroup = last - 3;
-      COMPARE_TYPE diff0, diff1, diff2, diff3;
-      double d = 0.0;
-      while (a < lastgroup) {
-	diff0 = (COMPARE_TYPE)(a[0] - b[0]);
-	diff1 = (COMPARE_TYPE)(a[1] - b[1]);
-	diff2 = (COMPARE_TYPE)(a[2] - b[2]);
-	diff3 = (COMPARE_TYPE)(a[3] - b[3]);
-	d += diff0 * diff0 + diff1 * diff1 + diff2 * diff2 + diff3 * diff3;
-	a += 4;
-	b += 4;
-      }
-      while (a < last) {
-	diff0 = (COMPARE_TYPE)(*a++ - *b++);
-	d += diff0 * diff0;
-      }
-      return sqrt((double)d);
-    }
-
-    inline static double compareL2(const uint8_t *a, const uint8_t *b, size_t size) {
-      return compareL2<uint8_t, int>(a, b, size);
-    }
-
-    inline static double compareL2(const float *a, const float *b, size_t size) {
-      return compareL2<float, double>(a, b, size);
-    }
-
-#else
-    inline static double compareL2(const float *a, const float *b, size_t size) {
-      const float *last = a + size;
-#if defined(NGT_AVX512)
-      __m512 sum512 = _mm512_setzero_ps();
-      while (a < last) {
-	__m512 v = _mm512_sub_ps(_mm512_loadu_ps(a), _mm512_loadu_ps(b));
-	sum512 = _mm512_add_ps(sum512, _mm512_mul_ps(v, v));
-	a += 16;
-	b += 16;
-      }
-
-      __m256 sum256 = _mm256_add_ps(_mm512_extractf32x8_ps(sum512, 0), _mm512_extractf32x8_ps(sum512, 1));
-      __m128 sum128 = _mm_add_ps(_mm256_extractf128_ps(sum256, 0), _mm256_extractf128_ps(sum256, 1));
-#elif defined(NGT_AVX2)
-      __m256 sum256 = _mm256_setzero_ps();
-      __m256 v;
-      while (a < last) {
-	v = _mm256_sub_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
-	sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(v, v));
-	a += 8;
-	b += 8;
-	v = _mm256_sub_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
-	sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(v, v));
-	a += 8;
-	b += 8;
-      }
-      __m128 sum128 = _mm_add_ps(_mm256_extractf128_ps(sum256, 0), _mm256_extractf128_ps(sum256, 1));
-#else
-      __m128 sum128 = _mm_setzero_ps();
-      __m128 v;
-      while (a < last) {
-	v = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
-	sum128 = _mm_add_ps(sum128, _mm_mul_ps(v, v));
-        a += 4;
-        b += 4;
-	v = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
-	sum128 = _mm_add_ps(sum128, _mm_mul_ps(v, v));
-        a += 4;
-        b += 4;
-	v = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
-	sum128 = _mm_add_ps(sum128, _mm_mul_ps(v, v));
-        a += 4;
-        b += 4;
-	v = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
-	sum128 = _mm_add_ps(sum128, _mm_mul_ps(v, v));
-        a += 4;
-        b += 4;
-      }
-#endif
-
-      __attribute__((aligned(32))) float f[4];
-      _mm_store_ps(f, sum128);
-
-      double s = f[0] + f[1] + f[2] + f[3];
-      return sqrt(s);
-    }
-
-    inline static double compareL2(const unsigned char *a, const unsigned char *b, size_t size) {
-      __m128 sum = _mm_setzero_ps();
-      const unsigned char *last = a + size;
-      const unsigned char *lastgroup = last - 7;
-      const __m128i zero = _mm_setzero_si128();
-      while (a < lastgroup) {
-	__m128i x1 = _mm_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)a));
-	__m128i x2 = _mm_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)b));
-	x1 = _mm_subs_epi16(x1, x2);
-	__m128i v = _mm_mullo_epi16(x1, x1);
-	sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)));
-	sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)));
-	a += 8;
-	b += 8;
-      }
-      __attribute__((aligned(32))) float f[4];
-      _mm_store_ps(f, sum);
-      double s = f[0] + f[1] + f[2] + f[3];
-      while (a < last) {
-	int d = (int)*a++ - (int)*b++;
-	s += d * d;
-      }
-      return sqrt(s);
-    }
-#endif
-#if defined(NGT_NO_AVX)
-    template <typename OBJECT_TYPE, typename COMPARE_TYPE> 
-    static double compareL1(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
-      const OBJECT_TYPE *last = a + size;
-      const OBJECT_TYPE *lastgroup = last - 3;
-      COMPARE_TYPE diff0, diff1, diff2, diff3;
-      double d = 0.0;
-      while (a < lastgroup) {
-	diff0 = (COMPARE_TYPE)(a[0] - b[0]);
-	diff1 = (COMPARE_TYPE)(a[1] - b[1]);
-	diff2 = (COMPARE_TYPE)(a[2] - b[2]);
-	diff3 = (COMPARE_TYPE)(a[3] - b[3]);
-	d += absolute(diff0) + absolute(diff1) + absolute(diff2) + absolute(diff3);
-	a += 4;
-	b += 4;
-      }
-      while (a < last) {
-	diff0 = (COMPARE_TYPE)*a++ - (COMPARE_TYPE)*b++;
-	d += absolute(diff0);
-      }
-      return d;
-    }
-
-    inline static double compareL1(const uint8_t *a, const uint8_t *b, size_t size) {
-      return compareL1<uint8_t, int>(a, b, size);
-    }
-
-    inline static double compareL1(const float *a, const float *b, size_t size) {
-      return compareL1<float, double>(a, b, size);
-    }
-
-#else
-    inline static double compareL1(const float *a, const float *b, size_t size) {
-      __m256 sum = _mm256_setzero_ps();
-      const float *last = a + size;
-      const float *lastgroup = last - 7;
-      while (a < lastgroup) {
-	__m256 x1 = _mm256_sub_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
-	const __m256 mask = _mm256_set1_ps(-0.0f);
-	__m256 v = _mm256_andnot_ps(mask, x1);
-	sum = _mm256_add_ps(sum, v);
-	a += 8;
-	b += 8;
-      }
-      __attribute__((aligned(32))) float f[8];
-      _mm256_store_ps(f, sum);
-      double s = f[0] + f[1] + f[2] + f[3] + f[4] + f[5] + f[6] + f[7];
-      while (a < last) {
-	double d = fabs(*a++ - *b++);
-	s += d;
-      }
-      return s;
-    }
-    inline static double compareL1(const unsigned char *a, const unsigned char *b, size_t size) {
-      __m128 sum = _mm_setzero_ps();
-      const unsigned char *last = a + size;
-      const unsigned char *lastgroup = last - 7;
-      const __m128i zero = _mm_setzero_si128();
-      while (a < lastgroup) {
-	__m128i x1 = _mm_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)a));
-	__m128i x2 = _mm_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)b));
-	x1 = _mm_subs_epi16(x1, x2);
-	x1 = _mm_sign_epi16(x1, x1);
-	sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_unpacklo_epi16(x1, zero)));
-	sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_unpackhi_epi16(x1, zero)));
-	a += 8;
-	b += 8;
-      }
-      __attribute__((aligned(32))) float f[4];
-      _mm_store_ps(f, sum);
-      double s = f[0] + f[1] + f[2] + f[3];
-      while (a < last) {
-	double d = fabs((double)*a++ - (double)*b++);
-	s += d;
-      }
-      return s;
-    }
-#endif
-
-#if defined(NGT_NO_AVX) || !defined(__POPCNT__)    
-    inline static double popCount(uint32_t x) {
-      x = (x & 0x55555555) + (x >> 1 & 0x55555555);
-      x = (x & 0x33333333) + (x >> 2 & 0x33333333);
-      x = (x & 0x0F0F0F0F) + (x >> 4 & 0x0F0F0F0F);
-      x = (x & 0x00FF00FF) + (x >> 8 & 0x00FF00FF);
-      x = (x & 0x0000FFFF) + (x >> 16 & 0x0000FFFF);
-      return x;
-    }
-
-    template <typename OBJECT_TYPE> 
-    inline static double compareHammingDistance(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
-      const uint32_t *last = reinterpret_cast<const uint32_t*>(a + size);
-      
-      const uint32_t *uinta = reinterpret_cast<const uint32_t*>(a);
-      const uint32_t *uintb = reinterpret_cast<const uint32_t*>(b);
-      size_t count = 0;
-      while( uinta < last ){
-	count += popCount(*uinta++ ^ *uintb++);
-      }
-
-      return static_cast<double>(count);
-    }
-#else
-    template <typename OBJECT_TYPE>
-      inline static double compareHammingDistance(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
-      const uint64_t *last = reinterpret_cast<const uint64_t*>(a + size);
-      
-      const uint64_t *uinta = reinterpret_cast<const uint64_t*>(a);
-      const uint64_t *uintb = reinterpret_cast<const uint64_t*>(b);
-      size_t count = 0;
-      while( uinta < last ){
-	count += _mm_popcnt_u64(*uinta++ ^ *uintb++);
-	count += _mm_popcnt_u64(*uinta++ ^ *uintb++);
-      }
-      
-      return static_cast<double>(count);
-    }
-#endif
-
-#if defined(NGT_NO_AVX) || !defined(__POPCNT__)    
-    template <typename OBJECT_TYPE>
-      inline static double compareJaccardDistance(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
-      const uint32_t *last = reinterpret_cast<const uint32_t*>(a + size);
-
-      const uint32_t *uinta = reinterpret_cast<const uint32_t*>(a);
-      const uint32_t *uintb = reinterpret_cast<const uint32_t*>(b);
-      size_t count = 0;
-      size_t countDe = 0;
-      while( uinta < last ){
-	count   += popCount(*uinta   & *uintb);
-	countDe += popCount(*uinta++ | *uintb++);
-	count   += popCount(*uinta   & *uintb);
-	countDe += popCount(*uinta++ | *uintb++);
-      }
-
-      return 1.0 - static_cast<double>(count) / static_cast<double>(countDe);
-    }
-#else
-    template <typename OBJECT_TYPE>
-      inline static double compareJaccardDistance(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
-      const uint64_t *last = reinterpret_cast<const uint64_t*>(a + size);
-
-      const uint64_t *uinta = reinterpret_cast<const uint64_t*>(a);
-      const uint64_t *uintb = reinterpret_cast<const uint64_t*>(b);
-      size_t count = 0;
-      size_t countDe = 0;
-      while( uinta < last ){
-	count   += _mm_popcnt_u64(*uinta   & *uintb);
-	countDe += _mm_popcnt_u64(*uinta++ | *uintb++);
-	count   += _mm_popcnt_u64(*uinta   & *uintb);
-	countDe += _mm_popcnt_u64(*uinta++ | *uintb++);
-      }
-
-      return 1.0 - static_cast<double>(count) / static_cast<double>(countDe);
-    }
-#endif
-
-#if defined(NGT_NO_AVX)
-   template <typename OBJECT_TYPE> 
-    inline static double compareDotProduct(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
-      double sum = 0.0;
-      for (size_t loc = 0; loc < size; loc++) {
-	sum += (double)a[loc] * (double)b[loc];
+    // gives the kernel the access pattern of a mapped region. the region is extended to the page boundary.
+    static void advise(const void *ptr, size_t size, int advice) {
+      if (ptr == 0 || size == 0) {
+	return;
       }
-      return sum;
-    }
-
-    template <typename OBJECT_TYPE> 
-    inline static double compareCosine(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
-      double normA = 0.0;
-      double normB = 0.0;
-      double sum = 0.0;
-      for (size_t loc = 0; loc < size; loc++) {
-	normA += (double)a[loc] * (double)a[loc];
-	normB += (double)b[loc] * (double)b[loc];
-	sum += (double)a[loc] * (double)b[loc];
+      uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+      uintptr_t begin = reinterpret_cast<uintptr_t>(ptr) & ~(pageSize - 1);
+      uintptr_t end = reinterpret_cast<uintptr_t>(ptr) + size;
+      if (madvise(reinterpret_cast<void*>(begin), end - begin, advice) != 0) {
+	std::cerr << "MemoryCache::advise: Warning. " << strerror(errno) << std::endl;
       }
-
-      double cosine = sum / sqrt(normA * normB);
-
-      return cosine;
     }
-#else
-    inline static double compareDotProduct(const float *a, const float *b, size_t size) {
-      const float *last = a + size;
-#if defined(NGT_AVX512)
-      __m512 sum512 = _mm512_setzero_ps();
-      while (a < last) {
-	sum512 = _mm512_add_ps(sum512, _mm512_mul_ps(_mm512_loadu_ps(a), _mm512_loadu_ps(b)));
-	a += 16;
-	b += 16;
+    // reads a byte of each page of a region in parallel so that the pages are faulted in before the search.
+    static size_t prefault(const void *ptr, size_t size, size_t threadSize = 0) {
+      if (ptr == 0 || size == 0) {
+	return 0;
       }
-
-      __m256 sum256 = _mm256_add_ps(_mm512_extractf32x8_ps(sum512, 0), _mm512_extractf32x8_ps(sum512, 1));
-      __m128 sum128 = _mm_add_ps(_mm256_extractf128_ps(sum256, 0), _mm256_extractf128_ps(sum256, 1));
-#elif defined(NGT_AVX2)
-      __m256 sum256 = _mm256_setzero_ps();
-      while (a < last) {
-	sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b)));
-	a += 8;
-	b += 8;
-      }
-      __m128 sum128 = _mm_add_ps(_mm256_extractf128_ps(sum256, 0), _mm256_extractf128_ps(sum256, 1));
-#else
-      __m128 sum128 = _mm_setzero_ps();
-      while (a < last) {
-	sum128 = _mm_add_ps(sum128, _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
-	a += 4;
-	b += 4;
+#ifdef _OPENMP
+      if (threadSize == 0) {
+	threadSize = omp_get_max_threads();
       }
 #endif
-      __attribute__((aligned(32))) float f[4];
-      _mm_store_ps(f, sum128);
-
-      double s = f[0] + f[1] + f[2] + f[3];
-      return s;
-    }
-
-    inline static double compareDotProduct(const unsigned char *a, const unsigned char *b, size_t size) {
-      double sum = 0.0;
-      for (size_t loc = 0; loc < size; loc++) {
-	sum += (double)a[loc] * (double)b[loc];
-      }
-      return sum;
-    }
-
-    inline static double compareCosine(const float *a, const float *b, size_t size) {
-
-      const float *last = a + size;
-#if defined(NGT_AVX512)
-      __m512 normA = _mm512_setzero_ps();
-      __m512 normB = _mm512_setzero_ps();
-      __m512 sum = _mm512_setzero_ps();
-      while (a < last) {
-	__m512 am = _mm512_loadu_ps(a);
-	__m512 bm = _mm512_loadu_ps(b);
-	normA = _mm512_add_ps(normA, _mm512_mul_ps(am, am));
-	normB = _mm512_add_ps(normB, _mm512_mul_ps(bm, bm));
-	sum = _mm512_add_ps(sum, _mm512_mul_ps(am, bm));
-	a += 16;
-	b += 16;
-      }
-      __m256 am256 = _mm256_add_ps(_mm512_extractf32x8_ps(normA, 0), _mm512_extractf32x8_ps(normA, 1));
-      __m256 bm256 = _mm256_add_ps(_mm512_extractf32x8_ps(normB, 0), _mm512_extractf32x8_ps(normB, 1));
-      __m256 s256 = _mm256_add_ps(_mm512_extractf32x8_ps(sum, 0), _mm512_extractf32x8_ps(sum, 1));
-      __m128 am128 = _mm_add_ps(_mm256_extractf128_ps(am256, 0), _mm256_extractf128_ps(am256, 1));
-      __m128 bm128 = _mm_add_ps(_mm256_extractf128_ps(bm256, 0), _mm256_extractf128_ps(bm256, 1));
-      __m128 s128 = _mm_add_ps(_mm256_extractf128_ps(s256, 0), _mm256_extractf128_ps(s256, 1));
-#elif defined(NGT_AVX2)
-      __m256 normA = _mm256_setzero_ps();
-      __m256 normB = _mm256_setzero_ps();
-      __m256 sum = _mm256_setzero_ps();
-      __m256 am, bm;
-      while (a < last) {
-	am = _mm256_loadu_ps(a);
-	bm = _mm256_loadu_ps(b);
-	normA = _mm256_add_ps(normA, _mm256_mul_ps(am, am));
-	normB = _mm256_add_ps(normB, _mm256_mul_ps(bm, bm));
-	sum = _mm256_add_ps(sum, _mm256_mul_ps(am, bm));
-	a += 8;
-	b += 8;
-      }
-      __m128 am128 = _mm_add_ps(_mm256_extractf128_ps(normA, 0), _mm256_extractf128_ps(normA, 1));
-      __m128 bm128 = _mm_add_ps(_mm256_extractf128_ps(normB, 0), _mm256_extractf128_ps(normB, 1));
-      __m128 s128 = _mm_add_ps(_mm256_extractf128_ps(sum, 0), _mm256_extractf128_ps(sum, 1));
-#else
-      __m128 am128 = _mm_setzero_ps();
-      __m128 bm128 = _mm_setzero_ps();
-      __m128 s128 = _mm_setzero_ps();
-      __m128 am, bm;
-      while (a < last) {
-	am = _mm_loadu_ps(a);
-	bm = _mm_loadu_ps(b);
-	am128 = _mm_add_ps(am128, _mm_mul_ps(am, am));
-	bm128 = _mm_add_ps(bm128, _mm_mul_ps(bm, bm));
-	s128 = _mm_add_ps(s128, _mm_mul_ps(am, bm));
-	a += 4;
-	b += 4;
-      }
-
+      threadSize = threadSize == 0 ? 1 : threadSize;
+      const size_t pageSize = sysconf(_SC_PAGESIZE);
+      const volatile uint8_t *p = static_cast<const volatile uint8_t*>(ptr);
+      const int64_t pages = (size + pageSize - 1) / pageSize;
+      uint8_t sum = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:sum) num_threads(threadSize)
 #endif
-
-      __attribute__((aligned(32))) float f[4];
-      _mm_store_ps(f, am128);
-      double na = f[0] + f[1] + f[2] + f[3];
-      _mm_store_ps(f, bm128);
-      double nb = f[0] + f[1] + f[2] + f[3];
-      _mm_store_ps(f, s128);
-      double s = f[0] + f[1] + f[2] + f[3];
-
-      double cosine = s / sqrt(na * nb);
-      return cosine;
-    }
-
-    inline static double compareCosine(const unsigned char *a, const unsigned char *b, size_t size) {
-      double normA = 0.0;
-      double normB = 0.0;
-      double sum = 0.0;
-      for (size_t loc = 0; loc < size; loc++) {
-	normA += (double)a[loc] * (double)a[loc];
-	normB += (double)b[loc] * (double)b[loc];
-	sum += (double)a[loc] * (double)b[loc];
-      }
-
-      double cosine = sum / sqrt(normA * normB);
-
-      return cosine;
-    }
-#endif    // #if defined(NGT_NO_AVX)
-
-    template <typename OBJECT_TYPE> 
-    inline static double compareAngleDistance(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
-      double cosine = compareCosine(a, b, size);
-      if (cosine >= 1.0) {
-	return 0.0;
-      } else if (cosine <= -1.0) {
-	return acos(-1.0);
-      } else {
-	return acos(cosine);
-      }
-    }
-
-    template <typename OBJECT_TYPE> 
-    inline static double compareNormalizedAngleDistance(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
-      double cosine = compareDotProduct(a, b, size);
-      if (cosine >= 1.0) {
-	return 0.0;
-      } else if (cosine <= -1.0) {
-	return acos(-1.0);
-      } else {
-	return acos(cosine);
+      for (int64_t i = 0; i < pages; i++) {
+	sum += p[i * pageSize];
       }
+      (void)sum;
+      return pages;
     }
+  };
 
-    template <typename OBJECT_TYPE> 
-    inline static double compareCosineSimilarity(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
-      return 1.0 - compareCosine(a, b, size);
-    }
-
-    template <typename OBJECT_TYPE> 
-    inline static double compareNormalizedCosineSimilarity(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
-      double v = 1.0 - compareDotProduct(a, b, size);
-      return v < 0.0 ? 0.0 : v;
-    }
-
-    class L1Uint8 {
-    public:
-      inline static double compare(const void *a, const void *b, size_t size) {
-	return PrimitiveComparator::compareL1((const uint8_t*)a, (const uint8_t*)b, size);
-      }
-    };
-
-    class L2Uint8 {
-    public:
-      inline static double compare(const void *a, const void *b, size_t size) {
-	return PrimitiveComparator::compareL2((const uint8_t*)a, (const uint8_t*)b, size);
-      }
-    };
-
-    class HammingUint8 {
-    public:
-      inline static double compare(const void *a, const void *b, size_t size) {
-	return PrimitiveComparator::compareHammingDistance((const uint8_t*)a, (const uint8_t*)b, size);
-      }
-    };
-
-    class JaccardUint8 {
-    public:
-      inline static double compare(const void *a, const void *b, size_t size) {
-	return PrimitiveComparator::compareJaccardDistance((const uint8_t*)a, (const uint8_t*)b, size);
-      }
-    };
-
-    class L2Float {
-    public:
-      inline static double compare(const void *a, const void *b, size_t size) {
-#if defined(NGT_NO_AVX)
-	return PrimitiveComparator::compareL2<float, double>((const float*)a, (const float*)b, size);
-#else
-	return PrimitiveComparator::compareL2((const float*)a, (const float*)b, size);
+#include	"NGT/PrimitiveComparatorImpl.h"
+
+#if defined(NGT_RUNTIME_DISPATCH)
+  // The kernels are also compiled for AVX2 and AVX512 so that a portable build can select them at runtime.
+#pragma push_macro("NGT_AVX512")
+#pragma push_macro("NGT_AVX2")
+#pragma push_macro("NGT_NO_AVX")
+#undef NGT_AVX512
+#undef NGT_NO_AVX
+#define NGT_AVX2
+#pragma GCC push_options
+#pragma GCC target("avx2,f16c,popcnt")
+  namespace avx2 {
+#include	"NGT/PrimitiveComparatorImpl.h"
+  }
+#pragma GCC pop_options
+#undef NGT_AVX2
+#define NGT_AVX512
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512dq,avx2,f16c,popcnt")
+  namespace avx512 {
+#include	"NGT/PrimitiveComparatorImpl.h"
+  }
+#pragma GCC pop_options
+#pragma pop_macro("NGT_NO_AVX")
+#pragma pop_macro("NGT_AVX2")
+#pragma pop_macro("NGT_AVX512")
 #endif
-      }
-    };
-
-    class L1Float {
-    public:
-      inline static double compare(const void *a, const void *b, size_t size) {
-	return PrimitiveComparator::compareL1((const float*)a, (const float*)b, size);
-      }
-    };
-
-    class CosineSimilarityFloat {
-    public:
-      inline static double compare(const void *a, const void *b, size_t size) {
-	return PrimitiveComparator::compareCosineSimilarity((const float*)a, (const float*)b, size);
-      }
-    };
-
-    class AngleFloat {
-    public:
-      inline static double compare(const void *a, const void *b, size_t size) {
-	return PrimitiveComparator::compareAngleDistance((const float*)a, (const float*)b, size);
-      }
-    };
-
-    class NormalizedCosineSimilarityFloat {
-    public:
-      inline static double compare(const void *a, const void *b, size_t size) {
-	return PrimitiveComparator::compareNormalizedCosineSimilarity((const float*)a, (const float*)b, size);
-      }
-    };
-
-    class NormalizedAngleFloat {
-    public:
-      inline static double compare(const void *a, const void *b, size_t size) {
-	return PrimitiveComparator::compareNormalizedAngleDistance((const float*)a, (const float*)b, size);
-      }
-    };
-
-};
-
 
 } // namespace NGT
 
@@ -0,0 +1,1129 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// This file is included by PrimitiveComparator.h once for each SIMD instruction set.
+// Do not include it directly.
+
+  class PrimitiveComparator {
+  public:
+
+    static double absolute(double v) { return fabs(v); }
+    static int absolute(int v) { return abs(v); }
+
+#if defined(NGT_NO_AVX)
+    template <typename OBJECT_TYPE, typename COMPARE_TYPE> 
+    inline static double compareL2(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
+      const OBJECT_TYPE *last = a + size;
+      const OBJECT_TYPE *lastgroup = last - 3;
+      COMPARE_TYPE diff0, diff1, diff2, diff3;
+      double d = 0.0;
+      while (a < lastgroup) {
+	diff0 = (COMPARE_TYPE)(a[0] - b[0]);
+	diff1 = (COMPARE_TYPE)(a[1] - b[1]);
+	diff2 = (COMPARE_TYPE)(a[2] - b[2]);
+	diff3 = (COMPARE_TYPE)(a[3] - b[3]);
+	d += diff0 * diff0 + diff1 * diff1 + diff2 * diff2 + diff3 * diff3;
+	a += 4;
+	b += 4;
+      }
+      while (a < last) {
+	diff0 = (COMPARE_TYPE)(*a++ - *b++);
+	d += diff0 * diff0;
+      }
+      return sqrt((double)d);
+    }
+
+    inline static double compareL2(const uint8_t *a, const uint8_t *b, size_t size) {
+      return compareL2<uint8_t, int>(a, b, size);
+    }
+
+    inline static double compareL2(const float *a, const float *b, size_t size) {
+      return compareL2<float, double>(a, b, size);
+    }
+
+#else
+    inline static double compareL2(const float *a, const float *b, size_t size) {
+      const float *last = a + size;
+#if defined(NGT_AVX512)
+      __m512 sum512 = _mm512_setzero_ps();
+      while (a < last) {
+	__m512 v = _mm512_sub_ps(_mm512_loadu_ps(a), _mm512_loadu_ps(b));
+	sum512 = _mm512_add_ps(sum512, _mm512_mul_ps(v, v));
+	a += 16;
+	b += 16;
+      }
+
+      __m256 sum256 = _mm256_add_ps(_mm512_extractf32x8_ps(sum512, 0), _mm512_extractf32x8_ps(sum512, 1));
+      __m128 sum128 = _mm_add_ps(_mm256_extractf128_ps(sum256, 0), _mm256_extractf128_ps(sum256, 1));
+#elif defined(NGT_AVX2)
+      __m256 sum256 = _mm256_setzero_ps();
+      __m256 v;
+      while (a < last) {
+	v = _mm256_sub_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
+	sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(v, v));
+	a += 8;
+	b += 8;
+	v = _mm256_sub_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
+	sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(v, v));
+	a += 8;
+	b += 8;
+      }
+      __m128 sum128 = _mm_add_ps(_mm256_extractf128_ps(sum256, 0), _mm256_extractf128_ps(sum256, 1));
+#else
+      __m128 sum128 = _mm_setzero_ps();
+      __m128 v;
+      while (a < last) {
+	v = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+	sum128 = _mm_add_ps(sum128, _mm_mul_ps(v, v));
+        a += 4;
+        b += 4;
+	v = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+	sum128 = _mm_add_ps(sum128, _mm_mul_ps(v, v));
+        a += 4;
+        b += 4;
+	v = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+	sum128 = _mm_add_ps(sum128, _mm_mul_ps(v, v));
+        a += 4;
+        b += 4;
+	v = _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+	sum128 = _mm_add_ps(sum128, _mm_mul_ps(v, v));
+        a += 4;
+        b += 4;
+      }
+#endif
+
+      __attribute__((aligned(32))) float f[4];
+      _mm_store_ps(f, sum128);
+
+      double s = f[0] + f[1] + f[2] + f[3];
+      return sqrt(s);
+    }
+
+    inline static double compareL2(const unsigned char *a, const unsigned char *b, size_t size) {
+      __m128 sum = _mm_setzero_ps();
+      const unsigned char *last = a + size;
+      const unsigned char *lastgroup = last - 7;
+      const __m128i zero = _mm_setzero_si128();
+      while (a < lastgroup) {
+	__m128i x1 = _mm_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)a));
+	__m128i x2 = _mm_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)b));
+	x1 = _mm_subs_epi16(x1, x2);
+	__m128i v = _mm_mullo_epi16(x1, x1);
+	sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)));
+	sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)));
+	a += 8;
+	b += 8;
+      }
+      __attribute__((aligned(32))) float f[4];
+      _mm_store_ps(f, sum);
+      double s = f[0] + f[1] + f[2] + f[3];
+      while (a < last) {
+	int d = (int)*a++ - (int)*b++;
+	s += d * d;
+      }
+      return sqrt(s);
+    }
+#endif
+#if defined(NGT_NO_AVX)
+    template <typename OBJECT_TYPE, typename COMPARE_TYPE> 
+    static double compareL1(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
+      const OBJECT_TYPE *last = a + size;
+      const OBJECT_TYPE *lastgroup = last - 3;
+      COMPARE_TYPE diff0, diff1, diff2, diff3;
+      double d = 0.0;
+      while (a < lastgroup) {
+	diff0 = (COMPARE_TYPE)(a[0] - b[0]);
+	diff1 = (COMPARE_TYPE)(a[1] - b[1]);
+	diff2 = (COMPARE_TYPE)(a[2] - b[2]);
+	diff3 = (COMPARE_TYPE)(a[3] - b[3]);
+	d += absolute(diff0) + absolute(diff1) + absolute(diff2) + absolute(diff3);
+	a += 4;
+	b += 4;
+      }
+      while (a < last) {
+	diff0 = (COMPARE_TYPE)*a++ - (COMPARE_TYPE)*b++;
+	d += absolute(diff0);
+      }
+      return d;
+    }
+
+    inline static double compareL1(const uint8_t *a, const uint8_t *b, size_t size) {
+      return compareL1<uint8_t, int>(a, b, size);
+    }
+
+    inline static double compareL1(const float *a, const float *b, size_t size) {
+      return compareL1<float, double>(a, b, size);
+    }
+
+#else
+    inline static double compareL1(const float *a, const float *b, size_t size) {
+      __m256 sum = _mm256_setzero_ps();
+      const float *last = a + size;
+      const float *lastgroup = last - 7;
+      while (a < lastgroup) {
+	__m256 x1 = _mm256_sub_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
+	const __m256 mask = _mm256_set1_ps(-0.0f);
+	__m256 v = _mm256_andnot_ps(mask, x1);
+	sum = _mm256_add_ps(sum, v);
+	a += 8;
+	b += 8;
+      }
+      __attribute__((aligned(32))) float f[8];
+      _mm256_store_ps(f, sum);
+      double s = f[0] + f[1] + f[2] + f[3] + f[4] + f[5] + f[6] + f[7];
+      while (a < last) {
+	double d = fabs(*a++ - *b++);
+	s += d;
+      }
+      return s;
+    }
+    inline static double compareL1(const unsigned char *a, const unsigned char *b, size_t size) {
+      __m128 sum = _mm_setzero_ps();
+      const unsigned char *last = a + size;
+      const unsigned char *lastgroup = last - 7;
+      const __m128i zero = _mm_setzero_si128();
+      while (a < lastgroup) {
+	__m128i x1 = _mm_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)a));
+	__m128i x2 = _mm_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)b));
+	x1 = _mm_subs_epi16(x1, x2);
+	x1 = _mm_sign_epi16(x1, x1);
+	sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_unpacklo_epi16(x1, zero)));
+	sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_unpackhi_epi16(x1, zero)));
+	a += 8;
+	b += 8;
+      }
+      __attribute__((aligned(32))) float f[4];
+      _mm_store_ps(f, sum);
+      double s = f[0] + f[1] + f[2] + f[3];
+      while (a < last) {
+	double d = fabs((double)*a++ - (double)*b++);
+	s += d;
+      }
+      return s;
+    }
+#endif
+
+#if defined(NGT_NO_AVX) || !defined(__POPCNT__)    
+    inline static double popCount(uint32_t x) {
+      x = (x & 0x55555555) + (x >> 1 & 0x55555555);
+      x = (x & 0x33333333) + (x >> 2 & 0x33333333);
+      x = (x & 0x0F0F0F0F) + (x >> 4 & 0x0F0F0F0F);
+      x = (x & 0x00FF00FF) + (x >> 8 & 0x00FF00FF);
+      x = (x & 0x0000FFFF) + (x >> 16 & 0x0000FFFF);
+      return x;
+    }
+
+    template <typename OBJECT_TYPE> 
+    inline static double compareHammingDistance(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
+      const uint32_t *last = reinterpret_cast<const uint32_t*>(a + size);
+      
+      const uint32_t *uinta = reinterpret_cast<const uint32_t*>(a);
+      const uint32_t *uintb = reinterpret_cast<const uint32_t*>(b);
+      size_t count = 0;
+      while( uinta < last ){
+	count += popCount(*uinta++ ^ *uintb++);
+      }
+
+      return static_cast<double>(count);
+    }
+#else
+    template <typename OBJECT_TYPE>
+      inline static double compareHammingDistance(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
+      const uint64_t *last = reinterpret_cast<const uint64_t*>(a + size);
+      
+      const uint64_t *uinta = reinterpret_cast<const uint64_t*>(a);
+      const uint64_t *uintb = reinterpret_cast<const uint64_t*>(b);
+      size_t count = 0;
+      while( uinta < last ){
+	count += _mm_popcnt_u64(*uinta++ ^ *uintb++);
+	count += _mm_popcnt_u64(*uinta++ ^ *uintb++);
+      }
+      
+      return static_cast<double>(count);
+    }
+#endif
+
+#if defined(NGT_NO_AVX) || !defined(__POPCNT__)    
+    template <typename OBJECT_TYPE>
+      inline static double compareJaccardDistance(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
+      const uint32_t *last = reinterpret_cast<const uint32_t*>(a + size);
+
+      const uint32_t *uinta = reinterpret_cast<const uint32_t*>(a);
+      const uint32_t *uintb = reinterpret_cast<const uint32_t*>(b);
+      size_t count = 0;
+      size_t countDe = 0;
+      while( uinta < last ){
+	count   += popCount(*uinta   & *uintb);
+	countDe += popCount(*uinta++ | *uintb++);
+	count   += popCount(*uinta   & *uintb);
+	countDe += popCount(*uinta++ | *uintb++);
+      }
+
+      return 1.0 - static_cast<double>(count) / static_cast<double>(countDe);
+    }
+#else
+    template <typename OBJECT_TYPE>
+      inline static double compareJaccardDistance(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
+      const uint64_t *last = reinterpret_cast<const uint64_t*>(a + size);
+
+      const uint64_t *uinta = reinterpret_cast<const uint64_t*>(a);
+      const uint64_t *uintb = reinterpret_cast<const uint64_t*>(b);
+      size_t count = 0;
+      size_t countDe = 0;
+      while( uinta < last ){
+	count   += _mm_popcnt_u64(*uinta   & *uintb);
+	countDe += _mm_popcnt_u64(*uinta++ | *uintb++);
+	count   += _mm_popcnt_u64(*uinta   & *uintb);
+	countDe += _mm_popcnt_u64(*uinta++ | *uintb++);
+      }
+
+      return 1.0 - static_cast<double>(count) / static_cast<double>(countDe);
+    }
+#endif
+
+#if defined(NGT_NO_AVX)
+   template <typename OBJECT_TYPE> 
+    inline static double compareDotProduct(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
+      double sum = 0.0;
+      for (size_t loc = 0; loc < size; loc++) {
+	sum += (double)a[loc] * (double)b[loc];
+      }
+      return sum;
+    }
+
+    template <typename OBJECT_TYPE> 
+    inline static double compareCosine(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
+      double normA = 0.0;
+      double normB = 0.0;
+      double sum = 0.0;
+      for (size_t loc = 0; loc < size; loc++) {
+	normA += (double)a[loc] * (double)a[loc];
+	normB += (double)b[loc] * (double)b[loc];
+	sum += (double)a[loc] * (double)b[loc];
+      }
+
+      double cosine = sum / sqrt(normA * normB);
+
+      return cosine;
+    }
+#else
+    inline static double compareDotProduct(const float *a, const float *b, size_t size) {
+      const float *last = a + size;
+#if defined(NGT_AVX512)
+      __m512 sum512 = _mm512_setzero_ps();
+      while (a < last) {
+	sum512 = _mm512_add_ps(sum512, _mm512_mul_ps(_mm512_loadu_ps(a), _mm512_loadu_ps(b)));
+	a += 16;
+	b += 16;
+      }
+
+      __m256 sum256 = _mm256_add_ps(_mm512_extractf32x8_ps(sum512, 0), _mm512_extractf32x8_ps(sum512, 1));
+      __m128 sum128 = _mm_add_ps(_mm256_extractf128_ps(sum256, 0), _mm256_extractf128_ps(sum256, 1));
+#elif defined(NGT_AVX2)
+      __m256 sum256 = _mm256_setzero_ps();
+      while (a < last) {
+	sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b)));
+	a += 8;
+	b += 8;
+      }
+      __m128 sum128 = _mm_add_ps(_mm256_extractf128_ps(sum256, 0), _mm256_extractf128_ps(sum256, 1));
+#else
+      __m128 sum128 = _mm_setzero_ps();
+      while (a < last) {
+	sum128 = _mm_add_ps(sum128, _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+	a += 4;
+	b += 4;
+      }
+#endif
+      __attribute__((aligned(32))) float f[4];
+      _mm_store_ps(f, sum128);
+
+      double s = f[0] + f[1] + f[2] + f[3];
+      return s;
+    }
+
+    inline static double compareDotProduct(const unsigned char *a, const unsigned char *b, size_t size) {
+      double sum = 0.0;
+      for (size_t loc = 0; loc < size; loc++) {
+	sum += (double)a[loc] * (double)b[loc];
+      }
+      return sum;
+    }
+
+    inline static double compareCosine(const float *a, const float *b, size_t size) {
+
+      const float *last = a + size;
+#if defined(NGT_AVX512)
+      __m512 normA = _mm512_setzero_ps();
+      __m512 normB = _mm512_setzero_ps();
+      __m512 sum = _mm512_setzero_ps();
+      while (a < last) {
+	__m512 am = _mm512_loadu_ps(a);
+	__m512 bm = _mm512_loadu_ps(b);
+	normA = _mm512_add_ps(normA, _mm512_mul_ps(am, am));
+	normB = _mm512_add_ps(normB, _mm512_mul_ps(bm, bm));
+	sum = _mm512_add_ps(sum, _mm512_mul_ps(am, bm));
+	a += 16;
+	b += 16;
+      }
+      __m256 am256 = _mm256_add_ps(_mm512_extractf32x8_ps(normA, 0), _mm512_extractf32x8_ps(normA, 1));
+      __m256 bm256 = _mm256_add_ps(_mm512_extractf32x8_ps(normB, 0), _mm512_extractf32x8_ps(normB, 1));
+      __m256 s256 = _mm256_add_ps(_mm512_extractf32x8_ps(sum, 0), _mm512_extractf32x8_ps(sum, 1));
+      __m128 am128 = _mm_add_ps(_mm256_extractf128_ps(am256, 0), _mm256_extractf128_ps(am256, 1));
+      __m128 bm128 = _mm_add_ps(_mm256_extractf128_ps(bm256, 0), _mm256_extractf128_ps(bm256, 1));
+      __m128 s128 = _mm_add_ps(_mm256_extractf128_ps(s256, 0), _mm256_extractf128_ps(s256, 1));
+#elif defined(NGT_AVX2)
+      __m256 normA = _mm256_setzero_ps();
+      __m256 normB = _mm256_setzero_ps();
+      __m256 sum = _mm256_setzero_ps();
+      __m256 am, bm;
+      while (a < last) {
+	am = _mm256_loadu_ps(a);
+	bm = _mm256_loadu_ps(b);
+	normA = _mm256_add_ps(normA, _mm256_mul_ps(am, am));
+	normB = _mm256_add_ps(normB, _mm256_mul_ps(bm, bm));
+	sum = _mm256_add_ps(sum, _mm256_mul_ps(am, bm));
+	a += 8;
+	b += 8;
+      }
+      __m128 am128 = _mm_add_ps(_mm256_extractf128_ps(normA, 0), _mm256_extractf128_ps(normA, 1));
+      __m128 bm128 = _mm_add_ps(_mm256_extractf128_ps(normB, 0), _mm256_extractf128_ps(normB, 1));
+      __m128 s128 = _mm_add_ps(_mm256_extractf128_ps(sum, 0), _mm256_extractf128_ps(sum, 1));
+#else
+      __m128 am128 = _mm_setzero_ps();
+      __m128 bm128 = _mm_setzero_ps();
+      __m128 s128 = _mm_setzero_ps();
+      __m128 am, bm;
+      while (a < last) {
+	am = _mm_loadu_ps(a);
+	bm = _mm_loadu_ps(b);
+	am128 = _mm_add_ps(am128, _mm_mul_ps(am, am));
+	bm128 = _mm_add_ps(bm128, _mm_mul_ps(bm, bm));
+	s128 = _mm_add_ps(s128, _mm_mul_ps(am, bm));
+	a += 4;
+	b += 4;
+      }
+
+#endif
+
+      __attribute__((aligned(32))) float f[4];
+      _mm_store_ps(f, am128);
+      double na = f[0] + f[1] + f[2] + f[3];
+      _mm_store_ps(f, bm128);
+      double nb = f[0] + f[1] + f[2] + f[3];
+      _mm_store_ps(f, s128);
+      double s = f[0] + f[1] + f[2] + f[3];
+
+      double cosine = s / sqrt(na * nb);
+      return cosine;
+    }
+
+    inline static double compareCosine(const unsigned char *a, const unsigned char *b, size_t size) {
+      double normA = 0.0;
+      double normB = 0.0;
+      double sum = 0.0;
+      for (size_t loc = 0; loc < size; loc++) {
+	normA += (double)a[loc] * (double)a[loc];
+	normB += (double)b[loc] * (double)b[loc];
+	sum += (double)a[loc] * (double)b[loc];
+      }
+
+      double cosine = sum / sqrt(normA * normB);
+
+      return cosine;
+    }
+#endif    // #if defined(NGT_NO_AVX)
+
+    // The following kernels are specialized for padded dimensions which are multiples of 32.
+    // The loops are fully unrolled and the partial sums are kept in independent registers.
+#if defined(NGT_NO_AVX)
+    template <size_t DIMENSION>
+    inline static double compareL2(const float *a, const float *b) {
+      return compareL2<float, double>(a, b, DIMENSION);
+    }
+
+    template <size_t DIMENSION>
+    inline static double compareL1(const float *a, const float *b) {
+      return compareL1<float, double>(a, b, DIMENSION);
+    }
+
+    template <size_t DIMENSION>
+    inline static double compareDotProduct(const float *a, const float *b) {
+      return compareDotProduct(a, b, DIMENSION);
+    }
+
+    template <size_t DIMENSION>
+    inline static double compareCosine(const float *a, const float *b) {
+      return compareCosine(a, b, DIMENSION);
+    }
+#else
+    inline static double sum(__m128 v) {
+      __attribute__((aligned(32))) float f[4];
+      _mm_store_ps(f, v);
+      return (double)f[0] + f[1] + f[2] + f[3];
+    }
+
+#if defined(NGT_AVX512)
+    inline static __m128 reduce(__m512 v) {
+      __m256 v256 = _mm256_add_ps(_mm512_extractf32x8_ps(v, 0), _mm512_extractf32x8_ps(v, 1));
+      return _mm_add_ps(_mm256_extractf128_ps(v256, 0), _mm256_extractf128_ps(v256, 1));
+    }
+#endif
+
+    inline static __m128 reduce(__m256 v) {
+      return _mm_add_ps(_mm256_extractf128_ps(v, 0), _mm256_extractf128_ps(v, 1));
+    }
+
+    template <size_t DIMENSION>
+    inline static double compareL2(const float *a, const float *b) {
+#if defined(NGT_AVX512)
+      __m512 sum0 = _mm512_setzero_ps();
+      __m512 sum1 = _mm512_setzero_ps();
+#pragma GCC unroll 32
+      for (size_t i = 0; i < DIMENSION; i += 32) {
+	__m512 v0 = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+	__m512 v1 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16));
+	sum0 = _mm512_add_ps(sum0, _mm512_mul_ps(v0, v0));
+	sum1 = _mm512_add_ps(sum1, _mm512_mul_ps(v1, v1));
+      }
+      return sqrt(sum(reduce(_mm512_add_ps(sum0, sum1))));
+#elif defined(NGT_AVX2)
+      __m256 sum0 = _mm256_setzero_ps();
+      __m256 sum1 = _mm256_setzero_ps();
+      __m256 sum2 = _mm256_setzero_ps();
+      __m256 sum3 = _mm256_setzero_ps();
+#pragma GCC unroll 32
+      for (size_t i = 0; i < DIMENSION; i += 32) {
+	__m256 v0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+	__m256 v1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+	__m256 v2 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16));
+	__m256 v3 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24));
+	sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(v0, v0));
+	sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(v1, v1));
+	sum2 = _mm256_add_ps(sum2, _mm256_mul_ps(v2, v2));
+	sum3 = _mm256_add_ps(sum3, _mm256_mul_ps(v3, v3));
+      }
+      return sqrt(sum(reduce(_mm256_add_ps(_mm256_add_ps(sum0, sum1), _mm256_add_ps(sum2, sum3)))));
+#else
+      __m128 sum0 = _mm_setzero_ps();
+      __m128 sum1 = _mm_setzero_ps();
+      __m128 sum2 = _mm_setzero_ps();
+      __m128 sum3 = _mm_setzero_ps();
+#pragma GCC unroll 64
+      for (size_t i = 0; i < DIMENSION; i += 16) {
+	__m128 v0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+	__m128 v1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+	__m128 v2 = _mm_sub_ps(_mm_loadu_ps(a + i + 8), _mm_loadu_ps(b + i + 8));
+	__m128 v3 = _mm_sub_ps(_mm_loadu_ps(a + i + 12), _mm_loadu_ps(b + i + 12));
+	sum0 = _mm_add_ps(sum0, _mm_mul_ps(v0, v0));
+	sum1 = _mm_add_ps(sum1, _mm_mul_ps(v1, v1));
+	sum2 = _mm_add_ps(sum2, _mm_mul_ps(v2, v2));
+	sum3 = _mm_add_ps(sum3, _mm_mul_ps(v3, v3));
+      }
+      return sqrt(sum(_mm_add_ps(_mm_add_ps(sum0, sum1), _mm_add_ps(sum2, sum3))));
+#endif
+    }
+
+    template <size_t DIMENSION>
+    inline static double compareL1(const float *a, const float *b) {
+      const __m256 mask = _mm256_set1_ps(-0.0f);
+      __m256 sum0 = _mm256_setzero_ps();
+      __m256 sum1 = _mm256_setzero_ps();
+      __m256 sum2 = _mm256_setzero_ps();
+      __m256 sum3 = _mm256_setzero_ps();
+#pragma GCC unroll 32
+      for (size_t i = 0; i < DIMENSION; i += 32) {
+	sum0 = _mm256_add_ps(sum0, _mm256_andnot_ps(mask, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i))));
+	sum1 = _mm256_add_ps(sum1, _mm256_andnot_ps(mask, _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8))));
+	sum2 = _mm256_add_ps(sum2, _mm256_andnot_ps(mask, _mm256_sub_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16))));
+	sum3 = _mm256_add_ps(sum3, _mm256_andnot_ps(mask, _mm256_sub_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24))));
+      }
+      return sum(reduce(_mm256_add_ps(_mm256_add_ps(sum0, sum1), _mm256_add_ps(sum2, sum3))));
+    }
+
+    template <size_t DIMENSION>
+    inline static double compareDotProduct(const float *a, const float *b) {
+#if defined(NGT_AVX512)
+      __m512 sum0 = _mm512_setzero_ps();
+      __m512 sum1 = _mm512_setzero_ps();
+#pragma GCC unroll 32
+      for (size_t i = 0; i < DIMENSION; i += 32) {
+	sum0 = _mm512_add_ps(sum0, _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+	sum1 = _mm512_add_ps(sum1, _mm512_mul_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16)));
+      }
+      return sum(reduce(_mm512_add_ps(sum0, sum1)));
+#elif defined(NGT_AVX2)
+      __m256 sum0 = _mm256_setzero_ps();
+      __m256 sum1 = _mm256_setzero_ps();
+      __m256 sum2 = _mm256_setzero_ps();
+      __m256 sum3 = _mm256_setzero_ps();
+#pragma GCC unroll 32
+      for (size_t i = 0; i < DIMENSION; i += 32) {
+	sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+	sum2 = _mm256_add_ps(sum2, _mm256_mul_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16)));
+	sum3 = _mm256_add_ps(sum3, _mm256_mul_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24)));
+      }
+      return sum(reduce(_mm256_add_ps(_mm256_add_ps(sum0, sum1), _mm256_add_ps(sum2, sum3))));
+#else
+      __m128 sum0 = _mm_setzero_ps();
+      __m128 sum1 = _mm_setzero_ps();
+      __m128 sum2 = _mm_setzero_ps();
+      __m128 sum3 = _mm_setzero_ps();
+#pragma GCC unroll 64
+      for (size_t i = 0; i < DIMENSION; i += 16) {
+	sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+	sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(a + i + 8), _mm_loadu_ps(b + i + 8)));
+	sum3 = _mm_add_ps(sum3, _mm_mul_ps(_mm_loadu_ps(a + i + 12), _mm_loadu_ps(b + i + 12)));
+      }
+      return sum(_mm_add_ps(_mm_add_ps(sum0, sum1), _mm_add_ps(sum2, sum3)));
+#endif
+    }
+
+    template <size_t DIMENSION>
+    inline static double compareCosine(const float *a, const float *b) {
+#if defined(NGT_AVX512)
+      __m512 normA = _mm512_setzero_ps();
+      __m512 normB = _mm512_setzero_ps();
+      __m512 s = _mm512_setzero_ps();
+#pragma GCC unroll 64
+      for (size_t i = 0; i < DIMENSION; i += 16) {
+	__m512 am = _mm512_loadu_ps(a + i);
+	__m512 bm = _mm512_loadu_ps(b + i);
+	normA = _mm512_add_ps(normA, _mm512_mul_ps(am, am));
+	normB = _mm512_add_ps(normB, _mm512_mul_ps(bm, bm));
+	s = _mm512_add_ps(s, _mm512_mul_ps(am, bm));
+      }
+      return sum(reduce(s)) / sqrt(sum(reduce(normA)) * sum(reduce(normB)));
+#elif defined(NGT_AVX2)
+      __m256 normA = _mm256_setzero_ps();
+      __m256 normB = _mm256_setzero_ps();
+      __m256 s = _mm256_setzero_ps();
+#pragma GCC unroll 128
+      for (size_t i = 0; i < DIMENSION; i += 8) {
+	__m256 am = _mm256_loadu_ps(a + i);
+	__m256 bm = _mm256_loadu_ps(b + i);
+	normA = _mm256_add_ps(normA, _mm256_mul_ps(am, am));
+	normB = _mm256_add_ps(normB, _mm256_mul_ps(bm, bm));
+	s = _mm256_add_ps(s, _mm256_mul_ps(am, bm));
+      }
+      return sum(reduce(s)) / sqrt(sum(reduce(normA)) * sum(reduce(normB)));
+#else
+      __m128 normA = _mm_setzero_ps();
+      __m128 normB = _mm_setzero_ps();
+      __m128 s = _mm_setzero_ps();
+#pragma GCC unroll 256
+      for (size_t i = 0; i < DIMENSION; i += 4) {
+	__m128 am = _mm_loadu_ps(a + i);
+	__m128 bm = _mm_loadu_ps(b + i);
+	normA = _mm_add_ps(normA, _mm_mul_ps(am, am));
+	normB = _mm_add_ps(normB, _mm_mul_ps(bm, bm));
+	s = _mm_add_ps(s, _mm_mul_ps(am, bm));
+      }
+      return sum(s) / sqrt(sum(normA) * sum(normB));
+#endif
+    }
+#endif
+
+    // Float16 objects are widened to float when they are loaded, and the sums are accumulated in float.
+#if defined(NGT_NO_AVX)
+    inline static double compareL2(const float16 *a, const float16 *b, size_t size) {
+      return compareL2<float16, double>(a, b, size);
+    }
+
+    inline static double compareL1(const float16 *a, const float16 *b, size_t size) {
+      return compareL1<float16, double>(a, b, size);
+    }
+#else
+#if defined(NGT_AVX512)
+    // the zero-masked conversions are used, since GCC reports the undefined source of the unmasked ones
+    // as uninitialized within the AVX-512 target region.
+    inline static __m512 load(const float16 *v) {
+      return _mm512_maskz_cvtph_ps(0xFFFF, _mm256_loadu_si256((__m256i const*)v));
+    }
+#elif defined(NGT_AVX2)
+    inline static __m256 load(const float16 *v) {
+      return _mm256_cvtph_ps(_mm_loadu_si128((__m128i const*)v));
+    }
+#endif
+
+    inline static double compareL2(const float16 *a, const float16 *b, size_t size) {
+      const float16 *last = a + size;
+#if defined(NGT_AVX512)
+      __m512 s = _mm512_setzero_ps();
+      while (a < last) {
+	__m512 v = _mm512_sub_ps(load(a), load(b));
+	s = _mm512_add_ps(s, _mm512_mul_ps(v, v));
+	a += 16;
+	b += 16;
+      }
+      return sqrt(sum(reduce(s)));
+#elif defined(NGT_AVX2)
+      __m256 s = _mm256_setzero_ps();
+      while (a < last) {
+	__m256 v = _mm256_sub_ps(load(a), load(b));
+	s = _mm256_add_ps(s, _mm256_mul_ps(v, v));
+	a += 8;
+	b += 8;
+      }
+      return sqrt(sum(reduce(s)));
+#else
+      double s = 0.0;
+      while (a < last) {
+	double d = (float)*a++ - (float)*b++;
+	s += d * d;
+      }
+      return sqrt(s);
+#endif
+    }
+
+    inline static double compareL1(const float16 *a, const float16 *b, size_t size) {
+      const float16 *last = a + size;
+#if defined(NGT_AVX512)
+      __m512 s = _mm512_setzero_ps();
+      while (a < last) {
+	s = _mm512_add_ps(s, _mm512_abs_ps(_mm512_sub_ps(load(a), load(b))));
+	a += 16;
+	b += 16;
+      }
+      return sum(reduce(s));
+#elif defined(NGT_AVX2)
+      const __m256 mask = _mm256_set1_ps(-0.0f);
+      __m256 s = _mm256_setzero_ps();
+      while (a < last) {
+	s = _mm256_add_ps(s, _mm256_andnot_ps(mask, _mm256_sub_ps(load(a), load(b))));
+	a += 8;
+	b += 8;
+      }
+      return sum(reduce(s));
+#else
+      double s = 0.0;
+      while (a < last) {
+	s += fabs((float)*a++ - (float)*b++);
+      }
+      return s;
+#endif
+    }
+
+    inline static double compareDotProduct(const float16 *a, const float16 *b, size_t size) {
+      const float16 *last = a + size;
+#if defined(NGT_AVX512)
+      __m512 s = _mm512_setzero_ps();
+      while (a < last) {
+	s = _mm512_add_ps(s, _mm512_mul_ps(load(a), load(b)));
+	a += 16;
+	b += 16;
+      }
+      return sum(reduce(s));
+#elif defined(NGT_AVX2)
+      __m256 s = _mm256_setzero_ps();
+      while (a < last) {
+	s = _mm256_add_ps(s, _mm256_mul_ps(load(a), load(b)));
+	a += 8;
+	b += 8;
+      }
+      return sum(reduce(s));
+#else
+      double s = 0.0;
+      while (a < last) {
+	s += (float)*a++ * (float)*b++;
+      }
+      return s;
+#endif
+    }
+
+    inline static double compareCosine(const float16 *a, const float16 *b, size_t size) {
+      const float16 *last = a + size;
+#if defined(NGT_AVX512)
+      __m512 normA = _mm512_setzero_ps();
+      __m512 normB = _mm512_setzero_ps();
+      __m512 s = _mm512_setzero_ps();
+      while (a < last) {
+	__m512 am = load(a);
+	__m512 bm = load(b);
+	normA = _mm512_add_ps(normA, _mm512_mul_ps(am, am));
+	normB = _mm512_add_ps(normB, _mm512_mul_ps(bm, bm));
+	s = _mm512_add_ps(s, _mm512_mul_ps(am, bm));
+	a += 16;
+	b += 16;
+      }
+      return sum(reduce(s)) / sqrt(sum(reduce(normA)) * sum(reduce(normB)));
+#elif defined(NGT_AVX2)
+      __m256 normA = _mm256_setzero_ps();
+      __m256 normB = _mm256_setzero_ps();
+      __m256 s = _mm256_setzero_ps();
+      while (a < last) {
+	__m256 am = load(a);
+	__m256 bm = load(b);
+	normA = _mm256_add_ps(normA, _mm256_mul_ps(am, am));
+	normB = _mm256_add_ps(normB, _mm256_mul_ps(bm, bm));
+	s = _mm256_add_ps(s, _mm256_mul_ps(am, bm));
+	a += 8;
+	b += 8;
+      }
+      return sum(reduce(s)) / sqrt(sum(reduce(normA)) * sum(reduce(normB)));
+#else
+      double normA = 0.0;
+      double normB = 0.0;
+      double s = 0.0;
+      while (a < last) {
+	double av = *a++;
+	double bv = *b++;
+	normA += av * av;
+	normB += bv * bv;
+	s += av * bv;
+      }
+      return s / sqrt(normA * normB);
+#endif
+    }
+#endif
+
+    inline static double convertCosineToAngle(double cosine) {
+      if (cosine >= 1.0) {
+	return 0.0;
+      } else if (cosine <= -1.0) {
+	return acos(-1.0);
+      } else {
+	return acos(cosine);
+      }
+    }
+
+    template <typename OBJECT_TYPE> 
+    inline static double compareAngleDistance(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
+      return convertCosineToAngle(compareCosine(a, b, size));
+    }
+
+    template <typename OBJECT_TYPE> 
+    inline static double compareNormalizedAngleDistance(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
+      return convertCosineToAngle(compareDotProduct(a, b, size));
+    }
+
+    template <typename OBJECT_TYPE> 
+    inline static double compareCosineSimilarity(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
+      return 1.0 - compareCosine(a, b, size);
+    }
+
+    template <typename OBJECT_TYPE> 
+    inline static double compareNormalizedCosineSimilarity(const OBJECT_TYPE *a, const OBJECT_TYPE *b, size_t size) {
+      double v = 1.0 - compareDotProduct(a, b, size);
+      return v < 0.0 ? 0.0 : v;
+    }
+
+    // Qint8 codes are widened to int32 and their differences are taken in integer, and the per-dimension
+    // scale and offset are applied in float.
+#if defined(NGT_AVX512)
+    inline static __m512i loadCode(const qint8 *v) {
+      return _mm512_maskz_cvtepi8_epi32(0xFFFF, _mm_loadu_si128((__m128i const*)v));
+    }
+    inline static __m512 load(const qint8 *v, const float *scale, const float *offset) {
+      return _mm512_add_ps(_mm512_loadu_ps(offset), _mm512_mul_ps(_mm512_loadu_ps(scale), _mm512_maskz_cvtepi32_ps(0xFFFF, loadCode(v))));
+    }
+#elif defined(NGT_AVX2)
+    inline static __m256i loadCode(const qint8 *v) {
+      return _mm256_cvtepi8_epi32(_mm_loadl_epi64((__m128i const*)v));
+    }
+    inline static __m256 load(const qint8 *v, const float *scale, const float *offset) {
+      return _mm256_add_ps(_mm256_loadu_ps(offset), _mm256_mul_ps(_mm256_loadu_ps(scale), _mm256_cvtepi32_ps(loadCode(v))));
+    }
+#endif
+
+    inline static double compareL2(const qint8 *a, const qint8 *b, const float *scale, size_t size) {
+      const qint8 *last = a + size;
+#if defined(NGT_AVX512)
+      __m512 s = _mm512_setzero_ps();
+      while (a < last) {
+	__m512 v = _mm512_mul_ps(_mm512_loadu_ps(scale), _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_sub_epi32(loadCode(a), loadCode(b))));
+	s = _mm512_add_ps(s, _mm512_mul_ps(v, v));
+	a += 16;
+	b += 16;
+	scale += 16;
+      }
+      return sqrt(sum(reduce(s)));
+#elif defined(NGT_AVX2)
+      __m256 s = _mm256_setzero_ps();
+      while (a < last) {
+	__m256 v = _mm256_mul_ps(_mm256_loadu_ps(scale), _mm256_cvtepi32_ps(_mm256_sub_epi32(loadCode(a), loadCode(b))));
+	s = _mm256_add_ps(s, _mm256_mul_ps(v, v));
+	a += 8;
+	b += 8;
+	scale += 8;
+      }
+      return sqrt(sum(reduce(s)));
+#else
+      double s = 0.0;
+      while (a < last) {
+	double d = *scale++ * ((*a++).code - (*b++).code);
+	s += d * d;
+      }
+      return sqrt(s);
+#endif
+    }
+
+    inline static double compareL1(const qint8 *a, const qint8 *b, const float *scale, size_t size) {
+      const qint8 *last = a + size;
+#if defined(NGT_AVX512)
+      __m512 s = _mm512_setzero_ps();
+      while (a < last) {
+	__m512 v = _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_maskz_abs_epi32(0xFFFF, _mm512_sub_epi32(loadCode(a), loadCode(b))));
+	s = _mm512_add_ps(s, _mm512_mul_ps(_mm512_loadu_ps(scale), v));
+	a += 16;
+	b += 16;
+	scale += 16;
+      }
+      return sum(reduce(s));
+#elif defined(NGT_AVX2)
+      __m256 s = _mm256_setzero_ps();
+      while (a < last) {
+	__m256 v = _mm256_cvtepi32_ps(_mm256_abs_epi32(_mm256_sub_epi32(loadCode(a), loadCode(b))));
+	s = _mm256_add_ps(s, _mm256_mul_ps(_mm256_loadu_ps(scale), v));
+	a += 8;
+	b += 8;
+	scale += 8;
+      }
+      return sum(reduce(s));
+#else
+      double s = 0.0;
+      while (a < last) {
+	s += *scale++ * abs((*a++).code - (*b++).code);
+      }
+      return s;
+#endif
+    }
+
+    inline static double compareCosine(const qint8 *a, const qint8 *b, const float *scale, const float *offset, size_t size) {
+      const qint8 *last = a + size;
+#if defined(NGT_AVX512)
+      __m512 normA = _mm512_setzero_ps();
+      __m512 normB = _mm512_setzero_ps();
+      __m512 s = _mm512_setzero_ps();
+      while (a < last) {
+	__m512 am = load(a, scale, offset);
+	__m512 bm = load(b, scale, offset);
+	normA = _mm512_add_ps(normA, _mm512_mul_ps(am, am));
+	normB = _mm512_add_ps(normB, _mm512_mul_ps(bm, bm));
+	s = _mm512_add_ps(s, _mm512_mul_ps(am, bm));
+	a += 16;
+	b += 16;
+	scale += 16;
+	offset += 16;
+      }
+      return sum(reduce(s)) / sqrt(sum(reduce(normA)) * sum(reduce(normB)));
+#elif defined(NGT_AVX2)
+      __m256 normA = _mm256_setzero_ps();
+      __m256 normB = _mm256_setzero_ps();
+      __m256 s = _mm256_setzero_ps();
+      while (a < last) {
+	__m256 am = load(a, scale, offset);
+	__m256 bm = load(b, scale, offset);
+	normA = _mm256_add_ps(normA, _mm256_mul_ps(am, am));
+	normB = _mm256_add_ps(normB, _mm256_mul_ps(bm, bm));
+	s = _mm256_add_ps(s, _mm256_mul_ps(am, bm));
+	a += 8;
+	b += 8;
+	scale += 8;
+	offset += 8;
+      }
+      return sum(reduce(s)) / sqrt(sum(reduce(normA)) * sum(reduce(normB)));
+#else
+      double normA = 0.0;
+      double normB = 0.0;
+      double s = 0.0;
+      while (a < last) {
+	double av = *offset + *scale * (*a++).code;
+	double bv = *offset++ + *scale++ * (*b++).code;
+	normA += av * av;
+	normB += bv * bv;
+	s += av * bv;
+      }
+      return s / sqrt(normA * normB);
+#endif
+    }
+
+    inline static double compareAngleDistance(const qint8 *a, const qint8 *b, const float *scale, const float *offset, size_t size) {
+      return convertCosineToAngle(compareCosine(a, b, scale, offset, size));
+    }
+
+    inline static double compareCosineSimilarity(const qint8 *a, const qint8 *b, const float *scale, const float *offset, size_t size) {
+      return 1.0 - compareCosine(a, b, scale, offset, size);
+    }
+
+    class L1Uint8 {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareL1((const uint8_t*)a, (const uint8_t*)b, size);
+      }
+    };
+
+    class L2Uint8 {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareL2((const uint8_t*)a, (const uint8_t*)b, size);
+      }
+    };
+
+    class HammingUint8 {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareHammingDistance((const uint8_t*)a, (const uint8_t*)b, size);
+      }
+    };
+
+    class JaccardUint8 {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareJaccardDistance((const uint8_t*)a, (const uint8_t*)b, size);
+      }
+    };
+
+    class L2Float {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+#if defined(NGT_NO_AVX)
+	return PrimitiveComparator::compareL2<float, double>((const float*)a, (const float*)b, size);
+#else
+	return PrimitiveComparator::compareL2((const float*)a, (const float*)b, size);
+#endif
+      }
+    };
+
+    class L1Float {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareL1((const float*)a, (const float*)b, size);
+      }
+    };
+
+    class CosineSimilarityFloat {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareCosineSimilarity((const float*)a, (const float*)b, size);
+      }
+    };
+
+    class AngleFloat {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareAngleDistance((const float*)a, (const float*)b, size);
+      }
+    };
+
+    class NormalizedCosineSimilarityFloat {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareNormalizedCosineSimilarity((const float*)a, (const float*)b, size);
+      }
+    };
+
+    class NormalizedAngleFloat {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareNormalizedAngleDistance((const float*)a, (const float*)b, size);
+      }
+    };
+
+    class L2Float16 {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareL2((const float16*)a, (const float16*)b, size);
+      }
+    };
+
+    class L1Float16 {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareL1((const float16*)a, (const float16*)b, size);
+      }
+    };
+
+    class CosineSimilarityFloat16 {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareCosineSimilarity((const float16*)a, (const float16*)b, size);
+      }
+    };
+
+    class AngleFloat16 {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareAngleDistance((const float16*)a, (const float16*)b, size);
+      }
+    };
+
+    class NormalizedCosineSimilarityFloat16 {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareNormalizedCosineSimilarity((const float16*)a, (const float16*)b, size);
+      }
+    };
+
+    class NormalizedAngleFloat16 {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareNormalizedAngleDistance((const float16*)a, (const float16*)b, size);
+      }
+    };
+
+    template <size_t DIMENSION>
+    class L2FloatForDimension {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareL2<DIMENSION>((const float*)a, (const float*)b);
+      }
+    };
+
+    template <size_t DIMENSION>
+    class L1FloatForDimension {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::compareL1<DIMENSION>((const float*)a, (const float*)b);
+      }
+    };
+
+    template <size_t DIMENSION>
+    class CosineSimilarityFloatForDimension {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return 1.0 - PrimitiveComparator::compareCosine<DIMENSION>((const float*)a, (const float*)b);
+      }
+    };
+
+    template <size_t DIMENSION>
+    class AngleFloatForDimension {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::convertCosineToAngle(PrimitiveComparator::compareCosine<DIMENSION>((const float*)a, (const float*)b));
+      }
+    };
+
+    template <size_t DIMENSION>
+    class NormalizedCosineSimilarityFloatForDimension {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	double v = 1.0 - PrimitiveComparator::compareDotProduct<DIMENSION>((const float*)a, (const float*)b);
+	return v < 0.0 ? 0.0 : v;
+      }
+    };
+
+    template <size_t DIMENSION>
+    class NormalizedAngleFloatForDimension {
+    public:
+      inline static double compare(const void *a, const void *b, size_t size) {
+	return PrimitiveComparator::convertCosineToAngle(PrimitiveComparator::compareDotProduct<DIMENSION>((const float*)a, (const float*)b));
+      }
+    };
+
+};
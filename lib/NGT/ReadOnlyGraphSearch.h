@@ -0,0 +1,355 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include	"NGT/Graph.h"
+
+// The read-only graph search is instantiated for each comparator. Graph.cpp instantiates it with
+// the default comparators, and GraphAVX2.cpp and GraphAVX512.cpp include this file under their
+// target instruction sets. Every instantiation in this file must have a comparator of its own
+// instruction set in its template arguments, otherwise the copies compiled for the different
+// instruction sets share one name and the linker may pick the one the CPU cannot execute.
+
+#ifdef NGT_GRAPH_READ_ONLY_GRAPH
+
+namespace NGT {
+
+  // The comparators of the primitive comparator are static. The scalar quantized objects are compared
+  // with the comparator of the object space instead, because their distances depend on the quantizer.
+  // ObjectSpaceComparator selects it, and its argument only names the instruction set.
+  template <typename PRIMITIVE_COMPARATOR>
+  class ObjectSpaceComparator {};
+
+  template <typename COMPARATOR>
+  class ReadOnlyGraphComparator {
+  public:
+    ReadOnlyGraphComparator(ObjectSpace &objectSpace) {}
+    void setupDistances(NeighborhoodGraph &graph, SearchContainer &sc, ObjectDistances &seeds) {
+      graph.setupDistances(sc, seeds, COMPARATOR::compare);
+    }
+    double operator()(Object &query, PersistentObject &object, size_t dimension) {
+      return COMPARATOR::compare((void*)&query[0], (void*)&object[0], dimension);
+    }
+    double operator()(Object &query, const uint8_t *object, size_t dimension) {
+      return COMPARATOR::compare((void*)&query[0], (void*)object, dimension);
+    }
+  };
+
+  template <typename PRIMITIVE_COMPARATOR>
+  class ReadOnlyGraphComparator<ObjectSpaceComparator<PRIMITIVE_COMPARATOR>> {
+  public:
+    ReadOnlyGraphComparator(ObjectSpace &objectSpace):comparator(objectSpace.getComparator()) {}
+    void setupDistances(NeighborhoodGraph &graph, SearchContainer &sc, ObjectDistances &seeds) {
+      graph.setupDistances(sc, seeds);
+    }
+    double operator()(Object &query, PersistentObject &object, size_t dimension) {
+      return comparator(query, object);
+    }
+    double operator()(Object &query, const uint8_t *object, size_t dimension) {
+      return comparator(query, static_cast<const void*>(object));
+    }
+    ObjectSpace::Comparator &comparator;
+  };
+
+  template <typename COMPARATOR, typename CHECK_LIST>
+  void
+    NeighborhoodGraph::searchReadOnlyGraph(NGT::SearchContainer &sc, ObjectDistances &seeds)
+  {
+    if (sc.explorationCoefficient == 0.0) {
+      sc.explorationCoefficient = NGT_EXPLORATION_COEFFICIENT;
+    }
+
+    // setup edgeSize
+    size_t edgeSize = getEdgeSize(sc);
+
+    static thread_local UncheckedSet unchecked;
+    unchecked.clear();
+
+#if defined(NGT_GRAPH_CHECK_VECTOR) || defined(NGT_GRAPH_CHECK_HASH_BASED_BOOLEAN_SET)
+    CHECK_LIST &distanceChecked = getDistanceCheckedSet<CHECK_LIST>(searchRepository.size());
+#else
+    CHECK_LIST distanceChecked(searchRepository.size());
+#endif
+
+    static thread_local ResultSet results;
+    results.clear();
+
+    const size_t dimension = objectSpace->getPaddedDimension();
+    ReadOnlyGraphComparator<COMPARATOR> comparator(*objectSpace);
+    if (searchRepository.hasObjectVectors()) {
+      for (size_t i = 0; i < seeds.size(); i++) {
+	seeds[i].distance = comparator(sc.object, searchRepository.getObjectVector(seeds[i].id), dimension);
+      }
+#ifdef NGT_DISTANCE_COMPUTATION_COUNT
+      sc.distanceComputationCount += seeds.size();
+#endif
+    } else {
+      comparator.setupDistances(*this, sc, seeds);
+    }
+    setupSeeds(sc, seeds, results, unchecked, distanceChecked);
+
+    Distance explorationRadius = sc.explorationCoefficient * sc.radius;
+    const uint64_t *offsets = searchRepository.offsets;
+    const ObjectID *edges = searchRepository.edges;
+    PersistentObject **objects = searchRepository.objects;
+    const uint8_t *objectVectors = searchRepository.objectVectors;
+    const size_t objectVectorSize = searchRepository.objectVectorSize;
+    ObjectDistance result;
+    ObjectDistance target;
+    const size_t prefetchSize = objectSpace->getPrefetchSize();
+    const size_t prefetchOffset = objectSpace->getPrefetchOffset();
+    const ObjectID *neighborptr;
+    const ObjectID *neighborendptr;
+    const size_t vectorSize = searchRepository.vectorSize;
+    const CompressedGraph &compressed = searchRepository.compressed;
+    static thread_local std::vector<ObjectID> decodedIDBuffer;
+    if (compressed.isOpen() && decodedIDBuffer.size() < compressed.getBufferSize()) {
+      decodedIDBuffer.resize(compressed.getBufferSize());
+    }
+    ObjectID *decodedIDs = decodedIDBuffer.data();
+    auto visit = [&](ObjectID neighbor, Distance distance) {
+      if (distance <= explorationRadius) {
+	result.set(neighbor, distance);
+	unchecked.push(result);
+	if (distance <= sc.radius) {
+	  results.push(result);
+	  if (results.size() >= sc.size) {
+	    if (results.size() > sc.size) {
+	      results.pop();
+	    }
+	    sc.radius = results.top().distance;
+	    explorationRadius = sc.explorationCoefficient * sc.radius;
+	  }
+	}
+      }
+    };
+    while (!unchecked.empty()) {
+      target = unchecked.top();
+      unchecked.pop();
+      if (target.distance > explorationRadius) {
+	break;
+      }
+      size_t neighborSize;
+      if (compressed.isOpen()) {
+	// the compressed lists are already truncated when they are saved, and are not in the order of the distances.
+	neighborSize = compressed.decode(target.id, decodedIDs);
+	neighborptr = decodedIDs;
+      } else {
+	neighborptr = edges + offsets[target.id];
+	neighborSize = offsets[target.id + 1] - offsets[target.id];
+	neighborSize = neighborSize < edgeSize ? neighborSize : edgeSize;
+      }
+      neighborendptr = neighborptr + neighborSize;
+
+      if (searchRepository.hasVectors()) {
+	// the neighbors are compared with their inline copies that are consecutive.
+	const uint8_t *vectorptr = searchRepository.getVectors(target.id);
+	const uint8_t *vectorendptr = vectorptr + neighborSize * vectorSize;
+	const uint8_t *prefetchptr = vectorptr + prefetchOffset * vectorSize;
+	for (const uint8_t *ptr = vectorptr; ptr < prefetchptr && ptr < vectorendptr; ptr += vectorSize) {
+	  MemoryCache::prefetch(const_cast<uint8_t*>(ptr), vectorSize);
+	}
+	for (; neighborptr < neighborendptr; ++neighborptr, vectorptr += vectorSize, prefetchptr += vectorSize) {
+	  if (prefetchptr < vectorendptr) {
+	    MemoryCache::prefetch(const_cast<uint8_t*>(prefetchptr), vectorSize);
+	  }
+	  if (distanceChecked[*neighborptr]) {
+	    continue;
+	  }
+#ifdef NGT_VISIT_COUNT
+	  sc.visitCount++;
+#endif
+	  distanceChecked.insert(*neighborptr);
+#ifdef NGT_DISTANCE_COMPUTATION_COUNT
+	  sc.distanceComputationCount++;
+#endif
+	  visit(*neighborptr, comparator(sc.object, vectorptr, dimension));
+	}
+	continue;
+      }
+
+      if (objectVectors != 0) {
+	// the objects are compared in place in the mapped index image.
+	ObjectID nsIDs[neighborSize];
+	size_t nsIDsSize = 0;
+	for (; neighborptr < neighborendptr; ++neighborptr) {
+	  if (!distanceChecked[*neighborptr]) {
+	    nsIDs[nsIDsSize] = *neighborptr;
+	    if (nsIDsSize < prefetchOffset) {
+	      MemoryCache::prefetch(const_cast<uint8_t*>(objectVectors + *neighborptr * objectVectorSize), prefetchSize);
+	    }
+	    nsIDsSize++;
+	  }
+	}
+	for (size_t idx = 0; idx < nsIDsSize; idx++) {
+	  ObjectID neighbor = nsIDs[idx];
+	  if (idx + prefetchOffset < nsIDsSize) {
+	    MemoryCache::prefetch(const_cast<uint8_t*>(objectVectors + nsIDs[idx + prefetchOffset] * objectVectorSize), prefetchSize);
+	  }
+#ifdef NGT_VISIT_COUNT
+	  sc.visitCount++;
+#endif
+	  distanceChecked.insert(neighbor);
+#ifdef NGT_DISTANCE_COMPUTATION_COUNT
+	  sc.distanceComputationCount++;
+#endif
+	  visit(neighbor, comparator(sc.object, objectVectors + neighbor * objectVectorSize, dimension));
+	}
+	continue;
+      }
+
+      ObjectID nsIDs[neighborSize];
+      size_t nsIDsSize = 0;
+
+      for (; neighborptr < neighborendptr; ++neighborptr) {
+       if (!distanceChecked[*neighborptr]) {
+         nsIDs[nsIDsSize] = *neighborptr;
+         if (nsIDsSize < prefetchOffset) {
+           unsigned char *ptr = reinterpret_cast<unsigned char*>(objects[*neighborptr]);
+           MemoryCache::prefetch(ptr, prefetchSize);
+         }
+         nsIDsSize++;
+       }
+      }
+      for (size_t idx = 0; idx < nsIDsSize; idx++) {
+	ObjectID neighbor = nsIDs[idx];
+	if (idx + prefetchOffset < nsIDsSize) {
+	  unsigned char *ptr = reinterpret_cast<unsigned char*>(objects[nsIDs[idx + prefetchOffset]]);
+	  MemoryCache::prefetch(ptr, prefetchSize);
+	}
+#ifdef NGT_VISIT_COUNT
+	sc.visitCount++;
+#endif
+        distanceChecked.insert(neighbor);
+
+#ifdef NGT_DISTANCE_COMPUTATION_COUNT
+	sc.distanceComputationCount++;
+#endif
+
+	visit(neighbor, comparator(sc.object, *objects[neighbor], dimension));
+      } 
+    } 
+
+    if (sc.resultIsAvailable()) { 
+      ObjectDistances &qresults = sc.getResult();
+      qresults.moveFrom(results);
+    } else {
+      sc.workingResult.swap(results);
+    }
+    results.clear();
+    unchecked.clear();
+  }
+
+  template <typename COMPARATOR, typename CHECK_LIST>
+  void
+    NeighborhoodGraph::Search::searchWith(NeighborhoodGraph &graph, NGT::SearchContainer &sc, ObjectDistances &seeds)
+  {
+    graph.searchReadOnlyGraph<COMPARATOR, CHECK_LIST>(sc, seeds);
+  }
+
+  template <typename PRIMITIVE_COMPARATOR, size_t DIMENSION, typename CHECK_LIST>
+  NeighborhoodGraph::Search::Method
+    NeighborhoodGraph::Search::getMethodForFixedDimension(NGT::ObjectSpace::DistanceType dtype)
+  {
+    switch (dtype) {
+    case NGT::ObjectSpace::DistanceTypeNormalizedCosine : return searchWith<typename PRIMITIVE_COMPARATOR::template NormalizedCosineSimilarityFloatForDimension<DIMENSION>, CHECK_LIST>;
+    case NGT::ObjectSpace::DistanceTypeCosine : 	  return searchWith<typename PRIMITIVE_COMPARATOR::template CosineSimilarityFloatForDimension<DIMENSION>, CHECK_LIST>;
+    case NGT::ObjectSpace::DistanceTypeNormalizedAngle :  return searchWith<typename PRIMITIVE_COMPARATOR::template NormalizedAngleFloatForDimension<DIMENSION>, CHECK_LIST>;
+    case NGT::ObjectSpace::DistanceTypeAngle : 		  return searchWith<typename PRIMITIVE_COMPARATOR::template AngleFloatForDimension<DIMENSION>, CHECK_LIST>;
+    case NGT::ObjectSpace::DistanceTypeL2 : 		  return searchWith<typename PRIMITIVE_COMPARATOR::template L2FloatForDimension<DIMENSION>, CHECK_LIST>;
+    case NGT::ObjectSpace::DistanceTypeL1 : 		  return searchWith<typename PRIMITIVE_COMPARATOR::template L1FloatForDimension<DIMENSION>, CHECK_LIST>;
+    default:						  return 0;
+    }
+  }
+
+  template <typename PRIMITIVE_COMPARATOR, typename CHECK_LIST>
+  NeighborhoodGraph::Search::Method
+    NeighborhoodGraph::Search::getMethodForDimension(NGT::ObjectSpace::DistanceType dtype, size_t dimension)
+  {
+    switch (dimension) {
+    case 64:	return getMethodForFixedDimension<PRIMITIVE_COMPARATOR, 64, CHECK_LIST>(dtype);
+    case 96:	return getMethodForFixedDimension<PRIMITIVE_COMPARATOR, 96, CHECK_LIST>(dtype);
+    case 128:	return getMethodForFixedDimension<PRIMITIVE_COMPARATOR, 128, CHECK_LIST>(dtype);
+    case 256:	return getMethodForFixedDimension<PRIMITIVE_COMPARATOR, 256, CHECK_LIST>(dtype);
+    case 384:	return getMethodForFixedDimension<PRIMITIVE_COMPARATOR, 384, CHECK_LIST>(dtype);
+    case 512:	return getMethodForFixedDimension<PRIMITIVE_COMPARATOR, 512, CHECK_LIST>(dtype);
+    case 768:	return getMethodForFixedDimension<PRIMITIVE_COMPARATOR, 768, CHECK_LIST>(dtype);
+    case 960:	return getMethodForFixedDimension<PRIMITIVE_COMPARATOR, 960, CHECK_LIST>(dtype);
+    case 1024:	return getMethodForFixedDimension<PRIMITIVE_COMPARATOR, 1024, CHECK_LIST>(dtype);
+    default:	return 0;
+    }
+  }
+
+  template <typename PRIMITIVE_COMPARATOR, typename CHECK_LIST>
+  NeighborhoodGraph::Search::Method
+    NeighborhoodGraph::Search::getMethodFor(NGT::ObjectSpace::DistanceType dtype, NGT::ObjectSpace::ObjectType otype, size_t dimension)
+  {
+    switch (otype) {
+    default:
+    case NGT::ObjectSpace::Float:
+      {
+	Method method = getMethodForDimension<PRIMITIVE_COMPARATOR, CHECK_LIST>(dtype, dimension);
+	if (method != 0) {
+	  return method;
+	}
+      }
+      switch (dtype) {
+      case NGT::ObjectSpace::DistanceTypeNormalizedCosine : return searchWith<typename PRIMITIVE_COMPARATOR::NormalizedCosineSimilarityFloat, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeCosine : 	    return searchWith<typename PRIMITIVE_COMPARATOR::CosineSimilarityFloat, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeNormalizedAngle :  return searchWith<typename PRIMITIVE_COMPARATOR::NormalizedAngleFloat, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeAngle : 	    return searchWith<typename PRIMITIVE_COMPARATOR::AngleFloat, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeL2 : 		    return searchWith<typename PRIMITIVE_COMPARATOR::L2Float, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeL1 : 		    return searchWith<typename PRIMITIVE_COMPARATOR::L1Float, CHECK_LIST>;
+      default:						    return searchWith<typename PRIMITIVE_COMPARATOR::L2Float, CHECK_LIST>;
+      }
+    case NGT::ObjectSpace::Float16:
+      switch (dtype) {
+      case NGT::ObjectSpace::DistanceTypeNormalizedCosine : return searchWith<typename PRIMITIVE_COMPARATOR::NormalizedCosineSimilarityFloat16, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeCosine : 	    return searchWith<typename PRIMITIVE_COMPARATOR::CosineSimilarityFloat16, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeNormalizedAngle :  return searchWith<typename PRIMITIVE_COMPARATOR::NormalizedAngleFloat16, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeAngle : 	    return searchWith<typename PRIMITIVE_COMPARATOR::AngleFloat16, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeL2 : 		    return searchWith<typename PRIMITIVE_COMPARATOR::L2Float16, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeL1 : 		    return searchWith<typename PRIMITIVE_COMPARATOR::L1Float16, CHECK_LIST>;
+      default:						    return searchWith<typename PRIMITIVE_COMPARATOR::L2Float16, CHECK_LIST>;
+      }
+    case NGT::ObjectSpace::Qint8:
+      return searchWith<ObjectSpaceComparator<PRIMITIVE_COMPARATOR>, CHECK_LIST>;
+    case NGT::ObjectSpace::Uint8:
+      switch (dtype) {
+      case NGT::ObjectSpace::DistanceTypeHamming : return searchWith<typename PRIMITIVE_COMPARATOR::HammingUint8, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeJaccard : return searchWith<typename PRIMITIVE_COMPARATOR::JaccardUint8, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeL2 : 	   return searchWith<typename PRIMITIVE_COMPARATOR::L2Uint8, CHECK_LIST>;
+      case NGT::ObjectSpace::DistanceTypeL1 : 	   return searchWith<typename PRIMITIVE_COMPARATOR::L1Uint8, CHECK_LIST>;
+      default : 				   return searchWith<typename PRIMITIVE_COMPARATOR::L2Uint8, CHECK_LIST>;
+      }
+    }
+  }
+
+  template <typename PRIMITIVE_COMPARATOR>
+  NeighborhoodGraph::Search::Method
+    NeighborhoodGraph::Search::getMethodFor(NGT::ObjectSpace::DistanceType dtype, NGT::ObjectSpace::ObjectType otype, size_t size, size_t dimension)
+  {
+    if (size < 5000000) {
+      return getMethodFor<PRIMITIVE_COMPARATOR, DistanceCheckedSet>(dtype, otype, dimension);
+    } else {
+      return getMethodFor<PRIMITIVE_COMPARATOR, DistanceCheckedSetForLargeDataset>(dtype, otype, dimension);
+    }
+  }
+
+} // namespace NGT
+
+#endif
@@ -0,0 +1,379 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include	<mutex>
+#include	<memory>
+#include	<cstring>
+#include	<unistd.h>
+#include	<sys/mman.h>
+#include	<sys/stat.h>
+
+#include	"NGT/Common.h"
+
+namespace NGT {
+
+  // A code of the scalar quantized object type. The value of the i-th element is offset[i] + scale[i] * code.
+  class qint8 {
+  public:
+    int8_t code;
+  };
+
+  // The originals of the scalar quantized objects. They are kept apart from the codes, because they are read only
+  // to refine the results. The indexed objects refer to their originals with the slots which follow the codes.
+  // The originals are appended only, so those of the removed objects are not reclaimed.
+  class OriginalRepository {
+  public:
+    typedef uint64_t	Slot;
+
+#ifdef NGT_SHARED_MEMORY_ALLOCATOR
+    // the slot is the offset of the original in the own shared memory.
+    OriginalRepository(size_t pd):paddedDimension(pd), count(0) {}
+    ~OriginalRepository() { allocator.destruct(); }
+
+    void open(const std::string &file, size_t sharedMemorySize) {
+      void *entry = allocator.construct(file, sharedMemorySize);
+      if (entry == 0) {
+	count = new(allocator) uint64_t[1];
+	allocator.setEntry(count);
+      } else {
+	count = static_cast<uint64_t*>(entry);
+      }
+      allocator.advise(MADV_RANDOM);
+    }
+
+    Slot append(const float *v) {
+      std::lock_guard<std::mutex> lock(mutex);
+      float *original = new(allocator) float[paddedDimension];
+      memcpy(original, v, paddedDimension * sizeof(float));
+      (*count)++;
+      return allocator.getOffset(original);
+    }
+
+    const float *get(Slot slot) { return static_cast<float*>(allocator.getAddr(slot)); }
+    size_t size() { return count == 0 ? 0 : *count; }
+#else
+    // the slot is the sequential number of the original.
+    OriginalRepository(size_t pd):paddedDimension(pd), count(0), mapped(0), mappedSize(0) {}
+    ~OriginalRepository() { unmap(); }
+
+    Slot append(const float *v) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (mapped != 0) {
+	load();
+      }
+      if (count % ChunkSize == 0) {
+	chunks.emplace_back(new float[ChunkSize * paddedDimension]);
+      }
+      memcpy(chunks.back().get() + (count % ChunkSize) * paddedDimension, v, paddedDimension * sizeof(float));
+      return count++;
+    }
+
+    const float *get(Slot slot) {
+      if (mapped != 0) {
+	return mapped + slot * paddedDimension;
+      }
+      return chunks[slot / ChunkSize].get() + (slot % ChunkSize) * paddedDimension;
+    }
+
+    size_t size() { return count; }
+
+    void serialize(const std::string &ofile) {
+      // the mapped file may be overwritten below.
+      if (mapped != 0) {
+	load();
+      }
+      std::ofstream os(ofile, std::ios::binary);
+      if (!os.is_open()) {
+	std::stringstream msg;
+	msg << "OriginalRepository::serialize: Cannot open the specified file. " << ofile;
+	NGTThrowException(msg);
+      }
+      for (size_t slot = 0; slot < count; slot += ChunkSize) {
+	size_t n = std::min(static_cast<size_t>(ChunkSize), count - slot);
+	os.write(reinterpret_cast<const char*>(get(slot)), n * paddedDimension * sizeof(float));
+      }
+      if (!os) {
+	std::stringstream msg;
+	msg << "OriginalRepository::serialize: Cannot write the originals. " << ofile;
+	NGTThrowException(msg);
+      }
+    }
+
+    // the file is mapped so that only the pages of the refined objects are read. it is read into the memory
+    // when another original is appended.
+    void deserialize(const std::string &ifile) {
+      unmap();
+      chunks.clear();
+      count = 0;
+      int fd = ::open(ifile.c_str(), O_RDONLY);
+      if (fd < 0) {
+	return;
+      }
+      struct stat st;
+      if (fstat(fd, &st) != 0) {
+	::close(fd);
+	NGTThrowException("OriginalRepository::deserialize: Cannot get the size of the file. " + ifile);
+      }
+      size_t size = st.st_size;
+      if (size % (paddedDimension * sizeof(float)) != 0) {
+	::close(fd);
+	NGTThrowException("OriginalRepository::deserialize: The size of the file is inconsistent with the dimension. " + ifile);
+      }
+      if (size == 0) {
+	::close(fd);
+	return;
+      }
+      void *addr = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (addr == MAP_FAILED) {
+	NGTThrowException("OriginalRepository::deserialize: Cannot map the file. " + ifile);
+      }
+      madvise(addr, size, MADV_RANDOM);
+      mapped = static_cast<float*>(addr);
+      mappedSize = size;
+      count = size / (paddedDimension * sizeof(float));
+    }
+
+  private:
+    static const size_t ChunkSize = 4096;
+
+    void load() {
+      float *src = mapped;
+      size_t size = count;
+      mapped = 0;
+      count = 0;
+      chunks.clear();
+      for (size_t slot = 0; slot < size; slot += ChunkSize) {
+	size_t n = std::min(static_cast<size_t>(ChunkSize), size - slot);
+	chunks.emplace_back(new float[ChunkSize * paddedDimension]);
+	memcpy(chunks.back().get(), src + slot * paddedDimension, n * paddedDimension * sizeof(float));
+      }
+      count = size;
+      munmap(src, mappedSize);
+      mappedSize = 0;
+    }
+
+    void unmap() {
+      if (mapped != 0) {
+	munmap(mapped, mappedSize);
+      }
+      mapped = 0;
+      mappedSize = 0;
+    }
+#endif
+
+  private:
+    const size_t	paddedDimension;
+    std::mutex		mutex;
+#ifdef NGT_SHARED_MEMORY_ALLOCATOR
+    SharedMemoryAllocator	allocator;
+    uint64_t		*count;
+#else
+    size_t		count;
+    float		*mapped;
+    size_t		mappedSize;
+    std::vector<std::unique_ptr<float[]>>	chunks;
+#endif
+  };
+
+  // Per-dimension scalar quantizer. The ranges are learned from the objects that are appended first,
+  // and the codes are stored in the padded dimension. When the originals are kept, the slots of the originals
+  // follow the codes of the indexed objects, while the original floats follow the codes of the queries.
+  class ScalarQuantizer {
+  public:
+    typedef OriginalRepository::Slot	Slot;
+
+    ScalarQuantizer(size_t d, size_t pd, bool keep):dimension(d), paddedDimension(pd), trained(false),
+      offset(pd, 0.0), scale(pd, 0.0), originals(keep ? new OriginalRepository(pd) : 0) {}
+
+    bool isTrained() { return trained; }
+    bool isKeepingOriginals() { return originals.get() != 0; }
+
+    // the byte size of the indexed objects.
+    size_t getByteSize() {
+      return paddedDimension * sizeof(qint8) + (isKeepingOriginals() ? sizeof(Slot) : 0);
+    }
+
+    size_t getQueryByteSize() {
+      return paddedDimension * sizeof(qint8) + (isKeepingOriginals() ? paddedDimension * sizeof(float) : 0);
+    }
+
+    void resetRange() {
+      minimum.assign(dimension, FLT_MAX);
+      maximum.assign(dimension, -FLT_MAX);
+    }
+
+    template <typename T>
+    void expandRange(const T *v) {
+      for (size_t i = 0; i < dimension; i++) {
+	float f = static_cast<float>(v[i]);
+	if (f < minimum[i]) minimum[i] = f;
+	if (f > maximum[i]) maximum[i] = f;
+      }
+    }
+
+    void fixRange() {
+      if (minimum.size() != dimension) {
+	NGTThrowException("ScalarQuantizer::fixRange: No objects to learn the ranges.");
+      }
+      for (size_t i = 0; i < dimension; i++) {
+	offset[i] = (maximum[i] + minimum[i]) / 2.0;
+	scale[i] = (maximum[i] - minimum[i]) / 254.0;
+      }
+      minimum.clear();
+      maximum.clear();
+      trained = true;
+    }
+
+    template <typename T>
+    void train(const T *data, size_t size) {
+      resetRange();
+      for (size_t idx = 0; idx < size; idx++, data += dimension) {
+	expandRange(data);
+      }
+      fixRange();
+    }
+
+    template <typename T>
+    void quantize(const T *v, qint8 *code) {
+      if (!trained) {
+	NGTThrowException("ScalarQuantizer::quantize: The ranges are not learned yet. Append objects in bulk before inserting one by one.");
+      }
+      for (size_t i = 0; i < dimension; i++) {
+	float c = scale[i] == 0.0 ? 0.0 : round((static_cast<float>(v[i]) - offset[i]) / scale[i]);
+	c = c < -127.0 ? -127.0 : (c > 127.0 ? 127.0 : c);
+	code[i].code = static_cast<int8_t>(c);
+      }
+      for (size_t i = dimension; i < paddedDimension; i++) {
+	code[i].code = 0;
+      }
+    }
+
+    template <typename T>
+    void quantizeQuery(const T *v, qint8 *query) {
+      quantize(v, query);
+      if (isKeepingOriginals()) {
+	copyOriginal(v, getOriginal(query));
+      }
+    }
+
+    // the original is appended to the repository of the originals.
+    template <typename T>
+    void quantizePersistent(const T *v, qint8 *code) {
+      quantize(v, code);
+      if (isKeepingOriginals()) {
+	std::vector<float> original(paddedDimension);
+	copyOriginal(v, original.data());
+	setSlot(code, originals->append(original.data()));
+      }
+    }
+
+    // convert the query to the indexed object.
+    void persist(const qint8 *query, qint8 *code) {
+      memcpy(code, query, paddedDimension * sizeof(qint8));
+      if (isKeepingOriginals()) {
+	setSlot(code, originals->append(getOriginal(query)));
+      }
+    }
+
+    // the indexed object is dequantized. the original is returned when it is kept.
+    template <typename T>
+    void dequantize(const qint8 *code, T *v) {
+      if (isKeepingOriginals()) {
+	const float *original = getStoredOriginal(code);
+	for (size_t i = 0; i < dimension; i++) {
+	  v[i] = original[i];
+	}
+	return;
+      }
+      for (size_t i = 0; i < dimension; i++) {
+	v[i] = offset[i] + scale[i] * code[i].code;
+      }
+    }
+
+    float *getOriginal(const qint8 *query) {
+      return reinterpret_cast<float*>(const_cast<qint8*>(query) + paddedDimension);
+    }
+
+    const float *getStoredOriginal(const qint8 *code) {
+      Slot slot;
+      memcpy(&slot, code + paddedDimension, sizeof(Slot));
+      return originals->get(slot);
+    }
+
+    OriginalRepository &getOriginals() { return *originals; }
+
+    const float *getOffset() { return offset.data(); }
+    const float *getScale() { return scale.data(); }
+
+    void serialize(const std::string &ofile) {
+      std::ofstream os(ofile);
+      if (!os.is_open()) {
+	std::stringstream msg;
+	msg << "ScalarQuantizer::serialize: Cannot open the specified file. " << ofile;
+	NGTThrowException(msg);
+      }
+      NGT::Serializer::write(os, offset);
+      NGT::Serializer::write(os, scale);
+    }
+
+    void deserialize(const std::string &ifile) {
+      std::ifstream is(ifile);
+      if (!is.is_open()) {
+	return;
+      }
+      std::vector<float> o, s;
+      NGT::Serializer::read(is, o);
+      NGT::Serializer::read(is, s);
+      if (o.size() != paddedDimension || s.size() != paddedDimension) {
+	std::stringstream msg;
+	msg << "ScalarQuantizer::deserialize: Invalid dimension. " << o.size() << ":" << paddedDimension;
+	NGTThrowException(msg);
+      }
+      // the vectors are not reallocated because the comparators refer to them.
+      std::copy(o.begin(), o.end(), offset.begin());
+      std::copy(s.begin(), s.end(), scale.begin());
+      trained = true;
+    }
+
+  protected:
+    template <typename T>
+    void copyOriginal(const T *v, float *original) {
+      for (size_t i = 0; i < dimension; i++) {
+	original[i] = static_cast<float>(v[i]);
+      }
+      for (size_t i = dimension; i < paddedDimension; i++) {
+	original[i] = 0.0;
+      }
+    }
+
+    void setSlot(qint8 *code, Slot slot) {
+      memcpy(code + paddedDimension, &slot, sizeof(Slot));
+    }
+
+    const size_t	dimension;
+    const size_t	paddedDimension;
+    bool		trained;
+    std::vector<float>	offset;
+    std::vector<float>	scale;
+    std::vector<float>	minimum;
+    std::vector<float>	maximum;
+    std::unique_ptr<OriginalRepository>	originals;	// only when the originals are kept.
+  };
+
+} // namespace NGT
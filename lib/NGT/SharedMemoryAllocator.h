@@ -161,6 +161,18 @@ class SharedMemoryAllocator {
   void setEntry(void *entry) {
 #ifdef MMAP_MANAGER
     mmanager->setEntryHook(entry);
+#endif
+  }
+  void advise(int advice) {
+#ifdef MMAP_MANAGER
+    mmanager->advise(advice);
+#endif
+  }
+  size_t prefault(size_t threadSize = 0) {
+#ifdef MMAP_MANAGER
+    return mmanager->prefault(threadSize);
+#else
+    return 0;
 #endif
   }
   void *getAddr(off_t oft) { 
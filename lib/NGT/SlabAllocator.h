@@ -0,0 +1,320 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include	<vector>
+#include	<set>
+#include	<mutex>
+#include	<utility>
+#include	<new>
+#include	<cstdint>
+#include	<cstdlib>
+#include	<sys/mman.h>
+
+namespace NGT {
+
+  // Slab hands out the blocks of the size classes from 32 bytes to 16KB. each power of two range of the sizes
+  // is divided into four classes, so that a block wastes at most a quarter of it.
+  // the blocks of a class are cut out of the chunks of the class without any headers, and the freed blocks
+  // are reused by the same class, so that the small blocks which are frequently reallocated are not fragmented.
+  // each thread keeps the free blocks of each class in its own list, and moves them from and to the class
+  // in batches, so that the threads which insert the edges in parallel rarely take the lock of the class.
+  // each chunk counts its blocks which are out of the class, and is released when all of them come back to
+  // the class. one empty chunk is kept for each class, so that a class does not allocate and release a chunk
+  // repeatedly at the boundary. the blocks are cut out of the chunk at the lowest address first, so that
+  // the chunks at the higher addresses are likely to be emptied.
+  // the larger blocks are allocated with the operator new.
+  class Slab {
+  public:
+    static const size_t minBlockShift = 5;
+    static const size_t maxBlockShift = 14;
+    static const size_t classSize = (maxBlockShift - minBlockShift) * 4 + 1;
+    static const size_t minChunkSize = 64 * 1024;
+    static const size_t maxChunkSize = 64 * 1024 * 1024;
+    static const size_t batchByteSize = 8 * 1024;
+
+    // the slab is not destructed, because the blocks may be freed by the destructors of the static objects.
+    static Slab &get() {
+      static Slab *slab = new Slab;
+      return *slab;
+    }
+
+    // returns the size of the block which is actually allocated for the specified size.
+    static size_t getBlockSize(size_t size) {
+      if (size > (static_cast<size_t>(1) << maxBlockShift)) {
+	return size;
+      }
+      return getClassBlockSize(getClass(size));
+    }
+
+    void *allocate(size_t size) {
+      if (size > (static_cast<size_t>(1) << maxBlockShift)) {
+	return ::operator new(size);
+      }
+      size_t c = getClass(size);
+      ThreadCache &cache = getThreadCache();
+      if (cache.released) {
+	FreeList list;
+	classes[c].allocate(list, 1);
+	return list.pop();
+      }
+      FreeList &list = cache.lists[c];
+      if (list.size == 0) {
+	classes[c].allocate(list, getBatchSize(c));
+      }
+      return list.pop();
+    }
+
+    void deallocate(void *block, size_t size) {
+      if (size > (static_cast<size_t>(1) << maxBlockShift)) {
+	::operator delete(block);
+	return;
+      }
+      size_t c = getClass(size);
+      ThreadCache &cache = getThreadCache();
+      if (cache.released) {
+	FreeList list;
+	list.push(block);
+	classes[c].deallocate(list, 1);
+	return;
+      }
+      FreeList &list = cache.lists[c];
+      list.push(block);
+      if (list.size > getBatchSize(c) * 2) {
+	classes[c].deallocate(list, getBatchSize(c));
+      }
+    }
+
+  protected:
+    // the free blocks are linked through their first bytes.
+    class FreeList {
+    public:
+      void push(void *block) {
+	*static_cast<void**>(block) = head;
+	head = block;
+	size++;
+      }
+      void *pop() {
+	void *block = head;
+	head = *static_cast<void**>(block);
+	size--;
+	return block;
+      }
+      void	*head = 0;
+      size_t	size = 0;
+    };
+
+    // the header of a chunk is placed at its head, so that the chunk of a block is the nearest one below it.
+    class Chunk {
+    public:
+      Chunk(size_t size):next(getBlocks()), end(reinterpret_cast<uint8_t*>(this) + size), used(0) {}
+      uint8_t *getBlocks() { return reinterpret_cast<uint8_t*>(this) + headerSize; }
+      size_t getSize() { return end - reinterpret_cast<uint8_t*>(this); }
+      // the chunk has no block for the class.
+      bool isExhausted(size_t blockSize) { return freeBlocks.size == 0 && next + blockSize > end; }
+      void *pop(size_t blockSize) {
+	used++;
+	if (freeBlocks.size != 0) {
+	  return freeBlocks.pop();
+	}
+	void *block = next;
+	next += blockSize;
+	return block;
+      }
+      void push(void *block) {
+	used--;
+	freeBlocks.push(block);
+      }
+      // all of the blocks are free again.
+      void reset() {
+	next = getBlocks();
+	freeBlocks = FreeList();
+      }
+      static const size_t headerSize = 64;
+      uint8_t	*next;
+      uint8_t	*end;
+      FreeList	freeBlocks;
+      size_t	used;
+    };
+
+    class SizeClass {
+    public:
+      SizeClass():blockSize(0), chunkByteSize(0), spare(0) {}
+
+      // moves the specified number of the free blocks into the list.
+      void allocate(FreeList &list, size_t n) {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t i = 0; i < n; i++) {
+	  if (availableChunks.empty()) {
+	    Chunk *chunk = spare != 0 ? spare : createChunk();
+	    if (chunk == 0) {
+	      if (i != 0) {
+		return;
+	      }
+	      throw std::bad_alloc();
+	    }
+	    spare = 0;
+	    availableChunks.insert(chunk);
+	  }
+	  Chunk *chunk = *availableChunks.begin();
+	  list.push(chunk->pop(blockSize));
+	  if (chunk->isExhausted(blockSize)) {
+	    availableChunks.erase(availableChunks.begin());
+	  }
+	}
+      }
+
+      // moves the specified number of the blocks of the list back to the class.
+      void deallocate(FreeList &list, size_t n) {
+	std::lock_guard<std::mutex> lock(mutex);
+	Chunk *chunk = 0;
+	for (size_t i = 0; i < n && list.size != 0; i++) {
+	  void *block = list.pop();
+	  // the blocks of a batch are often in the same chunk.
+	  if (chunk == 0 || block < chunk || block >= chunk->end) {
+	    chunk = *--chunks.upper_bound(static_cast<Chunk*>(block));
+	  }
+	  bool exhausted = chunk->isExhausted(blockSize);
+	  chunk->push(block);
+	  if (chunk->used == 0) {
+	    availableChunks.erase(chunk);
+	    releaseChunk(chunk);
+	    chunk = 0;
+	  } else if (exhausted) {
+	    availableChunks.insert(chunk);
+	  }
+	}
+      }
+
+      // the size of a new chunk is the total size of the chunks of the class, so that the number of the chunks
+      // grows logarithmically.
+      Chunk *createChunk() {
+	size_t size = chunkByteSize < minChunkSize ? minChunkSize : chunkByteSize > maxChunkSize ? maxChunkSize : chunkByteSize;
+	// the chunks are mapped directly, so that the released ones are surely returned to the system.
+	void *address = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (address == MAP_FAILED) {
+	  return 0;
+	}
+	Chunk *chunk = new(address) Chunk(size);
+	chunks.insert(chunk);
+	chunkByteSize += size;
+	return chunk;
+      }
+
+      // the smaller one of the empty chunk and the spare is kept as the spare.
+      void releaseChunk(Chunk *chunk) {
+	chunk->reset();
+	if (spare == 0) {
+	  spare = chunk;
+	  return;
+	}
+	if (chunk->getSize() < spare->getSize()) {
+	  std::swap(chunk, spare);
+	}
+	size_t size = chunk->getSize();
+	chunks.erase(chunk);
+	chunkByteSize -= size;
+	munmap(chunk, size);
+      }
+
+      size_t		blockSize;
+      size_t		chunkByteSize;
+      std::set<Chunk*>	chunks;
+      // the chunks which have any blocks for the class except the spare.
+      std::set<Chunk*>	availableChunks;
+      Chunk		*spare;
+      std::mutex	mutex;
+    };
+
+    // the cache is trivially destructible, so that the blocks which are freed by the destructors of the static
+    // objects after the releaser of the thread is destructed are directly returned to the classes.
+    class ThreadCache {
+    public:
+      FreeList	lists[classSize];
+      bool	released = false;
+    };
+    class ThreadCacheReleaser {
+    public:
+      ThreadCacheReleaser(ThreadCache &c):cache(c) {}
+      ~ThreadCacheReleaser() {
+	for (size_t c = 0; c < classSize; c++) {
+	  Slab::get().classes[c].deallocate(cache.lists[c], cache.lists[c].size);
+	}
+	cache.released = true;
+      }
+      ThreadCache &cache;
+    };
+    static ThreadCache &getThreadCache() {
+      static thread_local ThreadCache cache;
+      static thread_local ThreadCacheReleaser releaser(cache);
+      return releaser.cache;
+    }
+
+    Slab() {
+      static_assert(sizeof(Chunk) <= Chunk::headerSize, "Slab: The chunk header is too large.");
+      for (size_t c = 0; c < classSize; c++) {
+	classes[c].blockSize = getClassBlockSize(c);
+      }
+    }
+
+    // the number of the blocks which are moved at once between a thread and a class.
+    static size_t getBatchSize(size_t c) {
+      size_t n = batchByteSize / getClassBlockSize(c);
+      return n < 2 ? 2 : n;
+    }
+
+    // the sizes in (2^shift, 2^(shift+1)] are rounded up to the multiple of 2^(shift-2).
+    static size_t getClass(size_t size) {
+      if (size <= (static_cast<size_t>(1) << minBlockShift)) {
+	return 0;
+      }
+      size_t shift = 63 - __builtin_clzll(size - 1);
+      size_t step = static_cast<size_t>(1) << (shift - 2);
+      size_t k = (size - (static_cast<size_t>(1) << shift) + step - 1) / step;
+      return 1 + (shift - minBlockShift) * 4 + k - 1;
+    }
+    static size_t getClassBlockSize(size_t c) {
+      if (c == 0) {
+	return static_cast<size_t>(1) << minBlockShift;
+      }
+      size_t shift = minBlockShift + (c - 1) / 4;
+      size_t k = (c - 1) % 4 + 1;
+      return (static_cast<size_t>(1) << shift) + k * (static_cast<size_t>(1) << (shift - 2));
+    }
+
+    SizeClass	classes[classSize];
+  };
+
+  // SlabAllocator is the allocator of the containers whose elements are in the slab.
+  template <typename TYPE>
+  class SlabAllocator {
+  public:
+    typedef TYPE value_type;
+    SlabAllocator() {}
+    template <typename T> SlabAllocator(const SlabAllocator<T> &a) {}
+    TYPE *allocate(size_t n) { return static_cast<TYPE*>(Slab::get().allocate(n * sizeof(TYPE))); }
+    void deallocate(TYPE *p, size_t n) { Slab::get().deallocate(p, n * sizeof(TYPE)); }
+    // returns the number of the elements which fit in the block for the specified number of the elements.
+    static size_t getCapacity(size_t n) { return Slab::getBlockSize(n * sizeof(TYPE)) / sizeof(TYPE); }
+  };
+
+  template <typename T1, typename T2>
+  bool operator==(const SlabAllocator<T1> &a1, const SlabAllocator<T2> &a2) { return true; }
+  template <typename T1, typename T2>
+  bool operator!=(const SlabAllocator<T1> &a1, const SlabAllocator<T2> &a2) { return false; }
+
+} // namespace NGT
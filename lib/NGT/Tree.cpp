@@ -20,6 +20,12 @@
 #include	"NGT/Node.h"
 
 #include	<vector>
+#include	<algorithm>
+#include	<cfloat>
+
+#ifdef _OPENMP
+#include	<omp.h>
+#endif
 
 using namespace std;
 using namespace NGT;
@@ -411,8 +417,8 @@ DVPTree::search(SearchContainer &sc, InternalNode &node, UncheckedNode &unchecke
 
   int bsize = internalChildrenSize - 1;
 
-  vector<ObjectDistance> regions;
-  regions.reserve(internalChildrenSize);
+  ObjectDistance regions[internalChildrenSize];
+  size_t regionSize = 0;
 
   ObjectDistance child;
 #if defined(NGT_SHARED_MEMORY_ALLOCATOR)
@@ -425,7 +431,7 @@ DVPTree::search(SearchContainer &sc, InternalNode &node, UncheckedNode &unchecke
     if (d < borders[mid]) {
         child.id = mid;
         child.distance = 0.0;
-        regions.push_back(child);
+        regions[regionSize++] = child;
       if (d + sc.radius < borders[mid]) {
         break;
       } else {
@@ -435,7 +441,7 @@ DVPTree::search(SearchContainer &sc, InternalNode &node, UncheckedNode &unchecke
       if (d < borders[mid] + sc.radius) {
         child.id = mid;
         child.distance = d - borders[mid];
-        regions.push_back(child);
+        regions[regionSize++] = child;
         continue;
       } else {
         continue;
@@ -447,15 +453,15 @@ DVPTree::search(SearchContainer &sc, InternalNode &node, UncheckedNode &unchecke
     if (d >= borders[mid - 1]) {
       child.id = mid;
       child.distance = 0.0;
-      regions.push_back(child);
+      regions[regionSize++] = child;
     } else {
       child.id = mid;
       child.distance = borders[mid - 1] - d;
-      regions.push_back(child);
+      regions[regionSize++] = child;
     }
   }
 
-  sort(regions.begin(), regions.end());
+  sort(regions, regions + regionSize);
 
 #if defined(NGT_SHARED_MEMORY_ALLOCATOR)
   Node::ID *children = node.getChildren(internalNodes.allocator);
@@ -463,17 +469,16 @@ DVPTree::search(SearchContainer &sc, InternalNode &node, UncheckedNode &unchecke
   Node::ID *children = node.getChildren();
 #endif
 
-  vector<ObjectDistance>::iterator i;
   if (sc.mode == DVPTree::SearchContainer::SearchLeaf) {
-    if (children[regions.front().id].getType() == Node::ID::Leaf) {
-      sc.nodeID.setRaw(children[regions.front().id].get());
+    if (children[regions[0].id].getType() == Node::ID::Leaf) {
+      sc.nodeID.setRaw(children[regions[0].id].get());
       assert(uncheckedNode.empty());
     } else {
-      uncheckedNode.push(children[regions.front().id]);
+      uncheckedNode.push(children[regions[0].id]);
     }
   } else {
-    for (i = regions.begin(); i != regions.end(); i++) {
-      uncheckedNode.push(children[i->id]);
+    for (size_t i = 0; i < regionSize; i++) {
+      uncheckedNode.push(children[regions[i].id]);
     }
   }
   
@@ -540,7 +545,10 @@ DVPTree::search(SearchContainer &sc) {
     }
   }
 
-  UncheckedNode uncheckedNode;
+  static thread_local UncheckedNode uncheckedNode;
+  while (!uncheckedNode.empty()) {
+    uncheckedNode.pop();
+  }
   uncheckedNode.push(root->id);
 
   while (!uncheckedNode.empty()) {
@@ -562,3 +570,252 @@ DVPTree::search(SearchContainer &sc) {
   }
 }
 
+
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+
+// A range of the objects that is turned into a node by the bulk loading.
+class BulkLoadSegment {
+public:
+  BulkLoadSegment(size_t b, size_t e, Node::ID p, size_t c):begin(b), end(e), parent(p), child(c), pivot(0) {}
+  size_t	begin;
+  size_t	end;
+  Node::ID	parent;
+  size_t	child;
+  ObjectID	pivot;
+};
+
+// select the pivot with the maximum distance variance among the sampled objects of the segment.
+static ObjectID
+selectBulkLoadPivot(DVPTree &tree, vector<ObjectDistance> &objects, BulkLoadSegment &segment)
+{
+  size_t size = segment.end - segment.begin;
+  if (size <= tree.leafObjectsSize) {
+    // the first object is the pivot of a leaf, which is the nearest to the parent pivot.
+    return objects[segment.begin].id;
+  }
+  size_t ssize = std::min(size, tree.leafObjectsSize + 1);
+  vector<Object*> sample(ssize);
+  for (size_t i = 0; i < ssize; i++) {
+    sample[i] = tree.getObjectRepository().get(objects[segment.begin + i * size / ssize].id);
+  }
+  NGT::ObjectSpace::Comparator &comparator = tree.objectSpace->getComparator();
+  vector<Distance> distance(ssize * ssize, 0.0);
+  for (size_t i = 0; i < ssize; i++) {
+    for (size_t j = i + 1; j < ssize; j++) {
+      Distance d = comparator(*sample[i], *sample[j]);
+      distance[i * ssize + j] = d;
+      distance[j * ssize + i] = d;
+    }
+  }
+  double maxv = -1.0;
+  size_t maxid = 0;
+  for (size_t i = 0; i < ssize; i++) {
+    double avg = 0.0;
+    for (size_t j = 0; j < ssize; j++) {
+      avg += distance[i * ssize + j];
+    }
+    avg /= (double)ssize;
+    double v = 0.0;
+    for (size_t j = 0; j < ssize; j++) {
+      v += pow(distance[i * ssize + j] - avg, 2.0);
+    }
+    if (v > maxv) {
+      maxv = v;
+      maxid = i;
+    }
+  }
+  return objects[segment.begin + maxid * size / ssize].id;
+}
+
+// compute the distances from the pivot and sort the segment by them. the pivot comes first.
+static void
+sortBulkLoadSegment(DVPTree &tree, vector<ObjectDistance> &objects, BulkLoadSegment &segment, size_t threadSize)
+{
+  NGT::ObjectSpace::Comparator &comparator = tree.objectSpace->getComparator();
+  ObjectRepository &repository = tree.getObjectRepository();
+  Object &pivot = *repository.get(segment.pivot);
+  int64_t begin = segment.begin;
+  int64_t end = segment.end;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1024) num_threads(threadSize)
+#endif
+  for (int64_t i = begin; i < end; i++) {
+    objects[i].distance = objects[i].id == segment.pivot ? -1.0 : comparator(pivot, *repository.get(objects[i].id));
+  }
+  size_t size = end - begin;
+  size_t chunks = threadSize;
+  if (chunks <= 1 || size < chunks * 1024) {
+    std::sort(objects.begin() + begin, objects.begin() + end);
+  } else {
+    vector<size_t> bounds(chunks + 1);
+    for (size_t c = 0; c <= chunks; c++) {
+      bounds[c] = begin + size * c / chunks;
+    }
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threadSize)
+#endif
+    for (size_t c = 0; c < chunks; c++) {
+      std::sort(objects.begin() + bounds[c], objects.begin() + bounds[c + 1]);
+    }
+    for (size_t width = 1; width < chunks; width *= 2) {
+      size_t merges = (chunks + 2 * width - 1) / (2 * width);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threadSize)
+#endif
+      for (size_t m = 0; m < merges; m++) {
+	size_t c = m * 2 * width;
+	if (c + width < chunks) {
+	  std::inplace_merge(objects.begin() + bounds[c], objects.begin() + bounds[c + width],
+			     objects.begin() + bounds[std::min(c + 2 * width, chunks)]);
+	}
+      }
+    }
+  }
+  objects[begin].distance = 0.0;
+}
+
+void
+DVPTree::bulkLoad(vector<ObjectID> &ids, size_t threadSize)
+{
+  if (!isEmpty()) {
+    NGTThrowException("DVPTree::bulkLoad: The tree is not empty.");
+  }
+  if (ids.empty()) {
+    return;
+  }
+#ifdef _OPENMP
+  if (threadSize == 0) {
+    threadSize = omp_get_max_threads();
+  }
+#endif
+  threadSize = threadSize == 0 ? 1 : threadSize;
+  ObjectRepository &repository = getObjectRepository();
+  vector<ObjectDistance> objects(ids.size());
+  for (size_t i = 0; i < ids.size(); i++) {
+    objects[i].set(ids[i], 0.0);
+  }
+  // the root is rebuilt. the ID of the removed root leaf is reused when the root is a leaf.
+  removeNode(getRootNode()->id);
+
+  // the segments larger than this are processed one by one with all of the threads.
+  size_t largeSegmentSize = std::max(static_cast<size_t>(8192), objects.size() / (4 * threadSize));
+  vector<BulkLoadSegment> segments;
+  segments.push_back(BulkLoadSegment(0, objects.size(), Node::ID(), 0));
+  while (!segments.empty()) {
+    vector<size_t> largeSegments;
+    vector<size_t> smallSegments;
+    for (size_t si = 0; si < segments.size(); si++) {
+      if (segments[si].end - segments[si].begin > largeSegmentSize) {
+	largeSegments.push_back(si);
+      } else {
+	smallSegments.push_back(si);
+      }
+    }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(threadSize)
+#endif
+    for (size_t si = 0; si < segments.size(); si++) {
+      segments[si].pivot = selectBulkLoadPivot(*this, objects, segments[si]);
+    }
+    for (size_t i = 0; i < largeSegments.size(); i++) {
+      sortBulkLoadSegment(*this, objects, segments[largeSegments[i]], threadSize);
+    }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(threadSize)
+#endif
+    for (size_t i = 0; i < smallSegments.size(); i++) {
+      sortBulkLoadSegment(*this, objects, segments[smallSegments[i]], 1);
+    }
+
+    vector<BulkLoadSegment> nextSegments;
+    for (size_t si = 0; si < segments.size(); si++) {
+      BulkLoadSegment &segment = segments[si];
+      // skip the objects identical to the pivot.
+      size_t begin = segment.begin + 1;
+      while (begin < segment.end && objects[begin].distance == 0.0 &&
+	     objects[begin].id != segment.pivot) {
+	begin++;
+      }
+      begin--;
+      objects[begin].set(segment.pivot, 0.0);
+      size_t size = segment.end - begin;
+      Node::ID nid;
+      if (size <= leafObjectsSize) {
+	LeafNode *ln = new LeafNode;
+	ln->setPivot(*repository.get(segment.pivot), *objectSpace);
+	ln->parent = segment.parent;
+	for (size_t i = begin; i < segment.end; i++) {
+	  bool identical = false;
+	  for (size_t j = 0; j < ln->getObjectSize() && !identical; j++) {
+	    if (ln->getObjectIDs()[j].distance == objects[i].distance) {
+	      identical = objectSpace->getComparator()(*repository.get(objects[i].id),
+						       *repository.get(ln->getObjectIDs()[j].id)) == 0.0;
+	    }
+	  }
+	  if (identical) {
+	    continue;
+	  }
+#ifdef NGT_NODE_USE_VECTOR
+	  LeafNode::ObjectIDs fid;
+	  fid.id = objects[i].id;
+	  fid.distance = objects[i].distance;
+	  ln->objectIDs.push_back(fid);
+#else
+	  ln->getObjectIDs()[ln->objectSize].id = objects[i].id;
+	  ln->getObjectIDs()[ln->objectSize++].distance = objects[i].distance;
+#endif
+	}
+	insertNode(ln);
+	nid = ln->id;
+      } else {
+	// divide the objects into the child clusters in the same way as the split.
+	int childrenSize = internalChildrenSize;
+	vector<size_t> starts(childrenSize + 1, begin);
+	int cid = childrenSize - 1;
+	size_t cms = (size * cid) / childrenSize;
+	starts[childrenSize] = segment.end;
+	for (size_t i = size - 1; i > 0; i--) {
+	  if (i - 1 < cms && cid > 0 && objects[begin + i - 1].distance != objects[begin + i].distance) {
+	    starts[cid] = begin + i;
+	    cid--;
+	    cms = (size * cid) / childrenSize;
+	  }
+	}
+	int clusterSize = childrenSize - cid;
+	if (clusterSize == 1) {
+	  stringstream msg;
+	  msg << "DVPTree::bulkLoad: All of the object distances are the same! Size=" << size;
+	  NGTThrowException(msg);
+	}
+	InternalNode *in = createInternalNode();
+	in->setPivot(*repository.get(segment.pivot), *objectSpace);
+	in->parent = segment.parent;
+	for (int c = 0; c < childrenSize; c++) {
+	  if (c < clusterSize) {
+	    nextSegments.push_back(BulkLoadSegment(starts[cid + c], starts[cid + c + 1], in->id, c));
+	    if (c < childrenSize - 1) {
+	      in->getBorders()[c] = c == clusterSize - 1 ? FLT_MAX : objects[starts[cid + c + 1]].distance;
+	    }
+	  } else {
+	    // dummy
+	    LeafNode *ln = new LeafNode;
+	    ln->setPivot(*repository.get(segment.pivot), *objectSpace);
+	    ln->parent = in->id;
+	    insertNode(ln);
+	    in->getChildren()[c] = ln->id;
+	    if (c < childrenSize - 1) {
+	      in->getBorders()[c] = FLT_MAX;
+	    }
+	  }
+	}
+	nid = in->id;
+      }
+      if (segment.parent.getID() != 0) {
+	internalNodes.get(segment.parent.getID())->getChildren()[segment.child] = nid;
+      }
+    }
+    segments.swap(nextSegments);
+  }
+}
+
+#endif
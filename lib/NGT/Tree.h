@@ -112,6 +112,8 @@ namespace NGT {
       // If no file, then create a new file.
       leafNodes.open(f + "l", sharedMemorySize);
       internalNodes.open(f + "i", sharedMemorySize);
+      leafNodes.getAllocator().advise(MADV_WILLNEED);
+      internalNodes.getAllocator().advise(MADV_WILLNEED);
       if (leafNodes.size() == 0) {
 	if (internalNodes.size() != 0) {
           NGTThrowException("Tree::Open: Internal error. Internal and leaf are inconsistent.");
@@ -132,7 +134,18 @@ namespace NGT {
 
     void insertObject(InsertContainer &obj, LeafNode &leaf);
 
-    typedef std::stack<Node::ID> UncheckedNode;
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+    // build the tree top down from all of the specified objects at once. the tree should be empty.
+    // the objects identical to the other objects are not inserted as the insertion does.
+    void bulkLoad(std::vector<ObjectID> &ids, size_t threadSize = 0);
+#endif
+
+    bool isEmpty() {
+      Node *root = getRootNode();
+      return root->id.getType() == Node::ID::Leaf && static_cast<LeafNode*>(root)->getObjectSize() == 0;
+    }
+
+    typedef std::stack<Node::ID, std::vector<Node::ID> > UncheckedNode;
 
     void search(SearchContainer &so);
     void search(SearchContainer &so, InternalNode &node, UncheckedNode &uncheckedNode);
@@ -200,6 +213,27 @@ namespace NGT {
       return;
     }
 
+#if !defined(NGT_SHARED_MEMORY_ALLOCATOR)
+    // replace the object IDs in the leaves with the reordered IDs. newIDs[id] is the new ID of id.
+    void replaceObjectIDs(const std::vector<ObjectID> &newIDs) {
+      for (size_t i = 0; i < leafNodes.size(); i++) {
+	if (leafNodes[i] == 0) {
+	  continue;
+	}
+	LeafNode &ln = *leafNodes[i];
+	for (size_t oi = 0; oi < ln.getObjectSize(); oi++) {
+	  ObjectID &id = ln.getObjectIDs()[oi].id;
+	  if (id >= newIDs.size() || newIDs[id] == 0) {
+	    std::stringstream msg;
+	    msg << "DVPTree::replaceObjectIDs: The leaf has an object that is not reordered. " << id;
+	    NGTThrowException(msg);
+	  }
+	  id = newIDs[id];
+	}
+      }
+    }
+#endif
+
     void removeNaively(ObjectID id, ObjectID replaceId = 0) {
       for (size_t i = 0; i < leafNodes.size(); i++) {
 	if (leafNodes[i] != 0) {
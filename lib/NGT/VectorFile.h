@@ -0,0 +1,251 @@
+//
+// Copyright (C) 2015-2020 Yahoo Japan Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include	<string>
+#include	<cstring>
+#include	<stdint.h>
+#include	<fcntl.h>
+#include	<unistd.h>
+#include	<sys/mman.h>
+#include	<sys/stat.h>
+
+#include	"Common.h"
+
+namespace NGT {
+
+  // VectorFile maps a binary file of vectors into memory so that the vectors are read without parsing.
+  // The format is determined by the extension of the file. The data should be little endian.
+  //   .fvecs .bvecs .ivecs : each vector is preceded by its dimension as a 4 byte integer.
+  //   .npy                 : two dimensional C order array of float32, float64, int32 or uint8.
+  //   .fbin .u8bin .ibin   : the number of vectors and the dimension as 4 byte integers precede the vectors.
+  //   .f32 .f64 .i32 .u8   : the vectors without any header. The dimension should be specified.
+  class VectorFile {
+  public:
+    enum ElementType {
+      ElementTypeNone	= 0,
+      ElementTypeUint8	= 1,
+      ElementTypeInt32	= 2,
+      ElementTypeFloat	= 3,
+      ElementTypeDouble	= 4
+    };
+
+    VectorFile():address(0), fileSize(0), offset(0), recordSize(0), headerSize(0), dimension(0), numberOfVectors(0),
+      elementType(ElementTypeNone) {}
+    ~VectorFile() { close(); }
+
+    static bool isBinary(const std::string &file) {
+      std::string ext = getExtension(file);
+      return ext == "fvecs" || ext == "bvecs" || ext == "ivecs" || ext == "npy" ||
+	ext == "fbin" || ext == "u8bin" || ext == "ibin" ||
+	ext == "f32" || ext == "f64" || ext == "i32" || ext == "u8";
+    }
+
+    // the dimension is necessary only for the files without any header.
+    void open(const std::string &file, size_t dim = 0) {
+      close();
+      map(file);
+      std::string ext = getExtension(file);
+      if (ext == "fvecs" || ext == "bvecs" || ext == "ivecs") {
+	elementType = ext == "fvecs" ? ElementTypeFloat : ext == "bvecs" ? ElementTypeUint8 : ElementTypeInt32;
+	dimension = readInt32(0);
+	headerSize = sizeof(int32_t);
+	recordSize = headerSize + dimension * getSizeOfElement();
+      } else if (ext == "npy") {
+	readNpyHeader();
+	recordSize = dimension * getSizeOfElement();
+      } else if (ext == "fbin" || ext == "u8bin" || ext == "ibin") {
+	elementType = ext == "fbin" ? ElementTypeFloat : ext == "u8bin" ? ElementTypeUint8 : ElementTypeInt32;
+	numberOfVectors = readInt32(0);
+	dimension = readInt32(sizeof(int32_t));
+	offset = 2 * sizeof(int32_t);
+	recordSize = dimension * getSizeOfElement();
+      } else if (ext == "f32" || ext == "f64" || ext == "i32" || ext == "u8") {
+	elementType = ext == "f32" ? ElementTypeFloat : ext == "f64" ? ElementTypeDouble :
+	  ext == "i32" ? ElementTypeInt32 : ElementTypeUint8;
+	dimension = dim;
+	recordSize = dimension * getSizeOfElement();
+      } else {
+	close();
+	NGTThrowException("VectorFile: Unknown format. " + file);
+      }
+      if (dimension == 0 || recordSize == 0) {
+	close();
+	NGTThrowException("VectorFile: The dimension is not specified or is invalid. " + file);
+      }
+      size_t size = (fileSize - offset) / recordSize;
+      if (numberOfVectors == 0 || numberOfVectors > size) {
+	if (numberOfVectors > size) {
+	  std::cerr << "VectorFile: Warning! The file is shorter than the header. " << numberOfVectors << ":" << size << std::endl;
+	}
+	numberOfVectors = size;
+      }
+    }
+
+    void close() {
+      if (address != 0) {
+	munmap(address, fileSize);
+      }
+      address = 0;
+      fileSize = offset = recordSize = headerSize = dimension = numberOfVectors = 0;
+      elementType = ElementTypeNone;
+    }
+
+    const void *get(size_t idx) {
+      const uint8_t *record = static_cast<const uint8_t*>(address) + offset + idx * recordSize;
+      if (headerSize != 0) {
+	int32_t dim;
+	memcpy(&dim, record, sizeof(dim));
+	if (static_cast<size_t>(dim) != dimension) {
+	  std::stringstream msg;
+	  msg << "VectorFile: Inconsistent dimension. No." << idx << " " << dim << ":" << dimension;
+	  NGTThrowException(msg);
+	}
+      }
+      return record + headerSize;
+    }
+
+    size_t size() { return numberOfVectors; }
+    size_t getDimension() { return dimension; }
+    ElementType getElementType() { return elementType; }
+    size_t getSizeOfElement() {
+      switch (elementType) {
+      case ElementTypeUint8: return sizeof(uint8_t);
+      case ElementTypeInt32: return sizeof(int32_t);
+      case ElementTypeFloat: return sizeof(float);
+      case ElementTypeDouble: return sizeof(double);
+      default: return 0;
+      }
+    }
+
+  protected:
+    static std::string getExtension(const std::string &file) {
+      size_t pos = file.find_last_of('.');
+      if (pos == std::string::npos || file.find('/', pos) != std::string::npos) {
+	return "";
+      }
+      return file.substr(pos + 1);
+    }
+
+    void map(const std::string &file) {
+      int fd = ::open(file.c_str(), O_RDONLY);
+      if (fd < 0) {
+	NGTThrowException("VectorFile: Cannot open the specified file. " + file);
+      }
+      struct stat st;
+      if (fstat(fd, &st) != 0 || st.st_size == 0) {
+	::close(fd);
+	NGTThrowException("VectorFile: The specified file is empty. " + file);
+      }
+      fileSize = st.st_size;
+      void *addr = mmap(0, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if (addr == MAP_FAILED) {
+	fileSize = 0;
+	NGTThrowException("VectorFile: Cannot map the specified file. " + file);
+      }
+      madvise(addr, fileSize, MADV_SEQUENTIAL);
+      address = addr;
+    }
+
+    int32_t readInt32(size_t pos) {
+      if (pos + sizeof(int32_t) > fileSize) {
+	NGTThrowException("VectorFile: The file is too short.");
+      }
+      int32_t v;
+      memcpy(&v, static_cast<const uint8_t*>(address) + pos, sizeof(v));
+      return v;
+    }
+
+    // the header of npy is the magic string, the version, the length of the header and the python dictionary.
+    void readNpyHeader() {
+      const char *data = static_cast<const char*>(address);
+      if (fileSize < 10 || memcmp(data, "\x93NUMPY", 6) != 0) {
+	NGTThrowException("VectorFile: Not npy format.");
+      }
+      size_t headerLength;
+      if (data[6] == 1) {
+	uint16_t len;
+	memcpy(&len, data + 8, sizeof(len));
+	headerLength = len;
+	offset = 10 + headerLength;
+      } else {
+	uint32_t len;
+	memcpy(&len, data + 8, sizeof(len));
+	headerLength = len;
+	offset = 12 + headerLength;
+      }
+      if (offset > fileSize) {
+	NGTThrowException("VectorFile: The npy header is broken.");
+      }
+      std::string header(data + offset - headerLength, headerLength);
+      std::string descr = getNpyValue(header, "descr");
+      if (descr == "'<f4'") {
+	elementType = ElementTypeFloat;
+      } else if (descr == "'<f8'") {
+	elementType = ElementTypeDouble;
+      } else if (descr == "'<i4'") {
+	elementType = ElementTypeInt32;
+      } else if (descr == "'|u1'" || descr == "'<u1'") {
+	elementType = ElementTypeUint8;
+      } else {
+	NGTThrowException("VectorFile: Not supported npy type. " + descr);
+      }
+      if (getNpyValue(header, "fortran_order") != "False") {
+	NGTThrowException("VectorFile: Fortran order npy is not supported.");
+      }
+      std::string shape = getNpyValue(header, "shape");
+      std::vector<std::string> tokens;
+      NGT::Common::tokenize(shape.substr(1, shape.size() - 2), tokens, ",");
+      for (auto &t : tokens) {
+	t.erase(0, t.find_first_not_of(' '));
+      }
+      if (!tokens.empty() && tokens.back().empty()) {
+	tokens.pop_back();
+      }
+      if (tokens.size() != 2) {
+	NGTThrowException("VectorFile: Only two dimensional npy is supported. " + shape);
+      }
+      numberOfVectors = NGT::Common::strtol(tokens[0]);
+      dimension = NGT::Common::strtol(tokens[1]);
+    }
+
+    static std::string getNpyValue(const std::string &header, const std::string &key) {
+      size_t pos = header.find("'" + key + "'");
+      if (pos == std::string::npos) {
+	NGTThrowException("VectorFile: Not found in the npy header. " + key);
+      }
+      pos = header.find(':', pos);
+      if (pos == std::string::npos) {
+	NGTThrowException("VectorFile: The npy header is broken.");
+      }
+      pos = header.find_first_not_of(' ', pos + 1);
+      size_t end = header[pos] == '(' ? header.find(')', pos) + 1 : header.find(',', pos);
+      return header.substr(pos, end - pos);
+    }
+
+    void	*address;
+    size_t	fileSize;
+    size_t	offset;		// the offset of the first vector.
+    size_t	recordSize;
+    size_t	headerSize;	// the size of the header of each vector.
+    size_t	dimension;
+    size_t	numberOfVectors;
+    ElementType	elementType;
+  };
+
+} // namespace NGT
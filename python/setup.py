@@ -3,6 +3,9 @@ import os
 import sys
 import json
 import glob
+import platform
+import sysconfig
+import subprocess
 import setuptools
 
 static_library_option = '--static-library'
@@ -37,6 +40,21 @@ if static_library or included_library:
 
 basedir = os.path.abspath(os.path.dirname(__file__))
 
+# The distance functions for AVX2 and AVX-512 are selected at runtime only with GCC on x86-64
+# as in CMakeLists.txt. Otherwise -march=native is used as before.
+def is_runtime_dispatch_available():
+    if platform.machine() not in ('x86_64', 'AMD64', 'amd64'):
+        return False
+    compiler = os.environ.get('CC') or sysconfig.get_config_var('CC') or 'cc'
+    try:
+        output = subprocess.check_output(compiler.split()[:1] + ['--version'], stderr=subprocess.STDOUT)
+    except (OSError, subprocess.CalledProcessError):
+        return False
+    output = output.decode('utf-8', 'replace').lower()
+    return 'clang' not in output and ('gcc' in output or 'free software foundation' in output)
+
+march_native_args = [] if is_runtime_dispatch_available() else ['-march=native']
+
 with open('README.md', 'r', encoding='utf-8') as fh:
     long_description = fh.read()
 
@@ -60,7 +78,7 @@ if sys.version_info.major >= 3:
             'include_dirs': ['/usr/local/include', 
                             os.path.dirname(locations.distutils_scheme('pybind11')['headers']),
                             os.path.dirname(locations.distutils_scheme('pybind11', True)['headers'])],
-            'extra_compile_args': ['-std=c++11', '-Ofast', '-fopenmp', '-lrt', '-DNDEBUG'],
+            'extra_compile_args': ['-std=c++11', '-Ofast', '-fopenmp'] + march_native_args + ['-lrt', '-DNDEBUG'],
             'sources': ['src/ngtpy.cpp']
         }
     else:
@@ -68,7 +86,7 @@ if sys.version_info.major >= 3:
             'include_dirs': ['/usr/local/include', 
                             os.path.dirname(locations.distutils_scheme('pybind11')['headers']),
                             os.path.dirname(locations.distutils_scheme('pybind11', True)['headers'])],
-            'extra_compile_args': ['-std=c++11', '-Ofast', '-fopenmp', '-march=native', '-lrt', '-DNDEBUG'],
+            'extra_compile_args': ['-std=c++11', '-Ofast', '-fopenmp'] + march_native_args + ['-lrt', '-DNDEBUG'],
             'sources': ['src/ngtpy.cpp']
         }
 
@@ -35,6 +35,7 @@ public:
     numOfDistanceComputations = 0;
     numOfSearchObjects = 10;
     searchRadius = FLT_MAX;
+    queryObject = 0;
     if (logDisabled) {
       NGT::Index::disableLog();
     } else {
@@ -42,6 +43,22 @@ public:
     }
   }
 
+  ~Index() {
+    // the query object has already been freed by close() when the index is closed.
+    if (queryObject != 0 && index != 0) {
+      NGT::Index::deleteObject(queryObject);
+    }
+  }
+
+  // the query object is freed with the object space of the index before the index is closed.
+  void close() {
+    if (queryObject != 0) {
+      NGT::Index::deleteObject(queryObject);
+      queryObject = 0;
+    }
+    NGT::Index::close();
+  }
+
   static void create(
    const std::string path,
    size_t dimension,
@@ -57,8 +74,12 @@ public:
 
     if (objectType == "Float" || objectType == "float") {
       prop.objectType = NGT::Index::Property::ObjectType::Float;
+    } else if (objectType == "Float16" || objectType == "float16") {
+      prop.objectType = NGT::Index::Property::ObjectType::Float16;
     } else if (objectType == "Byte" || objectType == "byte") {
       prop.objectType = NGT::Index::Property::ObjectType::Uint8;
+    } else if (objectType == "Qint8" || objectType == "qint8") {
+      prop.objectType = NGT::Index::Property::ObjectType::Qint8;
     } else {
       std::stringstream msg;
       msg << "ngtpy::create: invalid object type. " << objectType;
@@ -140,9 +161,13 @@ public:
   ) {
     py::array_t<float> qobject(query);
     py::buffer_info qinfo = qobject.request();
-    NGT::Object *ngtquery = 0;
+    // the query object is allocated at the first search and is refilled by the subsequent searches.
     try {
-      ngtquery = NGT::Index::allocateObject(static_cast<float*>(qinfo.ptr), qinfo.size);
+      if (queryObject == 0) {
+	queryObject = NGT::Index::allocateObject(static_cast<float*>(qinfo.ptr), qinfo.size);
+      } else {
+	NGT::Index::getObjectSpace().setNormalizedObject(*queryObject, static_cast<float*>(qinfo.ptr), qinfo.size);
+      }
     } catch (NGT::Exception &e) {
       std::cerr << e.what() << std::endl;
       if (!withDistance) {
@@ -151,7 +176,7 @@ public:
 	return py::list();
       }
     }
-    NGT::SearchContainer sc(*ngtquery);
+    NGT::SearchContainer sc(*queryObject);
     if (size == 0) {
       sc.setSize(numOfSearchObjects);		// the number of resulting objects.
     } else {
@@ -165,7 +190,6 @@ public:
 
     numOfDistanceComputations += sc.distanceComputationCount;
 
-    NGT::Index::deleteObject(ngtquery);
     if (!withDistance) {
       NGT::ResultPriorityQueue &r = sc.getWorkingResult();
       py::array_t<int> ids(r.size());
@@ -201,6 +225,46 @@ public:
     return results;
   }
 
+  py::tuple batchSearch(
+   py::array_t<float, py::array::c_style | py::array::forcecast> queries,
+   size_t size = 0, 			// the number of resultant objects
+   float epsilon = 0.1, 		// search parameter epsilon.
+   int edgeSize = -1,			// the number of used edges for each node during the exploration of the graph.
+   size_t numThreads = 8
+  ) {
+    py::buffer_info qinfo = queries.request();
+    if (qinfo.ndim != 2) {
+      std::stringstream msg;
+      msg << "ngtpy::batchSearch: Error! queries should be a 2D array. " << qinfo.ndim;
+      NGTThrowException(msg);
+    }
+    NGT::Property prop;
+    getProperty(prop);
+    if (prop.dimension != qinfo.shape[1]) {
+      std::stringstream msg;
+      msg << "ngtpy::batchSearch: Error! dimensions are inconsitency. " << prop.dimension << ":" << qinfo.shape[1];
+      NGTThrowException(msg);
+    }
+    size_t numOfQueries = qinfo.shape[0];
+    size = size == 0 ? numOfSearchObjects : size;
+    py::array_t<int> ids(std::vector<size_t>{numOfQueries, size});
+    py::array_t<float> distances(std::vector<size_t>{numOfQueries, size});
+    int *idptr = static_cast<int*>(ids.request().ptr);
+    float *distanceptr = static_cast<float*>(distances.request().ptr);
+    const float *qptr = static_cast<const float*>(qinfo.ptr);
+    {
+      py::gil_scoped_release release;
+      NGT::Index::batchSearch(qptr, numOfQueries, qinfo.shape[1], size, epsilon, numThreads,
+			      reinterpret_cast<NGT::ObjectID*>(idptr), distanceptr, edgeSize, searchRadius);
+    }
+    if (zeroNumbering) {
+      for (size_t i = 0; i < numOfQueries * size; i++) {
+	idptr[i]--;
+      }
+    }
+    return py::make_tuple(ids, distances);
+  }
+
   py::object linearSearch(
    py::object query,
    size_t size = 0, 			// the number of resultant objects
@@ -283,6 +347,17 @@ public:
 	}
 	break;
       }
+    case NGT::ObjectSpace::ObjectType::Float16:
+      {
+	auto *obj = static_cast<NGT::float16*>(NGT::Index::getObjectSpace().getObject(id));
+	for (int i = 0; i < prop.dimension; i++) {
+	  object.push_back(*obj++);
+	}
+	break;
+      }
+    case NGT::ObjectSpace::ObjectType::Qint8:
+      NGT::Index::getObjectSpace().getObject(id, object);
+      break;
     default:
     case NGT::ObjectSpace::ObjectType::Float:
       {
@@ -311,6 +386,7 @@ public:
   size_t	numOfDistanceComputations;
   size_t	numOfSearchObjects; // k
   NGT::Distance	searchRadius;
+  NGT::Object	*queryObject;	    // the query object reused by search.
 };
 
 PYBIND11_MODULE(ngtpy, m) {
@@ -336,13 +412,19 @@ PYBIND11_MODULE(ngtpy, m) {
            py::arg("epsilon") = 0.1, 
            py::arg("edge_size") = -1,
            py::arg("with_distance") = true)
+      .def("batch_search", &::Index::batchSearch, 
+           py::arg("queries"), 
+           py::arg("size") = 0, 
+           py::arg("epsilon") = 0.1, 
+           py::arg("edge_size") = -1,
+           py::arg("num_threads") = 8)
       .def("linear_search", &::Index::linearSearch, 
            py::arg("query"), 
            py::arg("size") = 0, 
            py::arg("with_distance") = true)
       .def("get_num_of_distance_computations", &::Index::getNumOfDistanceComputations)
       .def("save", &NGT::Index::save)
-      .def("close", &NGT::Index::close)
+      .def("close", &::Index::close)
       .def("remove", &::Index::remove, 
            py::arg("object_id"))
       .def("build_index", &NGT::Index::createIndex, 